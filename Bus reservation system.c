@@ -1,226 +1,4209 @@
-/*
- * -----------------------------------------------------------------------------
- *
- * Project: 15 - Bus Reservation System
- *
- * -----------------------------------------------------------------------------
- *
- * Question:
- * Create a C program that simulates a bus ticket reservation system. The
- * system should manage the booking of seats on a single bus.
- *
- * The system must support the following operations:
- * 1.  Display a seat map of the bus, showing which seats are available and
- * which are booked.
- * 2.  Book a seat: The user selects an available seat number and provides
- * their name. The seat is then marked as booked.
- * 3.  Cancel a booking: The user provides a seat number, and if it's booked,
- * the reservation is canceled, making the seat available again.
- * 4.  Display the list of all booked seats along with the passenger names.
- * 5.  Save the current booking status to a file ("bus_reservation.dat") and
- * load it when the program starts.
- *
- * Concepts Covered:
- * - Managing an array of structs to represent a physical layout (bus seats).
- * - Visual representation of data (the seat map).
- * - Status-based operations (booking and canceling).
- * - Input validation (checking for valid seat numbers and availability).
- *
- * -----------------------------------------------------------------------------
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-// --- Constants ---
-#define TOTAL_SEATS 32
-#define FILENAME "bus_reservation.dat"
-
-// --- Data Structures ---
-struct Seat {
-    int seat_number;
-    int is_booked; // 0 for available, 1 for booked
-    char passenger_name[100];
-};
-
-// --- Global Data ---
-struct Seat bus_seats[TOTAL_SEATS];
-
-// --- Function Prototypes ---
-void initializeSeats();
-void displaySeatMap();
-void bookSeat();
-void cancelBooking();
-void displayBookedSeats();
-void saveData();
-void loadData();
-
-int main() {
-    loadData(); // Tries to load existing data, otherwise initializes
-    int choice;
-
-    while (1) {
-        printf("\n\n--- Bus Reservation System ---\n");
-        printf("1. Display Seat Map\n");
-        printf("2. Book a Seat\n");
-        printf("3. Cancel a Booking\n");
-        printf("4. Display Booked Seats List\n");
-        printf("5. Save and Exit\n");
-        printf("Enter your choice: ");
-        scanf("%d", &choice);
-        while (getchar() != '\n'); // Clear input buffer
-
-        switch (choice) {
-            case 1: displaySeatMap(); break;
-            case 2: bookSeat(); break;
-            case 3: cancelBooking(); break;
-            case 4: displayBookedSeats(); break;
-            case 5:
-                saveData();
-                printf("Booking data saved. Have a safe journey!\n");
-                exit(0);
-            default:
-                printf("Invalid choice. Please try again.\n");
-        }
-    }
-
-    return 0;
-}
-
-/**
- * @brief Initializes all seats to be available if no data is loaded.
- */
-void initializeSeats() {
-    for (int i = 0; i < TOTAL_SEATS; i++) {
-        bus_seats[i].seat_number = i + 1;
-        bus_seats[i].is_booked = 0;
-        strcpy(bus_seats[i].passenger_name, "N/A");
-    }
-}
-
-/**
- * @brief Displays a visual map of the bus seats.
- */
-void displaySeatMap() {
-    printf("\n\n--- Bus Seat Map ---\n");
-    printf("[XX] = Booked, [##] = Available\n");
-    printf("-------------------------------------\n");
-    for (int i = 0; i < TOTAL_SEATS; i++) {
-        if (bus_seats[i].is_booked) {
-            printf("[XX] "); // Booked seat
-        } else {
-            printf("[%02d] ", bus_seats[i].seat_number); // Available seat
-        }
-        // Newline after every 4 seats to create rows
-        if ((i + 1) % 4 == 0) {
-            printf("\n");
-        }
-    }
-    printf("-------------------------------------\n");
-}
-
-/**
- * @brief Handles the process of booking a seat.
- */
-void bookSeat() {
-    displaySeatMap();
-    int seat_num;
-    printf("Enter the seat number you want to book: ");
-    scanf("%d", &seat_num);
-    while (getchar() != '\n');
-
-    if (seat_num < 1 || seat_num > TOTAL_SEATS) {
-        printf("Error: Invalid seat number.\n");
-        return;
-    }
-
-    // Array index is seat_num - 1
-    int index = seat_num - 1;
-
-    if (bus_seats[index].is_booked) {
-        printf("Error: Seat %d is already booked by %s.\n", seat_num, bus_seats[index].passenger_name);
-        return;
-    }
-
-    printf("Enter passenger name for seat %d: ", seat_num);
-    fgets(bus_seats[index].passenger_name, sizeof(bus_seats[index].passenger_name), stdin);
-    bus_seats[index].passenger_name[strcspn(bus_seats[index].passenger_name, "\n")] = 0;
-
-    bus_seats[index].is_booked = 1;
-    printf("Seat %d booked successfully for %s!\n", seat_num, bus_seats[index].passenger_name);
-}
-
-/**
- * @brief Cancels an existing booking.
- */
-void cancelBooking() {
-    int seat_num;
-    printf("Enter the seat number to cancel booking: ");
-    scanf("%d", &seat_num);
-    while (getchar() != '\n');
-
-    if (seat_num < 1 || seat_num > TOTAL_SEATS) {
-        printf("Error: Invalid seat number.\n");
-        return;
-    }
-
-    int index = seat_num - 1;
-
-    if (!bus_seats[index].is_booked) {
-        printf("Error: Seat %d is not booked.\n", seat_num);
-        return;
-    }
-
-    printf("Booking for seat %d by %s has been canceled.\n", seat_num, bus_seats[index].passenger_name);
-    bus_seats[index].is_booked = 0;
-    strcpy(bus_seats[index].passenger_name, "N/A");
-}
-
-/**
- * @brief Displays a list of all currently booked seats.
- */
-void displayBookedSeats() {
-    printf("\n--- List of Booked Seats ---\n");
-    printf("%-15s %-s\n", "Seat Number", "Passenger Name");
-    printf("----------------------------------\n");
-    int booked_count = 0;
-    for (int i = 0; i < TOTAL_SEATS; i++) {
-        if (bus_seats[i].is_booked) {
-            printf("%-15d %-s\n", bus_seats[i].seat_number, bus_seats[i].passenger_name);
-            booked_count++;
-        }
-    }
-    if (booked_count == 0) {
-        printf("No seats are currently booked.\n");
-    }
-    printf("----------------------------------\n");
-}
-
-/**
- * @brief Saves the current booking status to a file.
- */
-void saveData() {
-    FILE *fp = fopen(FILENAME, "wb");
-    if (fp == NULL) {
-        printf("Error opening file for writing.\n");
-        return;
-    }
-    fwrite(bus_seats, sizeof(struct Seat), TOTAL_SEATS, fp);
-    fclose(fp);
-}
-
-/**
- * @brief Loads booking status from a file, or initializes if file doesn't exist.
- */
-void loadData() {
-    FILE *fp = fopen(FILENAME, "rb");
-    if (fp == NULL) {
-        // If file doesn't exist, it's the first run. Initialize seats.
-        initializeSeats();
-        return;
-    }
-    fread(bus_seats, sizeof(struct Seat), TOTAL_SEATS, fp);
-    fclose(fp);
-    printf("Loaded previous booking data.\n");
-}
+/*
+ * -----------------------------------------------------------------------------
+ *
+ * Project: 15 - Bus Reservation System
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Question:
+ * Create a C program that simulates a bus ticket reservation system. The
+ * system should manage the booking of seats across many trips, where each
+ * trip is identified by its route, travel date and bus. A route may have
+ * intermediate stops, and a seat can be sold separately for each part of
+ * the journey.
+ *
+ * The system must support the following operations:
+ * 1.  Select (or create) a trip by route number, date and bus number.
+ * 2.  Display a seat map of the selected trip for a given origin and
+ * destination stop, showing which seats are available and which are booked.
+ * 3.  Book a seat: The user picks the origin and destination stops, selects
+ * an available seat number (or lets the system pick the first free one) and
+ * provides their name. The seat is then marked as booked for those stops.
+ * If no seat is free, the passenger can join the trip's waitlist.
+ * 4.  Book a group: The user gives the group size, and the system finds that
+ * many adjacent free seats (kept within a row where possible) and books them
+ * all at once, or none of them.
+ * 5.  Cancel a booking: The user provides a seat number (and origin stop),
+ * and if it's booked, the reservation is canceled, making the seat available
+ * again. The freed seat goes to the head of the waitlist if it fits.
+ * 6.  Display the list of all booked seats along with the passenger names.
+ * 7.  List all known trips with their remaining free seats.
+ * 8.  Display the waitlist of the selected trip in promotion order.
+ * 9.  Find a booking on any trip by its booking reference or by passenger
+ * name (case-insensitive).
+ * 10. Benchmark the booking core with many threads booking and canceling
+ * seats on the same trip at once, either the seat bitmaps alone or the full
+ * booking path with its lookup indexes.
+ * 11. Generate or replay a booking/cancellation trace and report throughput
+ * and p50/p99/p999 latency per operation. Running the program as
+ * "bus --replay-trace <file>" does the same without the menu.
+ * 12. Analyze a directory of archived snapshots and journals on all cores:
+ * load factor by route and weekday, the order in which seats sell, and
+ * cancellation rates. "bus --analyze <directory>" does the same.
+ * 13. Save the current booking status of every trip to a file
+ * ("bus_trips.dat") and load it when the program starts. Every change is
+ * also appended to a journal ("bus_trips.journal") as it happens, so a
+ * crash loses nothing that was confirmed to the customer.
+ *
+ * Concepts Covered:
+ * - Packing seat availability into 64-bit bitmaps, one word per trip leg.
+ * - Finding the first free seat with a count-trailing-zeros instruction.
+ * - Answering "free from stop A to stop B" by OR-ing the legs in between.
+ * - Finding runs of adjacent free seats with shift-and-AND on the bitmap.
+ * - Separating hot data (bitmaps) from cold data (passenger names).
+ * - Hash-indexing trips by a composite key (route, date, bus).
+ * - Lock-free seat claiming with atomic compare-and-swap on the bitmaps.
+ * - Write-ahead journaling with group-commit fsync, snapshot and replay.
+ * - A binary min-heap as a priority queue for the waitlist.
+ * - Workload generation (uniform and Zipf-skewed) and latency percentiles.
+ * - Hash indexes with linear probing and backward-shift deletion.
+ * - Columnar (struct-of-arrays) aggregation split across a pool of threads.
+ * - A versioned, CRC32C-checked file format read in place through mmap().
+ * - Input validation (checking for valid seat numbers and availability).
+ *
+ * Note on Compilation:
+ * - Uses the GCC/Clang builtins __builtin_ctzll and __builtin_popcountll.
+ * - Needs C11 atomics and POSIX threads: gcc -std=c11 ... -pthread
+ * - Uses POSIX file I/O (open, write, fdatasync) for the journal and mmap()
+ * for reading snapshots. Files are in the machine's native byte order.
+ * - Link with -lm for pow() in the trace generator.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#define _POSIX_C_SOURCE 200809L // For clock_gettime(), fdatasync()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h> // For strcasecmp()
+#include <ctype.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <math.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+// --- Constants ---
+#define TOTAL_SEATS 32
+#define SEATS_PER_ROW 4
+#define NAME_LEN 100
+#define MAX_STOPS 64          // So that a leg mask also fits in 64 bits
+#define FILENAME "bus_trips.dat"
+#define LEGACY_FILENAME "bus_reservation.dat" // Single-bus file of older versions
+#define JOURNAL_FILENAME "bus_trips.journal"
+#define SNAPSHOT_MAGIC "BUSSNAP"   // 8 bytes with the terminator
+#define SNAPSHOT_VERSION 4         // 1 = raw structs, 2 = no counters, 3 = no sales history
+#define JOURNAL_BUFFER_RECORDS 256     // Records gathered into one group commit
+#define JOURNAL_COMPACT_RECORDS 50000  // Snapshot once the journal is this long
+#define PRIORITY_CLASSES 3             // 1 = highest priority
+#define REFERENCE_LEN 8                // Booking reference characters
+#define MAX_NAME_MATCHES 50            // Bookings shown for one name search
+#define TRIP_CHUNK_SIZE 4096  // Trips per storage chunk; chunks never move
+#define MAX_TRIP_CHUNKS 1024  // Up to 4M trips in one process
+#define BOOKING_CHUNK_SIZE 65536
+#define MAX_BOOKING_CHUNKS 1024
+#define MAX_BENCH_THREADS 256
+#define LOOKUP_SHARD_BITS 6 // Each lookup index is split into 64 separately locked shards
+#define LOOKUP_SHARDS (1 << LOOKUP_SHARD_BITS)
+#define BENCH_RESULTS_FILENAME "bus_bench_results.jsonl" // One JSON object per line
+#define ALL_SEATS_MASK ((TOTAL_SEATS) == 64 ? ~0ULL : (1ULL << (TOTAL_SEATS)) - 1)
+
+_Static_assert(TOTAL_SEATS <= 64, "a trip's seats must fit in one 64-bit word");
+_Static_assert(TOTAL_SEATS % SEATS_PER_ROW == 0, "every row must be complete");
+
+// --- Data Structures ---
+
+// On-disk layout of the old single-bus file, kept only for importing it.
+struct Seat {
+    int seat_number;
+    int is_booked; // 0 for available, 1 for booked
+    char passenger_name[NAME_LEN];
+};
+
+struct TripKey {
+    int route_id;
+    int date; // YYYYMMDD
+    int bus_id;
+};
+
+// Hot data: everything an availability scan needs, nothing more.
+// Leg l runs from stop l to stop l + 1 (0-based). legs[l] has bit i set when
+// seat i + 1 is taken on that leg. The bitmaps are only ever changed with
+// atomic operations, so any number of booking agents can work on the same
+// trip without a lock.
+struct Trip {
+    struct TripKey key;
+    int num_stops;               // 2 for a direct trip
+    _Atomic uint64_t *legs;      // num_stops - 1 words
+    _Atomic uint64_t single_leg; // Storage for legs[] on direct trips
+};
+
+// On-disk form of a trip (16 bytes in every snapshot version).
+struct TripRecord {
+    struct TripKey key;
+    int num_stops;
+};
+
+// Snapshot file header. Sections follow at fixed offsets and hold
+// fixed-size records, so record i of a section is at offset + i * size and
+// the file can be used in place once mapped.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t lsn;        // Journal position the snapshot covers
+    uint64_t file_size;
+    uint32_t trip_count;
+    uint32_t trip_size;
+    uint32_t booking_count;
+    uint32_t booking_size;
+    uint32_t waitlist_count;
+    uint32_t waitlist_size;
+    uint64_t trips_offset;
+    uint64_t bookings_offset;
+    uint64_t waitlist_offset;
+    uint32_t body_crc;   // CRC32C of everything after the header
+    uint32_t header_crc; // CRC32C of the header with this field zero
+    // Version 3: high-water marks, so numbers of bookings and waitlist
+    // requests that are gone by the time of the snapshot are never reused
+    uint64_t next_reference;
+    uint64_t next_request;
+    // Version 4: the sales history section, one record per trip
+    uint32_t sales_count;
+    uint32_t sales_size;
+    uint64_t sales_offset;
+};
+
+struct SnapshotBooking {
+    uint64_t reference;
+    uint32_t trip_id;
+    uint8_t seat;
+    uint8_t from_stop;
+    uint8_t to_stop;
+    uint8_t reserved;
+    char name[NAME_LEN];
+    uint32_t reserved2;
+};
+
+// On-disk form of a trip's sales history (struct TripSales).
+struct SnapshotTripSales {
+    uint32_t bookings;
+    uint32_t cancellations;
+    uint32_t seat_rank_sum[TOTAL_SEATS];
+    uint32_t seat_sales[TOTAL_SEATS];
+};
+
+struct SnapshotWaitlistEntry {
+    uint64_t request;
+    uint32_t trip_id;
+    uint8_t priority;
+    uint8_t from_stop;
+    uint8_t to_stop;
+    uint8_t reserved;
+    char name[NAME_LEN];
+    uint32_t reserved2;
+};
+
+_Static_assert(sizeof(struct TripRecord) == 16, "trip records are 16 bytes on disk");
+_Static_assert(sizeof(struct SnapshotHeader) == 120, "the snapshot header layout is fixed");
+_Static_assert(sizeof(struct SnapshotBooking) % 8 == 0 && sizeof(struct SnapshotWaitlistEntry) % 8 == 0 &&
+               sizeof(struct SnapshotTripSales) % 8 == 0, "sections must stay 8-byte aligned");
+
+// A validated snapshot: pointers into the mapped file, or into 'converted'
+// when an older file was migrated on the fly.
+struct SnapshotView {
+    uint64_t lsn;
+    int version;
+    uint64_t next_reference; // 0 if the file does not record it
+    uint64_t next_request;
+    const struct TripRecord *trips;
+    uint32_t trip_count;
+    const struct SnapshotBooking *bookings;
+    uint32_t booking_count;
+    const struct SnapshotWaitlistEntry *waitlist;
+    uint32_t waitlist_count;
+    const struct SnapshotTripSales *sales; // Trips past sales_count have no history
+    uint32_t sales_count;
+    void *converted;
+};
+
+// Cold data: only touched when a passenger is booked, canceled or listed.
+// A booking covers one seat from from_stop up to (not including) to_stop.
+// Records are written once and never reused while the program runs.
+struct Booking {
+    uint64_t reference; // Booking reference, never reused; 0 = none
+    int trip_id;
+    unsigned char seat;      // 0-based
+    unsigned char from_stop; // 0-based
+    unsigned char to_stop;
+    char name[NAME_LEN];
+    int name_prev; // Neighbours among live bookings with the same name, -1 = none
+    int name_next;
+};
+
+// Journal operations
+enum JournalOp {
+    JOURNAL_ADD_TRIP = 1, // to_stop holds the number of stops
+    JOURNAL_BOOK = 2,
+    JOURNAL_CANCEL = 3,
+    JOURNAL_WAITLIST_ADD = 4, // seat holds the priority class, ref the request number
+    JOURNAL_PROMOTE = 5       // A booking for waitlist request 'ref'
+};
+
+// One fixed-size (144-byte) journal entry. Trips are named by key rather
+// than by id so that a record means the same thing after compaction.
+struct JournalRecord {
+    uint64_t lsn; // Log sequence number, increasing by one per record
+    uint64_t ref; // Waitlist request number, if the operation has one
+    uint64_t booking_ref; // Reference of the booking made or canceled (0 in older CANCEL records)
+    struct TripKey key;
+    unsigned char op;
+    unsigned char seat;
+    unsigned char from_stop;
+    unsigned char to_stop;
+    char name[NAME_LEN];
+    uint32_t checksum; // Detects a torn record at the end of the file
+};
+
+// Appenders copy records into 'pending' under the lock. The first thread
+// that needs them on disk becomes the leader: it swaps the buffers, writes
+// and fsyncs the whole batch without the lock, and wakes everyone whose
+// record was in it. One fsync thus covers every booking made meanwhile.
+struct Journal {
+    int fd;                       // -1 when journaling is off
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    struct JournalRecord *pending;
+    struct JournalRecord *writing;
+    int pending_count;
+    int flushing;                 // A leader is writing 'writing'
+    uint64_t next_lsn;            // Last LSN handed out
+    uint64_t durable_lsn;         // Last LSN known to be on disk
+    long records_since_snapshot;
+};
+
+// A passenger waiting for a seat on a trip.
+struct WaitlistEntry {
+    uint64_t request; // Global request number: earlier requests go first
+    unsigned char priority; // 1 .. PRIORITY_CLASSES, lower goes first
+    unsigned char from_stop;
+    unsigned char to_stop;
+    char name[NAME_LEN];
+};
+
+// The heap only moves 16-byte nodes around; the entries themselves stay put
+// in 'entries' and freed slots are reused through 'free_slots'.
+struct HeapNode {
+    uint64_t order; // priority << 56 | request, so one compare decides
+    uint32_t slot;
+};
+
+struct Waitlist {
+    pthread_mutex_t lock;
+    struct HeapNode *heap;
+    struct WaitlistEntry *entries;
+    uint32_t *free_slots;
+    int size;
+    int free_count;
+    int capacity;
+};
+
+// Sales history of one trip: every booking and cancellation ever made on
+// it, not just the live bookings, so the analytics do not depend on the
+// journal that each save empties. A sale's fill-order rank is the number of
+// bookings the trip had before it.
+struct TripSales {
+    _Atomic uint32_t bookings; // Including waitlist promotions
+    _Atomic uint32_t cancellations;
+    _Atomic uint32_t seat_rank_sum[TOTAL_SEATS];
+    _Atomic uint32_t seat_sales[TOTAL_SEATS];
+};
+
+// Open-addressing hash table of booking ids with linear probing. The keys
+// (reference or folded name) are read from the booking records themselves.
+// A lookup index is LOOKUP_SHARDS of these, picked by the top bits of the
+// hash, so agents booking at once rarely wait on the same lock. Each shard
+// sits on its own cache line.
+struct BookingIndex {
+    _Alignas(64) pthread_mutex_t lock;
+    int *slots;   // Booking id + 1, 0 = empty slot
+    int capacity; // Always a power of two
+    int count;
+};
+
+struct TripInventory {
+    struct Trip *trips[MAX_TRIP_CHUNKS]; // Chunked hot table
+    // Per trip, lazily allocated: entry [seat * legs + leg] holds the id + 1
+    // of the booking of that seat that starts on that leg, 0 if none.
+    _Atomic(_Atomic uint32_t *) *starts[MAX_TRIP_CHUNKS];
+    _Atomic(struct Waitlist *) *waitlists[MAX_TRIP_CHUNKS]; // Per trip, lazily allocated
+    _Atomic(struct TripSales *) *sales[MAX_TRIP_CHUNKS];    // Per trip, from its first sale
+    int trip_count;
+    int *index;          // Open-addressing hash: trip id + 1, 0 = empty slot
+    int index_capacity;  // Always a power of two
+    _Atomic(struct Booking *) bookings[MAX_BOOKING_CHUNKS]; // Chunked cold table
+    _Atomic int booking_count;
+    struct BookingIndex by_reference[LOOKUP_SHARDS]; // Live bookings by reference
+    struct BookingIndex by_name[LOOKUP_SHARDS];      // First live booking of each case-folded name
+    struct Journal *journal; // Changes are logged here unless NULL
+};
+
+// --- Global Data ---
+struct TripInventory inventory;
+struct Journal journal = {.fd = -1};
+int current_trip = -1; // Trip id selected in the menu, -1 = none
+static _Thread_local uint64_t last_appended_lsn; // This thread's newest record
+_Atomic uint64_t next_request = 1; // Next waitlist request number
+_Atomic uint64_t next_reference = 1; // Sequence behind the next booking reference
+
+// --- Function Prototypes ---
+void initInventory(struct TripInventory *inv);
+void freeInventory(struct TripInventory *inv);
+struct Trip *getTrip(struct TripInventory *inv, int trip_id);
+struct Booking *getBooking(struct TripInventory *inv, int booking_id);
+int findTrip(struct TripInventory *inv, struct TripKey key);
+int findOrAddTrip(struct TripInventory *inv, struct TripKey key, int num_stops);
+uint64_t busySeats(struct Trip *trip, int from, int to);
+int findFirstFreeSeat(struct Trip *trip, int from, int to);
+int countFreeSeats(struct Trip *trip, int from, int to);
+int claimSeats(struct Trip *trip, uint64_t mask, int from, int to, long *retries);
+int claimFirstFreeSeat(struct Trip *trip, int from, int to, long *retries);
+int releaseSeats(struct Trip *trip, uint64_t mask, int from, int to);
+uint64_t adjacentRunStarts(uint64_t free_seats, int count);
+int claimAdjacentSeats(struct Trip *trip, int count, int from, int to, long *retries);
+int recordBooking(struct TripInventory *inv, int trip_id, int seat, int from, int to, const char *name);
+int cancelSeat(struct TripInventory *inv, int trip_id, int seat, int from);
+int joinWaitlist(struct TripInventory *inv, int trip_id, int priority, int from, int to, const char *name,
+                 uint64_t *request);
+int promoteWaitlisted(struct TripInventory *inv, int trip_id, int *booking_ids, int max_ids);
+int listTripBookings(struct TripInventory *inv, int trip_id, int *booking_ids);
+void formatReference(uint64_t reference, char *out);
+int parseReference(const char *text, uint64_t *reference);
+int findBookingByReference(struct TripInventory *inv, uint64_t reference);
+int findBookingsByName(struct TripInventory *inv, const char *name, int *booking_ids, int max_ids);
+static int indexBooking(struct TripInventory *inv, int booking_id);
+static void unindexBooking(struct TripInventory *inv, int booking_id);
+static uint64_t newReference(uint64_t reference);
+int openJournal(struct Journal *j, const char *path);
+void journalAppend(struct Journal *j, struct JournalRecord *rec);
+int journalCommit(struct Journal *j);
+void closeJournal(struct Journal *j);
+void selectTrip();
+void listTrips();
+void displaySeatMap();
+void bookSeat();
+void bookGroup();
+void cancelBooking();
+void displayBookedSeats();
+void displayWaitlist();
+void findBooking();
+void saveData();
+void loadData();
+static void compactJournalIfNeeded();
+void runConcurrencyBenchmark();
+void runTraceBenchmark();
+int replayTraceFile(const char *path);
+void runAnalytics();
+int analyzeArchive(const char *dir_path);
+
+int main(int argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "--replay-trace") == 0) {
+        return replayTraceFile(argv[2]) ? 0 : 1;
+    }
+    if (argc == 3 && strcmp(argv[1], "--analyze") == 0) {
+        return analyzeArchive(argv[2]) ? 0 : 1;
+    }
+    initInventory(&inventory);
+    loadData(); // Tries to load existing data, otherwise starts empty
+    int choice;
+
+    while (1) {
+        printf("\n\n--- Bus Reservation System ---\n");
+        if (current_trip != -1) {
+            struct Trip *t = getTrip(&inventory, current_trip);
+            printf("Current trip: Route %d, Date %d, Bus %d (%d stops)\n",
+                   t->key.route_id, t->key.date, t->key.bus_id, t->num_stops);
+        }
+        printf("1. Select Trip\n");
+        printf("2. Display Seat Map\n");
+        printf("3. Book a Seat\n");
+        printf("4. Book a Group of Adjacent Seats\n");
+        printf("5. Cancel a Booking\n");
+        printf("6. Display Booked Seats List\n");
+        printf("7. List All Trips\n");
+        printf("8. Display Waitlist\n");
+        printf("9. Find a Booking\n");
+        printf("10. Run Concurrency Benchmark\n");
+        printf("11. Run Trace Replay Benchmark\n");
+        printf("12. Analyze Archived Trips\n");
+        printf("13. Save and Exit\n");
+        printf("Enter your choice: ");
+        scanf("%d", &choice);
+        while (getchar() != '\n'); // Clear input buffer
+
+        compactJournalIfNeeded();
+
+        switch (choice) {
+            case 1: selectTrip(); break;
+            case 2: displaySeatMap(); break;
+            case 3: bookSeat(); break;
+            case 4: bookGroup(); break;
+            case 5: cancelBooking(); break;
+            case 6: displayBookedSeats(); break;
+            case 7: listTrips(); break;
+            case 8: displayWaitlist(); break;
+            case 9: findBooking(); break;
+            case 10: runConcurrencyBenchmark(); break;
+            case 11: runTraceBenchmark(); break;
+            case 12: runAnalytics(); break;
+            case 13:
+                saveData();
+                closeJournal(&journal);
+                freeInventory(&inventory);
+                printf("Booking data saved. Have a safe journey!\n");
+                exit(0);
+            default:
+                printf("Invalid choice. Please try again.\n");
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Prepares an empty trip inventory.
+ */
+void initInventory(struct TripInventory *inv) {
+    memset(inv, 0, sizeof(*inv));
+    inv->index_capacity = 1024;
+    inv->index = calloc(inv->index_capacity, sizeof(int));
+    int ok = inv->index != NULL;
+    for (int i = 0; i < LOOKUP_SHARDS; i++) {
+        struct BookingIndex *shards[2] = {&inv->by_reference[i], &inv->by_name[i]};
+        for (int k = 0; k < 2; k++) {
+            pthread_mutex_init(&shards[k]->lock, NULL);
+            shards[k]->capacity = 64;
+            shards[k]->slots = calloc(shards[k]->capacity, sizeof(int));
+            ok = ok && shards[k]->slots != NULL;
+        }
+    }
+    if (!ok) {
+        printf("Error: Out of memory.\n");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Releases every chunk, leg array, start table and the hash index.
+ */
+void freeInventory(struct TripInventory *inv) {
+    for (int c = 0; c < MAX_TRIP_CHUNKS && inv->trips[c] != NULL; c++) {
+        int in_chunk = inv->trip_count - c * TRIP_CHUNK_SIZE;
+        if (in_chunk > TRIP_CHUNK_SIZE) {
+            in_chunk = TRIP_CHUNK_SIZE;
+        }
+        for (int i = 0; i < in_chunk; i++) {
+            struct Trip *trip = &inv->trips[c][i];
+            if (trip->legs != &trip->single_leg) {
+                free(trip->legs);
+            }
+            free(atomic_load(&inv->starts[c][i]));
+            struct Waitlist *w = atomic_load(&inv->waitlists[c][i]);
+            if (w != NULL) {
+                pthread_mutex_destroy(&w->lock);
+                free(w->heap);
+                free(w->entries);
+                free(w->free_slots);
+                free(w);
+            }
+            free(atomic_load(&inv->sales[c][i]));
+        }
+        free(inv->starts[c]);
+        free(inv->waitlists[c]);
+        free(inv->sales[c]);
+        free(inv->trips[c]);
+    }
+    for (int c = 0; c < MAX_BOOKING_CHUNKS; c++) {
+        free(atomic_load(&inv->bookings[c]));
+    }
+    free(inv->index);
+    for (int i = 0; i < LOOKUP_SHARDS; i++) {
+        free(inv->by_reference[i].slots);
+        free(inv->by_name[i].slots);
+        pthread_mutex_destroy(&inv->by_reference[i].lock);
+        pthread_mutex_destroy(&inv->by_name[i].lock);
+    }
+    memset(inv, 0, sizeof(*inv));
+}
+
+/**
+ * @brief Returns the hot record of a trip. Chunks never move, so the
+ * pointer stays valid while more trips are added.
+ */
+struct Trip *getTrip(struct TripInventory *inv, int trip_id) {
+    return &inv->trips[trip_id / TRIP_CHUNK_SIZE][trip_id % TRIP_CHUNK_SIZE];
+}
+
+/**
+ * @brief Returns the cold record of a booking.
+ */
+struct Booking *getBooking(struct TripInventory *inv, int booking_id) {
+    return &atomic_load(&inv->bookings[booking_id / BOOKING_CHUNK_SIZE])[booking_id % BOOKING_CHUNK_SIZE];
+}
+
+/**
+ * @brief Sets up the leg bitmaps of a trip with no seats booked.
+ * Direct trips use the word inside the trip itself.
+ * @return 1 on success, 0 if out of memory.
+ */
+static int initTripLegs(struct Trip *trip, int num_stops) {
+    int legs = num_stops - 1;
+    trip->num_stops = num_stops;
+    if (legs == 1) {
+        trip->legs = &trip->single_leg;
+    } else {
+        trip->legs = malloc(legs * sizeof(*trip->legs));
+        if (trip->legs == NULL) {
+            return 0;
+        }
+    }
+    for (int l = 0; l < legs; l++) {
+        atomic_init(&trip->legs[l], 0);
+    }
+    return 1;
+}
+
+/**
+ * @brief Returns the booking-start table of a trip.
+ * @param create If non-zero, allocate the table when missing. Two agents
+ * racing to create it both allocate; the loser of the compare-and-swap frees
+ * its copy and uses the winner's.
+ * @return The table, or NULL if it does not exist (or is out of memory).
+ */
+static _Atomic uint32_t *getSeatStarts(struct TripInventory *inv, int trip_id, int create) {
+    _Atomic(_Atomic uint32_t *) *slot = &inv->starts[trip_id / TRIP_CHUNK_SIZE][trip_id % TRIP_CHUNK_SIZE];
+    _Atomic uint32_t *table = atomic_load(slot);
+    if (table == NULL && create) {
+        int legs = getTrip(inv, trip_id)->num_stops - 1;
+        _Atomic uint32_t *fresh = calloc((size_t)TOTAL_SEATS * legs, sizeof(*fresh));
+        if (fresh == NULL) {
+            return NULL;
+        }
+        if (atomic_compare_exchange_strong(slot, &table, fresh)) {
+            table = fresh;
+        } else {
+            free(fresh); // Another agent installed one first; 'table' now holds it
+        }
+    }
+    return table;
+}
+
+/**
+ * @brief Returns the sales history of a trip, optionally creating it.
+ * Creation races are settled with a compare-and-swap, as for the start tables.
+ */
+static struct TripSales *getTripSales(struct TripInventory *inv, int trip_id, int create) {
+    _Atomic(struct TripSales *) *slot = &inv->sales[trip_id / TRIP_CHUNK_SIZE][trip_id % TRIP_CHUNK_SIZE];
+    struct TripSales *sales = atomic_load(slot);
+    if (sales == NULL && create) {
+        struct TripSales *fresh = calloc(1, sizeof(struct TripSales));
+        if (fresh == NULL) {
+            return NULL;
+        }
+        if (atomic_compare_exchange_strong(slot, &sales, fresh)) {
+            sales = fresh;
+        } else {
+            free(fresh);
+        }
+    }
+    return sales;
+}
+
+/**
+ * @brief Adds a booking of 'seat' to its trip's sales history. Out of
+ * memory only costs the analytics this one sale.
+ */
+static void countSale(struct TripInventory *inv, int trip_id, int seat) {
+    struct TripSales *sales = getTripSales(inv, trip_id, 1);
+    if (sales != NULL) {
+        uint32_t rank = atomic_fetch_add(&sales->bookings, 1);
+        atomic_fetch_add(&sales->seat_rank_sum[seat], rank);
+        atomic_fetch_add(&sales->seat_sales[seat], 1);
+    }
+}
+
+static void countCancellation(struct TripInventory *inv, int trip_id) {
+    struct TripSales *sales = getTripSales(inv, trip_id, 1);
+    if (sales != NULL) {
+        atomic_fetch_add(&sales->cancellations, 1);
+    }
+}
+
+/**
+ * @brief Reserves a fresh booking record without taking any lock.
+ * @return The booking id, or -1 if the table is full or out of memory.
+ */
+static int allocBooking(struct TripInventory *inv) {
+    int id = atomic_fetch_add(&inv->booking_count, 1);
+    if (id < 0 || id >= MAX_BOOKING_CHUNKS * BOOKING_CHUNK_SIZE) {
+        return -1;
+    }
+    _Atomic(struct Booking *) *slot = &inv->bookings[id / BOOKING_CHUNK_SIZE];
+    struct Booking *chunk = atomic_load(slot);
+    if (chunk == NULL) {
+        struct Booking *fresh = calloc(BOOKING_CHUNK_SIZE, sizeof(struct Booking));
+        if (fresh == NULL) {
+            return -1;
+        }
+        if (!atomic_compare_exchange_strong(slot, &chunk, fresh)) {
+            free(fresh);
+        }
+    }
+    return id;
+}
+
+/**
+ * @brief Mixes the three key fields into a well-distributed 32-bit hash.
+ */
+static uint32_t hashTripKey(struct TripKey key) {
+    uint64_t h = (uint64_t)(uint32_t)key.route_id * 0x9E3779B97F4A7C15ULL;
+    h ^= (uint64_t)(uint32_t)key.date * 0xC2B2AE3D27D4EB4FULL;
+    h ^= (uint64_t)(uint32_t)key.bus_id * 0x165667B19E3779F9ULL;
+    h ^= h >> 29;
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static int sameTripKey(struct TripKey a, struct TripKey b) {
+    return a.route_id == b.route_id && a.date == b.date && a.bus_id == b.bus_id;
+}
+
+/**
+ * @brief Looks up a trip through the hash index.
+ * @return The trip id, or -1 if not found.
+ */
+int findTrip(struct TripInventory *inv, struct TripKey key) {
+    uint32_t mask = inv->index_capacity - 1;
+    for (uint32_t pos = hashTripKey(key) & mask; inv->index[pos] != 0; pos = (pos + 1) & mask) {
+        int id = inv->index[pos] - 1;
+        if (sameTripKey(getTrip(inv, id)->key, key)) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Doubles the hash index and reinserts every trip.
+ * @return 1 on success, 0 if out of memory.
+ */
+static int growTripIndex(struct TripInventory *inv) {
+    int new_capacity = inv->index_capacity * 2;
+    int *new_index = calloc(new_capacity, sizeof(int));
+    if (new_index == NULL) {
+        return 0;
+    }
+    uint32_t mask = new_capacity - 1;
+    for (int id = 0; id < inv->trip_count; id++) {
+        uint32_t pos = hashTripKey(getTrip(inv, id)->key) & mask;
+        while (new_index[pos] != 0) {
+            pos = (pos + 1) & mask;
+        }
+        new_index[pos] = id + 1;
+    }
+    free(inv->index);
+    inv->index = new_index;
+    inv->index_capacity = new_capacity;
+    return 1;
+}
+
+/**
+ * @brief Finds a trip, creating an empty one with the given number of stops
+ * if it does not exist yet. Trips are only created from one thread.
+ * @return The trip id, or -1 if the inventory is full or out of memory.
+ */
+int findOrAddTrip(struct TripInventory *inv, struct TripKey key, int num_stops) {
+    int id = findTrip(inv, key);
+    if (id != -1) {
+        return id;
+    }
+    if (inv->trip_count >= MAX_TRIP_CHUNKS * TRIP_CHUNK_SIZE) {
+        return -1;
+    }
+    // Keep the load factor at or below 1/2 so probe sequences stay short
+    if ((inv->trip_count + 1) * 2 > inv->index_capacity && !growTripIndex(inv)) {
+        return -1;
+    }
+
+    id = inv->trip_count;
+    int chunk = id / TRIP_CHUNK_SIZE;
+    if (inv->trips[chunk] == NULL) {
+        inv->trips[chunk] = malloc(TRIP_CHUNK_SIZE * sizeof(struct Trip));
+        inv->starts[chunk] = calloc(TRIP_CHUNK_SIZE, sizeof(*inv->starts[chunk]));
+        inv->waitlists[chunk] = calloc(TRIP_CHUNK_SIZE, sizeof(*inv->waitlists[chunk]));
+        inv->sales[chunk] = calloc(TRIP_CHUNK_SIZE, sizeof(*inv->sales[chunk]));
+        if (inv->trips[chunk] == NULL || inv->starts[chunk] == NULL || inv->waitlists[chunk] == NULL ||
+            inv->sales[chunk] == NULL) {
+            free(inv->trips[chunk]);
+            free(inv->starts[chunk]);
+            free(inv->waitlists[chunk]);
+            free(inv->sales[chunk]);
+            inv->trips[chunk] = NULL;
+            inv->starts[chunk] = NULL;
+            inv->waitlists[chunk] = NULL;
+            inv->sales[chunk] = NULL;
+            return -1;
+        }
+    }
+
+    struct Trip *trip = getTrip(inv, id);
+    trip->key = key;
+    if (!initTripLegs(trip, num_stops)) {
+        return -1;
+    }
+
+    uint32_t mask = inv->index_capacity - 1;
+    uint32_t pos = hashTripKey(key) & mask;
+    while (inv->index[pos] != 0) {
+        pos = (pos + 1) & mask;
+    }
+    inv->index[pos] = id + 1;
+    inv->trip_count++;
+
+    if (inv->journal != NULL) {
+        struct JournalRecord rec = {.key = key, .op = JOURNAL_ADD_TRIP, .to_stop = (unsigned char)num_stops};
+        journalAppend(inv->journal, &rec);
+    }
+    return id;
+}
+
+/**
+ * @brief Returns the seats that are taken on any leg in [from, to).
+ * One OR per leg, so even a 63-leg journey is a handful of instructions.
+ */
+uint64_t busySeats(struct Trip *trip, int from, int to) {
+    uint64_t busy = 0;
+    for (int l = from; l < to; l++) {
+        busy |= atomic_load(&trip->legs[l]);
+    }
+    return busy & ALL_SEATS_MASK;
+}
+
+/**
+ * @brief Finds the lowest-numbered seat free on every leg in [from, to).
+ * This is only a snapshot; use claimFirstFreeSeat() to actually take it.
+ * @return The 0-based seat index, or -1 if no seat is free for the journey.
+ */
+int findFirstFreeSeat(struct Trip *trip, int from, int to) {
+    uint64_t free_seats = ~busySeats(trip, from, to) & ALL_SEATS_MASK;
+    if (free_seats == 0) {
+        return -1;
+    }
+    return __builtin_ctzll(free_seats);
+}
+
+/**
+ * @brief Counts the seats free on every leg in [from, to) with a popcount.
+ */
+int countFreeSeats(struct Trip *trip, int from, int to) {
+    return TOTAL_SEATS - __builtin_popcountll(busySeats(trip, from, to));
+}
+
+/**
+ * @brief Atomically sets every bit of a mask in one leg word, or none.
+ * @return 1 on success, 0 if any of the bits was already set.
+ */
+static int claimLeg(_Atomic uint64_t *leg, uint64_t mask, long *retries) {
+    uint64_t old = atomic_load(leg);
+    while (!(old & mask)) {
+        if (atomic_compare_exchange_weak(leg, &old, old | mask)) {
+            return 1;
+        }
+        if (retries != NULL) {
+            (*retries)++; // 'old' was refreshed by the failed exchange
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Books every seat in a mask on every leg in [from, to), or nothing.
+ * Legs are claimed in order with compare-and-swap; if a leg is already
+ * taken, the legs claimed so far are released again. Another agent may
+ * briefly see those seats as taken, but no seat is ever held twice.
+ * @param retries If not NULL, incremented once per lost compare-and-swap.
+ * @return 1 if all seats were claimed, 0 if any of them was already booked.
+ */
+int claimSeats(struct Trip *trip, uint64_t mask, int from, int to, long *retries) {
+    for (int l = from; l < to; l++) {
+        if (!claimLeg(&trip->legs[l], mask, retries)) {
+            while (--l >= from) {
+                atomic_fetch_and(&trip->legs[l], ~mask);
+            }
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Atomically books the lowest-numbered seat free on every leg in
+ * [from, to).
+ * @param retries If not NULL, incremented once per lost compare-and-swap.
+ * @return The 0-based seat index claimed, or -1 if no seat is free.
+ */
+int claimFirstFreeSeat(struct Trip *trip, int from, int to, long *retries) {
+    while (1) {
+        uint64_t free_seats = ~busySeats(trip, from, to) & ALL_SEATS_MASK;
+        if (free_seats == 0) {
+            return -1;
+        }
+        uint64_t bit = free_seats & -free_seats; // Lowest free seat
+        if (claimSeats(trip, bit, from, to, retries)) {
+            return __builtin_ctzll(bit);
+        }
+        if (retries != NULL) {
+            (*retries)++; // Someone took it first; look again
+        }
+    }
+}
+
+/**
+ * @brief Atomically frees every seat in a mask on every leg in [from, to).
+ * @return 1 if all of them were booked before, 0 otherwise. When two agents
+ * release the same seat, at most one of them sees 1.
+ */
+int releaseSeats(struct Trip *trip, uint64_t mask, int from, int to) {
+    int was_booked = 1;
+    for (int l = from; l < to; l++) {
+        uint64_t old = atomic_fetch_and(&trip->legs[l], ~mask);
+        if ((old & mask) != mask) {
+            was_booked = 0;
+        }
+    }
+    return was_booked;
+}
+
+/**
+ * @brief Finds every seat where a run of 'count' adjacent free seats starts.
+ * The run test is done on the whole word at once: AND-ing the free mask with
+ * itself shifted by 1, 2, 4, ... seats leaves a bit set only where the next
+ * 'count' seats are all free. A group that fits in a row must stay in one
+ * row; a larger group must start at the beginning of a row.
+ * @return Bit i set = seats i .. i + count - 1 are free and allowed.
+ */
+uint64_t adjacentRunStarts(uint64_t free_seats, int count) {
+    uint64_t starts = free_seats & ALL_SEATS_MASK;
+    int covered = 1;
+    while (covered * 2 <= count) {
+        starts &= starts >> covered;
+        covered *= 2;
+    }
+    if (covered < count) {
+        starts &= starts >> (count - covered);
+    }
+
+    // One bit at the start of every row, e.g. 0x11111111 for 8 rows of 4
+    uint64_t row_starts = ALL_SEATS_MASK / ((1ULL << SEATS_PER_ROW) - 1);
+    uint64_t allowed = row_starts;
+    for (int offset = 1; offset <= SEATS_PER_ROW - count; offset++) {
+        allowed |= row_starts << offset;
+    }
+    return starts & allowed;
+}
+
+/**
+ * @brief Atomically books 'count' adjacent seats free on every leg in
+ * [from, to), choosing the lowest-numbered run. All seats are claimed with
+ * one compare-and-swap per leg, so the group is never left half-booked.
+ * @param retries If not NULL, incremented once per lost compare-and-swap.
+ * @return The 0-based index of the first seat, or -1 if no run is free.
+ */
+int claimAdjacentSeats(struct Trip *trip, int count, int from, int to, long *retries) {
+    if (count < 1 || count > TOTAL_SEATS) {
+        return -1;
+    }
+    uint64_t run = count == 64 ? ~0ULL : (1ULL << count) - 1;
+    while (1) {
+        uint64_t starts = adjacentRunStarts(~busySeats(trip, from, to), count);
+        if (starts == 0) {
+            return -1;
+        }
+        int first = __builtin_ctzll(starts);
+        if (claimSeats(trip, run << first, from, to, retries)) {
+            return first;
+        }
+        if (retries != NULL) {
+            (*retries)++; // Someone took part of the run first; look again
+        }
+    }
+}
+
+/**
+ * @brief Stores the passenger of a seat the caller has already claimed,
+ * publishes it as the booking that starts at 'from', counts it as a sale
+ * and logs it as 'op'. With op 0 (a booking restored from disk) it is
+ * neither counted nor logged.
+ * @return The booking id, or -1 if out of memory (the seat stays claimed).
+ */
+static int publishBooking(struct TripInventory *inv, int trip_id, int seat, int from, int to,
+                          const char *name, uint64_t reference, int op, uint64_t request) {
+    _Atomic uint32_t *starts = getSeatStarts(inv, trip_id, 1);
+    int id = starts ? allocBooking(inv) : -1;
+    if (id == -1) {
+        return -1;
+    }
+    struct Booking *b = getBooking(inv, id);
+    b->trip_id = trip_id;
+    b->seat = (unsigned char)seat;
+    b->from_stop = (unsigned char)from;
+    b->to_stop = (unsigned char)to;
+    strncpy(b->name, name, NAME_LEN - 1);
+    b->name[NAME_LEN - 1] = 0;
+    b->reference = newReference(reference);
+    if (!indexBooking(inv, id)) {
+        return -1; // The record is simply never published
+    }
+
+    struct Trip *trip = getTrip(inv, trip_id);
+    int legs = trip->num_stops - 1;
+    atomic_store(&starts[seat * legs + from], (uint32_t)id + 1);
+
+    // Counted and logged while the seat is still held, so the journal order
+    // of a booking and a later cancellation of it always matches reality.
+    if (op == 0) {
+        return id;
+    }
+    countSale(inv, trip_id, seat);
+    if (inv->journal != NULL) {
+        struct JournalRecord rec = {.ref = request, .booking_ref = b->reference, .key = trip->key,
+                                    .op = (unsigned char)op, .seat = b->seat,
+                                    .from_stop = b->from_stop, .to_stop = b->to_stop};
+        memcpy(rec.name, b->name, NAME_LEN);
+        journalAppend(inv->journal, &rec);
+    }
+    return id;
+}
+
+/**
+ * @brief Stores the passenger of a seat the caller has already claimed and
+ * publishes it as the booking that starts at 'from'.
+ * @return The booking id, or -1 if out of memory (the seat stays claimed).
+ */
+int recordBooking(struct TripInventory *inv, int trip_id, int seat, int from, int to, const char *name) {
+    return publishBooking(inv, trip_id, seat, from, to, name, 0, JOURNAL_BOOK, 0);
+}
+
+/**
+ * @brief Cancels the booking of a seat that starts at stop 'from'. The
+ * start entry is taken with an atomic exchange, so when two agents cancel
+ * the same booking only one of them succeeds.
+ * @return The id of the canceled booking, or -1 if there was none.
+ */
+int cancelSeat(struct TripInventory *inv, int trip_id, int seat, int from) {
+    _Atomic uint32_t *starts = getSeatStarts(inv, trip_id, 0);
+    if (starts == NULL) {
+        return -1;
+    }
+    struct Trip *trip = getTrip(inv, trip_id);
+    uint32_t entry = atomic_exchange(&starts[seat * (trip->num_stops - 1) + from], 0);
+    if (entry == 0) {
+        return -1;
+    }
+    struct Booking *b = getBooking(inv, entry - 1);
+    unindexBooking(inv, entry - 1);
+    countCancellation(inv, trip_id);
+    // Logged before the seat is released, so a rebooking of it can never
+    // appear in the journal ahead of this cancellation.
+    if (inv->journal != NULL) {
+        struct JournalRecord rec = {.booking_ref = b->reference, .key = trip->key, .op = JOURNAL_CANCEL,
+                                    .seat = b->seat, .from_stop = b->from_stop, .to_stop = b->to_stop};
+        journalAppend(inv->journal, &rec);
+    }
+    releaseSeats(trip, 1ULL << seat, b->from_stop, b->to_stop);
+    return entry - 1;
+}
+
+/**
+ * @brief Collects the ids of all bookings on a trip, ordered by seat and
+ * then by origin stop. Only seats busy on some leg are visited.
+ * @param booking_ids Room for TOTAL_SEATS * (MAX_STOPS - 1) ids.
+ * @return The number of bookings found.
+ */
+int listTripBookings(struct TripInventory *inv, int trip_id, int *booking_ids) {
+    _Atomic uint32_t *starts = getSeatStarts(inv, trip_id, 0);
+    if (starts == NULL) {
+        return 0;
+    }
+    struct Trip *trip = getTrip(inv, trip_id);
+    int legs = trip->num_stops - 1;
+    int count = 0;
+    for (uint64_t seats = busySeats(trip, 0, legs); seats != 0; seats &= seats - 1) {
+        int seat = __builtin_ctzll(seats);
+        for (int l = 0; l < legs; l++) {
+            uint32_t entry = atomic_load(&starts[seat * legs + l]);
+            if (entry != 0) {
+                booking_ids[count++] = entry - 1;
+            }
+        }
+    }
+    return count;
+}
+
+// --- Passenger Lookup ---
+
+// Crockford base 32: no I, L, O or U, so references read well over the phone
+static const char reference_digits[] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+
+#define REFERENCE_BITS (REFERENCE_LEN * 5)
+#define REFERENCE_MASK ((1ULL << REFERENCE_BITS) - 1)
+#define REFERENCE_MUL1 0x9E3779B97F4A7C15ULL
+#define REFERENCE_MUL2 0xC2B2AE3D27D4EB4FULL
+
+/**
+ * @brief Inverse of an odd number modulo 2^64 (Newton's iteration).
+ */
+static uint64_t oddInverse(uint64_t a) {
+    uint64_t x = a; // Correct to 3 bits; each step doubles that
+    for (int i = 0; i < 5; i++) {
+        x *= 2 - a * x;
+    }
+    return x;
+}
+
+/**
+ * @brief Scrambles a sequence number into a reference. Every step is a
+ * bijection on 40 bits, so distinct sequence numbers give distinct
+ * references without any collision check, yet they do not look sequential.
+ */
+static uint64_t mixReference(uint64_t seq) {
+    uint64_t x = (seq * REFERENCE_MUL1) & REFERENCE_MASK;
+    x ^= x >> (REFERENCE_BITS / 2);
+    x = (x * REFERENCE_MUL2) & REFERENCE_MASK;
+    x ^= x >> (REFERENCE_BITS / 2);
+    return x;
+}
+
+static uint64_t unmixReference(uint64_t x) {
+    x ^= x >> (REFERENCE_BITS / 2); // Self-inverse for a shift of half the width
+    x = (x * oddInverse(REFERENCE_MUL2)) & REFERENCE_MASK;
+    x ^= x >> (REFERENCE_BITS / 2);
+    return (x * oddInverse(REFERENCE_MUL1)) & REFERENCE_MASK;
+}
+
+/**
+ * @brief Returns a fresh booking reference, or keeps a restored one and
+ * makes sure it is never handed out again.
+ */
+static uint64_t newReference(uint64_t reference) {
+    if (reference == 0) {
+        return mixReference(atomic_fetch_add(&next_reference, 1));
+    }
+    uint64_t seq = unmixReference(reference);
+    uint64_t next = atomic_load(&next_reference);
+    while (next <= seq && !atomic_compare_exchange_weak(&next_reference, &next, seq + 1));
+    return reference;
+}
+
+/**
+ * @brief Writes a reference as REFERENCE_LEN characters plus a terminator.
+ */
+void formatReference(uint64_t reference, char *out) {
+    for (int i = REFERENCE_LEN - 1; i >= 0; i--) {
+        out[i] = reference_digits[reference & 31];
+        reference >>= 5;
+    }
+    out[REFERENCE_LEN] = '\0';
+}
+
+/**
+ * @brief Reads a reference typed by a person: case-insensitive, dashes and
+ * spaces ignored, and I/L/O read as 1/1/0.
+ * @return 1 on success, 0 if it is not a valid reference.
+ */
+int parseReference(const char *text, uint64_t *reference) {
+    uint64_t value = 0;
+    int digits = 0;
+    for (const char *c = text; *c != '\0'; c++) {
+        int ch = toupper((unsigned char)*c);
+        if (ch == '-' || ch == ' ') {
+            continue;
+        }
+        ch = ch == 'I' || ch == 'L' ? '1' : ch == 'O' ? '0' : ch;
+        const char *digit = strchr(reference_digits, ch);
+        if (ch == '\0' || digit == NULL || ++digits > REFERENCE_LEN) {
+            return 0;
+        }
+        value = value << 5 | (uint64_t)(digit - reference_digits);
+    }
+    *reference = value;
+    return digits == REFERENCE_LEN && value != 0;
+}
+
+static uint64_t hashReference(uint64_t reference) {
+    return reference * 0x9E3779B97F4A7C15ULL;
+}
+
+/**
+ * @brief FNV-1a over the name folded to lower case, so "ann lee" and
+ * "Ann Lee" land in the same slot.
+ */
+static uint64_t hashFoldedName(const char *name) {
+    uint64_t h = 14695981039346656037ULL;
+    for (const unsigned char *c = (const unsigned char *)name; *c != '\0'; c++) {
+        h ^= (unsigned char)tolower(*c);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t referenceKeyOf(struct TripInventory *inv, int booking_id) {
+    return hashReference(getBooking(inv, booking_id)->reference);
+}
+
+static uint64_t nameKeyOf(struct TripInventory *inv, int booking_id) {
+    return hashFoldedName(getBooking(inv, booking_id)->name);
+}
+
+typedef uint64_t (*BookingHashFn)(struct TripInventory *inv, int booking_id);
+
+/**
+ * @brief Picks the shard of a lookup index that holds a hash. The top bits
+ * choose the shard and the low bits the slot inside it, so the two stay
+ * independent.
+ */
+static struct BookingIndex *indexShard(struct BookingIndex *shards, uint64_t hash) {
+    return &shards[hash >> (64 - LOOKUP_SHARD_BITS)];
+}
+
+static void indexPut(struct BookingIndex *idx, uint64_t hash, int booking_id) {
+    int mask = idx->capacity - 1;
+    int slot = (int)(hash & mask);
+    while (idx->slots[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    idx->slots[slot] = booking_id + 1;
+    idx->count++;
+}
+
+/**
+ * @brief Adds a booking, doubling the table first if it would become more
+ * than half full. Caller holds the shard's lock.
+ * @return 1 on success, 0 if out of memory.
+ */
+static int indexAdd(struct TripInventory *inv, struct BookingIndex *idx, BookingHashFn hash_of, int booking_id) {
+    if ((idx->count + 1) * 2 > idx->capacity) {
+        int *old_slots = idx->slots, old_capacity = idx->capacity;
+        idx->slots = calloc(old_capacity * 2, sizeof(int));
+        if (idx->slots == NULL) {
+            idx->slots = old_slots;
+            return 0;
+        }
+        idx->capacity = old_capacity * 2;
+        idx->count = 0;
+        for (int i = 0; i < old_capacity; i++) {
+            if (old_slots[i] != 0) {
+                indexPut(idx, hash_of(inv, old_slots[i] - 1), old_slots[i] - 1);
+            }
+        }
+        free(old_slots);
+    }
+    indexPut(idx, hash_of(inv, booking_id), booking_id);
+    return 1;
+}
+
+static int indexFindSlot(struct BookingIndex *idx, uint64_t hash, int booking_id) {
+    int mask = idx->capacity - 1;
+    for (int slot = (int)(hash & mask); idx->slots[slot] != 0; slot = (slot + 1) & mask) {
+        if (idx->slots[slot] == booking_id + 1) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Empties a slot with backward-shift deletion: later entries of the
+ * probe run move up into the hole, so no tombstones are left behind and
+ * lookups stay short however many bookings come and go.
+ * Caller holds the shard's lock.
+ */
+static void indexDeleteSlot(struct TripInventory *inv, struct BookingIndex *idx, BookingHashFn hash_of, int hole) {
+    int mask = idx->capacity - 1;
+    for (int next = (hole + 1) & mask; idx->slots[next] != 0; next = (next + 1) & mask) {
+        int home = (int)(hash_of(inv, idx->slots[next] - 1) & mask);
+        // Move the entry unless its home lies cyclically in (hole, next]
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            idx->slots[hole] = idx->slots[next];
+            hole = next;
+        }
+    }
+    idx->slots[hole] = 0;
+    idx->count--;
+}
+
+/**
+ * @brief Links a booking into the name index. Each distinct name has one
+ * slot holding the newest booking under it; the others are chained through
+ * name_prev/name_next. A popular name thus costs one slot, not a long probe
+ * run, and removing any booking of it is O(1). All bookings of a name are
+ * in the same shard, so its lock also guards the chain.
+ * Caller holds the lock of the name's shard.
+ * @return 1 on success, 0 if out of memory.
+ */
+static int indexName(struct TripInventory *inv, struct BookingIndex *idx, int booking_id) {
+    struct Booking *b = getBooking(inv, booking_id);
+    b->name_prev = b->name_next = -1;
+    int mask = idx->capacity - 1;
+    for (int slot = (int)(hashFoldedName(b->name) & mask); idx->slots[slot] != 0; slot = (slot + 1) & mask) {
+        int head = idx->slots[slot] - 1;
+        if (strcasecmp(getBooking(inv, head)->name, b->name) == 0) {
+            b->name_next = head;
+            getBooking(inv, head)->name_prev = booking_id;
+            idx->slots[slot] = booking_id + 1;
+            return 1;
+        }
+    }
+    return indexAdd(inv, idx, nameKeyOf, booking_id);
+}
+
+/**
+ * @brief Unlinks a booking from the name index. Caller holds the lock of
+ * the name's shard.
+ */
+static void unindexName(struct TripInventory *inv, struct BookingIndex *idx, int booking_id) {
+    struct Booking *b = getBooking(inv, booking_id);
+    if (b->name_prev != -1) {
+        getBooking(inv, b->name_prev)->name_next = b->name_next;
+        if (b->name_next != -1) {
+            getBooking(inv, b->name_next)->name_prev = b->name_prev;
+        }
+        return;
+    }
+    int slot = indexFindSlot(idx, nameKeyOf(inv, booking_id), booking_id);
+    if (slot == -1) {
+        return; // Not indexed
+    }
+    if (b->name_next != -1) {
+        getBooking(inv, b->name_next)->name_prev = -1;
+        idx->slots[slot] = b->name_next + 1;
+    } else {
+        indexDeleteSlot(inv, idx, nameKeyOf, slot);
+    }
+}
+
+/**
+ * @brief Removes a booking from its shard of the reference index.
+ */
+static void unindexReference(struct TripInventory *inv, int booking_id) {
+    uint64_t hash = referenceKeyOf(inv, booking_id);
+    struct BookingIndex *idx = indexShard(inv->by_reference, hash);
+    pthread_mutex_lock(&idx->lock);
+    int slot = indexFindSlot(idx, hash, booking_id);
+    if (slot != -1) {
+        indexDeleteSlot(inv, idx, referenceKeyOf, slot);
+    }
+    pthread_mutex_unlock(&idx->lock);
+}
+
+/**
+ * @brief Adds a stored booking to both lookup indexes. Only one shard lock
+ * is held at a time, so the order shards are locked in cannot deadlock.
+ * @return 1 on success, 0 if out of memory (neither index is changed).
+ */
+static int indexBooking(struct TripInventory *inv, int booking_id) {
+    struct BookingIndex *idx = indexShard(inv->by_reference, referenceKeyOf(inv, booking_id));
+    pthread_mutex_lock(&idx->lock);
+    int ok = indexAdd(inv, idx, referenceKeyOf, booking_id);
+    pthread_mutex_unlock(&idx->lock);
+    if (!ok) {
+        return 0;
+    }
+    idx = indexShard(inv->by_name, nameKeyOf(inv, booking_id));
+    pthread_mutex_lock(&idx->lock);
+    ok = indexName(inv, idx, booking_id);
+    pthread_mutex_unlock(&idx->lock);
+    if (!ok) {
+        unindexReference(inv, booking_id);
+    }
+    return ok;
+}
+
+/**
+ * @brief Removes a canceled booking from both lookup indexes.
+ */
+static void unindexBooking(struct TripInventory *inv, int booking_id) {
+    unindexReference(inv, booking_id);
+    struct BookingIndex *idx = indexShard(inv->by_name, nameKeyOf(inv, booking_id));
+    pthread_mutex_lock(&idx->lock);
+    unindexName(inv, idx, booking_id);
+    pthread_mutex_unlock(&idx->lock);
+}
+
+/**
+ * @brief Finds a live booking by its reference in expected O(1).
+ * @return The booking id, or -1 if there is none.
+ */
+int findBookingByReference(struct TripInventory *inv, uint64_t reference) {
+    uint64_t hash = hashReference(reference);
+    struct BookingIndex *idx = indexShard(inv->by_reference, hash);
+    pthread_mutex_lock(&idx->lock);
+    int mask = idx->capacity - 1, found = -1;
+    for (int slot = (int)(hash & mask); idx->slots[slot] != 0; slot = (slot + 1) & mask) {
+        if (getBooking(inv, idx->slots[slot] - 1)->reference == reference) {
+            found = idx->slots[slot] - 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&idx->lock);
+    return found;
+}
+
+/**
+ * @brief Finds all live bookings under a name, ignoring case: one probe run
+ * to the name's slot, then its chain, however many bookings exist.
+ * @return The number of matches; at most 'max_ids' of them are stored.
+ */
+int findBookingsByName(struct TripInventory *inv, const char *name, int *booking_ids, int max_ids) {
+    uint64_t hash = hashFoldedName(name);
+    struct BookingIndex *idx = indexShard(inv->by_name, hash);
+    pthread_mutex_lock(&idx->lock);
+    int mask = idx->capacity - 1, found = 0;
+    for (int slot = (int)(hash & mask); idx->slots[slot] != 0; slot = (slot + 1) & mask) {
+        int id = idx->slots[slot] - 1;
+        if (strcasecmp(getBooking(inv, id)->name, name) == 0) {
+            for (; id != -1; id = getBooking(inv, id)->name_next) {
+                if (found < max_ids) {
+                    booking_ids[found] = id;
+                }
+                found++;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&idx->lock);
+    return found;
+}
+
+// --- Waitlist ---
+
+/**
+ * @brief Returns the waitlist of a trip, optionally creating it. Creation
+ * races are settled with a compare-and-swap, as for the start tables.
+ */
+static struct Waitlist *getWaitlist(struct TripInventory *inv, int trip_id, int create) {
+    _Atomic(struct Waitlist *) *slot = &inv->waitlists[trip_id / TRIP_CHUNK_SIZE][trip_id % TRIP_CHUNK_SIZE];
+    struct Waitlist *w = atomic_load(slot);
+    if (w == NULL && create) {
+        struct Waitlist *fresh = calloc(1, sizeof(struct Waitlist));
+        if (fresh == NULL) {
+            return NULL;
+        }
+        pthread_mutex_init(&fresh->lock, NULL);
+        if (atomic_compare_exchange_strong(slot, &w, fresh)) {
+            w = fresh;
+        } else {
+            pthread_mutex_destroy(&fresh->lock);
+            free(fresh);
+        }
+    }
+    return w;
+}
+
+static void siftUp(struct HeapNode *heap, int i) {
+    struct HeapNode node = heap[i];
+    while (i > 0 && heap[(i - 1) / 2].order > node.order) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = node;
+}
+
+static void siftDown(struct HeapNode *heap, int size, int i) {
+    struct HeapNode node = heap[i];
+    while (2 * i + 1 < size) {
+        int child = 2 * i + 1;
+        if (child + 1 < size && heap[child + 1].order < heap[child].order) {
+            child++;
+        }
+        if (heap[child].order >= node.order) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = node;
+}
+
+/**
+ * @brief Adds an entry to a waitlist in O(log n). Caller holds the lock.
+ * @return 1 on success, 0 if out of memory.
+ */
+static int waitlistPush(struct Waitlist *w, const struct WaitlistEntry *entry) {
+    if (w->size == w->capacity) {
+        int new_capacity = w->capacity ? w->capacity * 2 : 64;
+        struct HeapNode *heap = realloc(w->heap, new_capacity * sizeof(*heap));
+        if (heap != NULL) {
+            w->heap = heap;
+        }
+        struct WaitlistEntry *entries = realloc(w->entries, new_capacity * sizeof(*entries));
+        if (entries != NULL) {
+            w->entries = entries;
+        }
+        uint32_t *free_slots = realloc(w->free_slots, new_capacity * sizeof(*free_slots));
+        if (free_slots != NULL) {
+            w->free_slots = free_slots;
+        }
+        if (heap == NULL || entries == NULL || free_slots == NULL) {
+            return 0;
+        }
+        // The new slots start out free, highest first so low ones are used first
+        for (int s = new_capacity - 1; s >= w->capacity; s--) {
+            w->free_slots[w->free_count++] = s;
+        }
+        w->capacity = new_capacity;
+    }
+    uint32_t slot = w->free_slots[--w->free_count];
+    w->entries[slot] = *entry;
+    w->heap[w->size].order = (uint64_t)entry->priority << 56 | entry->request;
+    w->heap[w->size].slot = slot;
+    siftUp(w->heap, w->size++);
+    return 1;
+}
+
+/**
+ * @brief Removes the heap node at position i in O(log n). Caller holds the lock.
+ */
+static void waitlistRemoveAt(struct Waitlist *w, int i) {
+    w->free_slots[w->free_count++] = w->heap[i].slot;
+    w->heap[i] = w->heap[--w->size];
+    if (i < w->size) {
+        siftDown(w->heap, w->size, i);
+        siftUp(w->heap, i);
+    }
+}
+
+/**
+ * @brief Puts a passenger on the waitlist of a trip and logs it.
+ * @param request Receives the request number (may be NULL).
+ * @return 1 on success, 0 if out of memory.
+ */
+int joinWaitlist(struct TripInventory *inv, int trip_id, int priority, int from, int to, const char *name,
+                 uint64_t *request) {
+    struct Waitlist *w = getWaitlist(inv, trip_id, 1);
+    if (w == NULL) {
+        return 0;
+    }
+    struct WaitlistEntry entry = {0, (unsigned char)priority, (unsigned char)from, (unsigned char)to, ""};
+    strncpy(entry.name, name, NAME_LEN - 1);
+
+    pthread_mutex_lock(&w->lock);
+    entry.request = atomic_fetch_add(&next_request, 1);
+    int ok = waitlistPush(w, &entry);
+    if (ok && inv->journal != NULL) {
+        struct JournalRecord rec = {.ref = entry.request, .key = getTrip(inv, trip_id)->key,
+                                    .op = JOURNAL_WAITLIST_ADD, .seat = entry.priority,
+                                    .from_stop = entry.from_stop, .to_stop = entry.to_stop};
+        memcpy(rec.name, entry.name, NAME_LEN);
+        journalAppend(inv->journal, &rec);
+    }
+    pthread_mutex_unlock(&w->lock);
+    if (ok && request != NULL) {
+        *request = entry.request;
+    }
+    return ok;
+}
+
+/**
+ * @brief Gives free seats to the head of the waitlist, in priority and
+ * request order, for as long as the head's journey fits. Each promotion is
+ * one heap pop, O(log n); the rest of the queue is never scanned. Strict
+ * order is kept: if the head does not fit, nobody behind it jumps ahead.
+ * @param booking_ids Receives the ids of new bookings (may be NULL).
+ * @return The number of passengers promoted.
+ */
+int promoteWaitlisted(struct TripInventory *inv, int trip_id, int *booking_ids, int max_ids) {
+    struct Waitlist *w = getWaitlist(inv, trip_id, 0);
+    if (w == NULL) {
+        return 0;
+    }
+    struct Trip *trip = getTrip(inv, trip_id);
+    int promoted = 0;
+    pthread_mutex_lock(&w->lock);
+    while (w->size > 0) {
+        struct WaitlistEntry *head = &w->entries[w->heap[0].slot];
+        int seat = claimFirstFreeSeat(trip, head->from_stop, head->to_stop, NULL);
+        if (seat == -1) {
+            break;
+        }
+        int id = publishBooking(inv, trip_id, seat, head->from_stop, head->to_stop, head->name, 0,
+                                JOURNAL_PROMOTE, head->request);
+        if (id == -1) {
+            releaseSeats(trip, 1ULL << seat, head->from_stop, head->to_stop);
+            break;
+        }
+        waitlistRemoveAt(w, 0);
+        if (booking_ids != NULL && promoted < max_ids) {
+            booking_ids[promoted] = id;
+        }
+        promoted++;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return promoted;
+}
+
+/**
+ * @brief Drops a waitlist request during journal replay. The request is
+ * normally the head, so this is O(log n); otherwise the heap is searched.
+ */
+static void removeWaitlistRequest(struct TripInventory *inv, int trip_id, uint64_t request) {
+    struct Waitlist *w = getWaitlist(inv, trip_id, 0);
+    if (w == NULL) {
+        return;
+    }
+    for (int i = 0; i < w->size; i++) {
+        if (w->entries[w->heap[i].slot].request == request) {
+            waitlistRemoveAt(w, i);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Checks that a date is in YYYYMMDD form with a plausible month and day.
+ */
+static int isValidDate(int date) {
+    int month = (date / 100) % 100;
+    int day = date % 100;
+    return date >= 19000101 && date <= 99991231 && month >= 1 && month <= 12 && day >= 1 && day <= 31;
+}
+
+/**
+ * @brief Makes sure a trip is selected before a seat operation.
+ * @return The selected trip, or NULL after printing an error.
+ */
+static struct Trip *requireTrip() {
+    if (current_trip == -1) {
+        printf("Error: No trip selected. Please select a trip first.\n");
+        return NULL;
+    }
+    return getTrip(&inventory, current_trip);
+}
+
+/**
+ * @brief Asks for the origin and destination stops of a journey. Direct
+ * trips have only one leg, so nothing is asked.
+ * @param from Receives the first leg (0-based).
+ * @param to Receives the leg after the last one.
+ * @return 1 if the stops are valid, 0 otherwise.
+ */
+static int askJourney(struct Trip *trip, int *from, int *to) {
+    if (trip->num_stops == 2) {
+        *from = 0;
+        *to = 1;
+        return 1;
+    }
+    int origin, destination;
+    printf("Enter origin stop (1-%d): ", trip->num_stops - 1);
+    scanf("%d", &origin);
+    while (getchar() != '\n');
+    printf("Enter destination stop (%d-%d): ", origin + 1, trip->num_stops);
+    scanf("%d", &destination);
+    while (getchar() != '\n');
+
+    if (origin < 1 || destination > trip->num_stops || origin >= destination) {
+        printf("Error: Invalid origin or destination stop.\n");
+        return 0;
+    }
+    *from = origin - 1;
+    *to = destination - 1;
+    return 1;
+}
+
+/**
+ * @brief Selects the trip that the seat operations work on, creating it if new.
+ */
+void selectTrip() {
+    struct TripKey key;
+    printf("Enter route number: ");
+    scanf("%d", &key.route_id);
+    while (getchar() != '\n');
+    printf("Enter travel date (YYYYMMDD): ");
+    scanf("%d", &key.date);
+    while (getchar() != '\n');
+    printf("Enter bus number: ");
+    scanf("%d", &key.bus_id);
+    while (getchar() != '\n');
+
+    if (key.route_id <= 0 || key.bus_id <= 0 || !isValidDate(key.date)) {
+        printf("Error: Invalid route, date or bus number.\n");
+        return;
+    }
+
+    int existed = findTrip(&inventory, key) != -1;
+    int num_stops = 2;
+    if (!existed) {
+        printf("New trip. Enter number of stops including both ends (2-%d, 2 = direct): ", MAX_STOPS);
+        scanf("%d", &num_stops);
+        while (getchar() != '\n');
+        if (num_stops < 2 || num_stops > MAX_STOPS) {
+            printf("Error: Invalid number of stops.\n");
+            return;
+        }
+    }
+
+    int id = findOrAddTrip(&inventory, key, num_stops);
+    if (id == -1) {
+        printf("Error: Could not create the trip (inventory full or out of memory).\n");
+        return;
+    }
+    current_trip = id;
+    journalCommit(&journal);
+    struct Trip *trip = getTrip(&inventory, id);
+    printf("%s trip selected: Route %d, Date %d, Bus %d (%d seats free end to end).\n",
+           existed ? "Existing" : "New", key.route_id, key.date, key.bus_id,
+           countFreeSeats(trip, 0, trip->num_stops - 1));
+}
+
+/**
+ * @brief Lists every trip in the inventory along with its free seat count.
+ */
+void listTrips() {
+    if (inventory.trip_count == 0) {
+        printf("\nNo trips have been created yet.\n");
+        return;
+    }
+    printf("\n--- All Trips ---\n");
+    printf("%-10s %-12s %-10s %-8s %-s\n", "Route", "Date", "Bus", "Stops", "Free End to End");
+    printf("-------------------------------------------------------------\n");
+    for (int id = 0; id < inventory.trip_count; id++) {
+        struct Trip *trip = getTrip(&inventory, id);
+        printf("%-10d %-12d %-10d %-8d %d/%d\n", trip->key.route_id, trip->key.date,
+               trip->key.bus_id, trip->num_stops, countFreeSeats(trip, 0, trip->num_stops - 1),
+               TOTAL_SEATS);
+    }
+    printf("-------------------------------------------------------------\n");
+}
+
+/**
+ * @brief Prints the seat map of a trip for the journey over legs [from, to).
+ */
+static void printSeatMap(struct Trip *trip, int from, int to) {
+    uint64_t busy = busySeats(trip, from, to);
+    printf("\n\n--- Bus Seat Map ---\n");
+    if (trip->num_stops > 2) {
+        printf("From stop %d to stop %d\n", from + 1, to + 1);
+    }
+    printf("[XX] = Booked, [##] = Available\n");
+    printf("-------------------------------------\n");
+    for (int i = 0; i < TOTAL_SEATS; i++) {
+        if (busy & (1ULL << i)) {
+            printf("[XX] "); // Booked seat
+        } else {
+            printf("[%02d] ", i + 1); // Available seat
+        }
+        // Newline after every row of seats
+        if ((i + 1) % SEATS_PER_ROW == 0) {
+            printf("\n");
+        }
+    }
+    printf("-------------------------------------\n");
+}
+
+/**
+ * @brief Displays a visual map of the seats of the selected trip for an
+ * origin/destination pair.
+ */
+void displaySeatMap() {
+    struct Trip *trip = requireTrip();
+    int from, to;
+    if (trip == NULL || !askJourney(trip, &from, &to)) {
+        return;
+    }
+    printSeatMap(trip, from, to);
+}
+
+/**
+ * @brief Offers a passenger who found no free seat a place on the waitlist.
+ */
+static void offerWaitlist(int from, int to) {
+    char answer[8];
+    printf("Join the waitlist for this journey? (y/n): ");
+    fgets(answer, sizeof(answer), stdin);
+    if (answer[0] != 'y' && answer[0] != 'Y') {
+        return;
+    }
+    int priority;
+    printf("Enter priority class (1 = highest, %d = standard): ", PRIORITY_CLASSES);
+    scanf("%d", &priority);
+    while (getchar() != '\n');
+    if (priority < 1 || priority > PRIORITY_CLASSES) {
+        printf("Error: Invalid priority class.\n");
+        return;
+    }
+    char name[NAME_LEN];
+    printf("Enter passenger name: ");
+    fgets(name, sizeof(name), stdin);
+    name[strcspn(name, "\n")] = 0;
+
+    uint64_t request;
+    if (!joinWaitlist(&inventory, current_trip, priority, from, to, name, &request)) {
+        printf("Error: Out of memory.\n");
+        return;
+    }
+    journalCommit(&journal);
+    printf("%s added to the waitlist (request #%llu).\n", name, (unsigned long long)request);
+}
+
+/**
+ * @brief Handles the process of booking a seat on the selected trip.
+ */
+void bookSeat() {
+    struct Trip *trip = requireTrip();
+    int from, to;
+    if (trip == NULL || !askJourney(trip, &from, &to)) {
+        return;
+    }
+    printSeatMap(trip, from, to);
+    int seat_num;
+    printf("Enter the seat number you want to book (0 for first free seat): ");
+    scanf("%d", &seat_num);
+    while (getchar() != '\n');
+
+    // The seat is claimed before asking for the name, so no other agent can
+    // sell it while this passenger is typing.
+    int index;
+    if (seat_num == 0) {
+        index = claimFirstFreeSeat(trip, from, to, NULL);
+        if (index == -1) {
+            printf("No seat is free for this journey.\n");
+            offerWaitlist(from, to);
+            return;
+        }
+        seat_num = index + 1;
+        printf("Seat %d is the first free seat.\n", seat_num);
+    } else {
+        if (seat_num < 1 || seat_num > TOTAL_SEATS) {
+            printf("Error: Invalid seat number.\n");
+            return;
+        }
+        // Bit index is seat_num - 1
+        index = seat_num - 1;
+        if (!claimSeats(trip, 1ULL << index, from, to, NULL)) {
+            printf("Error: Seat %d is already booked for part of this journey.\n", seat_num);
+            return;
+        }
+    }
+
+    char name[NAME_LEN];
+    printf("Enter passenger name for seat %d: ", seat_num);
+    fgets(name, sizeof(name), stdin);
+    name[strcspn(name, "\n")] = 0;
+
+    int id = recordBooking(&inventory, current_trip, index, from, to, name);
+    if (id == -1) {
+        releaseSeats(trip, 1ULL << index, from, to);
+        printf("Error: Out of memory.\n");
+        return;
+    }
+    if (!journalCommit(&journal)) {
+        printf("Warning: The booking could not be written to the journal.\n");
+    }
+    char reference[REFERENCE_LEN + 1];
+    formatReference(getBooking(&inventory, id)->reference, reference);
+    printf("Seat %d booked successfully for %s! Booking reference: %s\n", seat_num, name, reference);
+}
+
+/**
+ * @brief Books a group of adjacent seats on the selected trip, all or nothing.
+ */
+void bookGroup() {
+    struct Trip *trip = requireTrip();
+    int from, to;
+    if (trip == NULL || !askJourney(trip, &from, &to)) {
+        return;
+    }
+    int count;
+    printf("Enter the number of passengers in the group (1-%d): ", TOTAL_SEATS);
+    scanf("%d", &count);
+    while (getchar() != '\n');
+    if (count < 1 || count > TOTAL_SEATS) {
+        printf("Error: Invalid group size.\n");
+        return;
+    }
+
+    // Held for the whole group before any names are asked for
+    int first = claimAdjacentSeats(trip, count, from, to, NULL);
+    if (first == -1) {
+        printf("Error: No %d adjacent seats are free for this journey.\n", count);
+        return;
+    }
+    printf("Seats %d to %d are held for the group.\n", first + 1, first + count);
+
+    char references[TOTAL_SEATS][REFERENCE_LEN + 1];
+    for (int i = 0; i < count; i++) {
+        char name[NAME_LEN];
+        printf("Enter passenger name for seat %d: ", first + i + 1);
+        fgets(name, sizeof(name), stdin);
+        name[strcspn(name, "\n")] = 0;
+
+        int id = recordBooking(&inventory, current_trip, first + i, from, to, name);
+        if (id == -1) {
+            // Undo the whole group: cancel recorded seats, release the rest
+            for (int j = 0; j < i; j++) {
+                cancelSeat(&inventory, current_trip, first + j, from);
+            }
+            uint64_t rest = (count - i == 64 ? ~0ULL : (1ULL << (count - i)) - 1) << (first + i);
+            releaseSeats(trip, rest, from, to);
+            journalCommit(&journal);
+            printf("Error: Out of memory. The group booking was rolled back.\n");
+            return;
+        }
+        formatReference(getBooking(&inventory, id)->reference, references[i]);
+    }
+    // One commit, and so usually one fsync, for the whole group
+    if (!journalCommit(&journal)) {
+        printf("Warning: The booking could not be written to the journal.\n");
+    }
+    printf("Group of %d booked successfully in seats %d to %d!\n", count, first + 1, first + count);
+    for (int i = 0; i < count; i++) {
+        printf("Seat %d: booking reference %s\n", first + i + 1, references[i]);
+    }
+}
+
+/**
+ * @brief Cancels an existing booking on the selected trip.
+ */
+void cancelBooking() {
+    struct Trip *trip = requireTrip();
+    if (trip == NULL) {
+        return;
+    }
+    int seat_num, origin = 1;
+    printf("Enter the seat number to cancel booking: ");
+    scanf("%d", &seat_num);
+    while (getchar() != '\n');
+
+    if (seat_num < 1 || seat_num > TOTAL_SEATS) {
+        printf("Error: Invalid seat number.\n");
+        return;
+    }
+    if (trip->num_stops > 2) {
+        printf("Enter the origin stop of the booking (1-%d): ", trip->num_stops - 1);
+        scanf("%d", &origin);
+        while (getchar() != '\n');
+        if (origin < 1 || origin >= trip->num_stops) {
+            printf("Error: Invalid origin stop.\n");
+            return;
+        }
+    }
+
+    int id = cancelSeat(&inventory, current_trip, seat_num - 1, origin - 1);
+    if (id == -1) {
+        printf("Error: Seat %d has no booking starting at stop %d.\n", seat_num, origin);
+        return;
+    }
+    printf("Booking for seat %d by %s has been canceled.\n", seat_num, getBooking(&inventory, id)->name);
+
+    int promoted_ids[TOTAL_SEATS];
+    int promoted = promoteWaitlisted(&inventory, current_trip, promoted_ids, TOTAL_SEATS);
+    if (!journalCommit(&journal)) {
+        printf("Warning: The cancellation could not be written to the journal.\n");
+    }
+    for (int i = 0; i < promoted && i < TOTAL_SEATS; i++) {
+        struct Booking *b = getBooking(&inventory, promoted_ids[i]);
+        char reference[REFERENCE_LEN + 1];
+        formatReference(b->reference, reference);
+        printf("Waitlisted passenger %s now has seat %d (stops %d to %d), booking reference %s.\n",
+               b->name, b->seat + 1, b->from_stop + 1, b->to_stop + 1, reference);
+    }
+}
+
+/**
+ * @brief Displays a list of all currently booked seats on the selected trip.
+ */
+void displayBookedSeats() {
+    struct Trip *trip = requireTrip();
+    if (trip == NULL) {
+        return;
+    }
+    int legs = trip->num_stops - 1;
+    int multi_stop = legs > 1;
+    printf("\n--- List of Booked Seats ---\n");
+    if (multi_stop) {
+        printf("%-15s %-10s %-6s %-6s %-s\n", "Seat Number", "Reference", "From", "To", "Passenger Name");
+    } else {
+        printf("%-15s %-10s %-s\n", "Seat Number", "Reference", "Passenger Name");
+    }
+    printf("----------------------------------\n");
+    static int ids[TOTAL_SEATS * (MAX_STOPS - 1)];
+    int booked_count = listTripBookings(&inventory, current_trip, ids);
+    for (int i = 0; i < booked_count; i++) {
+        struct Booking *b = getBooking(&inventory, ids[i]);
+        char reference[REFERENCE_LEN + 1];
+        formatReference(b->reference, reference);
+        if (multi_stop) {
+            printf("%-15d %-10s %-6d %-6d %-s\n", b->seat + 1, reference, b->from_stop + 1,
+                   b->to_stop + 1, b->name);
+        } else {
+            printf("%-15d %-10s %-s\n", b->seat + 1, reference, b->name);
+        }
+    }
+    if (booked_count == 0) {
+        printf("No seats are currently booked.\n");
+    }
+    printf("----------------------------------\n");
+}
+
+/**
+ * @brief Finds bookings on any trip by booking reference or passenger name.
+ * Both searches use the lookup indexes, so they do not scan the trips.
+ */
+void findBooking() {
+    int mode;
+    printf("1. Find by booking reference\n");
+    printf("2. Find by passenger name\n");
+    printf("Enter your choice: ");
+    scanf("%d", &mode);
+    while (getchar() != '\n');
+
+    char text[NAME_LEN];
+    static int ids[MAX_NAME_MATCHES];
+    int found = 0;
+    if (mode == 1) {
+        uint64_t reference;
+        printf("Enter booking reference: ");
+        fgets(text, sizeof(text), stdin);
+        text[strcspn(text, "\n")] = 0;
+        if (!parseReference(text, &reference)) {
+            printf("Error: A booking reference has %d letters and digits.\n", REFERENCE_LEN);
+            return;
+        }
+        ids[0] = findBookingByReference(&inventory, reference);
+        found = ids[0] != -1;
+    } else if (mode == 2) {
+        printf("Enter passenger name: ");
+        fgets(text, sizeof(text), stdin);
+        text[strcspn(text, "\n")] = 0;
+        found = findBookingsByName(&inventory, text, ids, MAX_NAME_MATCHES);
+    } else {
+        printf("Invalid choice.\n");
+        return;
+    }
+    if (found == 0) {
+        printf("No booking found.\n");
+        return;
+    }
+
+    printf("\n--- Bookings Found ---\n");
+    printf("%-10s %-7s %-10s %-5s %-6s %-6s %-6s %-s\n", "Reference", "Route", "Date", "Bus",
+           "Seat", "From", "To", "Passenger Name");
+    printf("---------------------------------------------------------------------\n");
+    for (int i = 0; i < found && i < MAX_NAME_MATCHES; i++) {
+        struct Booking *b = getBooking(&inventory, ids[i]);
+        struct TripKey *key = &getTrip(&inventory, b->trip_id)->key;
+        char reference[REFERENCE_LEN + 1];
+        formatReference(b->reference, reference);
+        printf("%-10s %-7d %-10d %-5d %-6d %-6d %-6d %-s\n", reference, key->route_id, key->date,
+               key->bus_id, b->seat + 1, b->from_stop + 1, b->to_stop + 1, b->name);
+    }
+    if (found > MAX_NAME_MATCHES) {
+        printf("... and %d more.\n", found - MAX_NAME_MATCHES);
+    }
+    printf("---------------------------------------------------------------------\n");
+}
+
+static int compareHeapNodes(const void *a, const void *b) {
+    uint64_t x = ((const struct HeapNode *)a)->order, y = ((const struct HeapNode *)b)->order;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Displays the waitlist of the selected trip in promotion order.
+ */
+void displayWaitlist() {
+    if (requireTrip() == NULL) {
+        return;
+    }
+    struct Waitlist *w = getWaitlist(&inventory, current_trip, 0);
+    if (w == NULL || w->size == 0) {
+        printf("\nThe waitlist for this trip is empty.\n");
+        return;
+    }
+    pthread_mutex_lock(&w->lock);
+    // Sort a copy of the heap; the live heap is only partially ordered
+    struct HeapNode *order = malloc(w->size * sizeof(*order));
+    if (order == NULL) {
+        pthread_mutex_unlock(&w->lock);
+        printf("Error: Out of memory.\n");
+        return;
+    }
+    memcpy(order, w->heap, w->size * sizeof(*order));
+    qsort(order, w->size, sizeof(*order), compareHeapNodes);
+
+    printf("\n--- Waitlist (%d passenger(s)) ---\n", w->size);
+    printf("%-6s %-10s %-10s %-6s %-6s %-s\n", "Pos", "Request", "Priority", "From", "To", "Passenger Name");
+    printf("--------------------------------------------------------------\n");
+    for (int i = 0; i < w->size; i++) {
+        struct WaitlistEntry *e = &w->entries[order[i].slot];
+        printf("%-6d %-10llu %-10d %-6d %-6d %-s\n", i + 1, (unsigned long long)e->request,
+               e->priority, e->from_stop + 1, e->to_stop + 1, e->name);
+    }
+    printf("--------------------------------------------------------------\n");
+    pthread_mutex_unlock(&w->lock);
+    free(order);
+}
+
+// --- Booking Journal ---
+
+/**
+ * @brief FNV-1a checksum of a journal record, excluding the checksum field.
+ */
+static uint32_t journalChecksum(const struct JournalRecord *rec) {
+    const unsigned char *bytes = (const unsigned char *)rec;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(struct JournalRecord, checksum); i++) {
+        h = (h ^ bytes[i]) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Writes a whole buffer, retrying short writes.
+ * @return 1 on success, 0 on an I/O error.
+ */
+static int writeAll(int fd, const void *data, size_t size) {
+    const char *p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) {
+            return 0;
+        }
+        p += n;
+        size -= n;
+    }
+    return 1;
+}
+
+/**
+ * @brief Opens (or creates) the journal for appending.
+ * @return 1 on success, 0 if the file or buffers could not be set up.
+ */
+int openJournal(struct Journal *j, const char *path) {
+    j->pending = calloc(JOURNAL_BUFFER_RECORDS, sizeof(struct JournalRecord));
+    j->writing = calloc(JOURNAL_BUFFER_RECORDS, sizeof(struct JournalRecord));
+    j->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (j->fd == -1 || j->pending == NULL || j->writing == NULL) {
+        if (j->fd != -1) {
+            close(j->fd);
+        }
+        free(j->pending);
+        free(j->writing);
+        j->fd = -1;
+        return 0;
+    }
+    pthread_mutex_init(&j->lock, NULL);
+    pthread_cond_init(&j->changed, NULL);
+    j->pending_count = 0;
+    j->flushing = 0;
+    j->durable_lsn = j->next_lsn;
+    return 1;
+}
+
+/**
+ * @brief Writes and fsyncs the pending batch. Called with the lock held by
+ * the leader; the lock is dropped during the I/O so others can keep
+ * appending to the other buffer.
+ * @return 1 on success, 0 on an I/O error.
+ */
+static int flushPending(struct Journal *j) {
+    struct JournalRecord *batch = j->pending;
+    int count = j->pending_count;
+    uint64_t batch_lsn = j->next_lsn;
+    j->pending = j->writing;
+    j->writing = batch;
+    j->pending_count = 0;
+    j->flushing = 1;
+    pthread_mutex_unlock(&j->lock);
+
+    int ok = writeAll(j->fd, batch, count * sizeof(struct JournalRecord)) && fdatasync(j->fd) == 0;
+
+    pthread_mutex_lock(&j->lock);
+    j->flushing = 0;
+    if (ok) {
+        j->durable_lsn = batch_lsn;
+    }
+    pthread_cond_broadcast(&j->changed);
+    return ok;
+}
+
+/**
+ * @brief Assigns the next LSN to a record and queues it for the next group
+ * commit. Does not wait for the disk; call journalCommit() for that.
+ */
+void journalAppend(struct Journal *j, struct JournalRecord *rec) {
+    if (j->fd == -1) {
+        return;
+    }
+    pthread_mutex_lock(&j->lock);
+    while (j->pending_count == JOURNAL_BUFFER_RECORDS) {
+        if (j->flushing) {
+            pthread_cond_wait(&j->changed, &j->lock);
+        } else {
+            flushPending(j);
+        }
+    }
+    rec->lsn = ++j->next_lsn;
+    rec->checksum = journalChecksum(rec);
+    j->pending[j->pending_count++] = *rec;
+    j->records_since_snapshot++;
+    last_appended_lsn = rec->lsn;
+    pthread_mutex_unlock(&j->lock);
+}
+
+/**
+ * @brief Waits until every record this thread appended is on disk. If no
+ * flush is running, this thread leads one for everything queued so far;
+ * otherwise it waits for the running flush and checks again.
+ * @return 1 if the records are durable (or journaling is off), 0 on error.
+ */
+int journalCommit(struct Journal *j) {
+    if (j->fd == -1) {
+        return 1;
+    }
+    int ok = 1;
+    pthread_mutex_lock(&j->lock);
+    while (ok && j->durable_lsn < last_appended_lsn) {
+        if (j->flushing) {
+            pthread_cond_wait(&j->changed, &j->lock);
+        } else {
+            ok = flushPending(j);
+        }
+    }
+    pthread_mutex_unlock(&j->lock);
+    return ok;
+}
+
+/**
+ * @brief Flushes anything still queued and closes the journal.
+ */
+void closeJournal(struct Journal *j) {
+    if (j->fd == -1) {
+        return;
+    }
+    last_appended_lsn = j->next_lsn;
+    journalCommit(j);
+    close(j->fd);
+    pthread_mutex_destroy(&j->lock);
+    pthread_cond_destroy(&j->changed);
+    free(j->pending);
+    free(j->writing);
+    j->fd = -1;
+}
+
+// --- Snapshot Format ---
+
+// Layouts of the unversioned snapshot files (version 1). Their size was
+// never recorded, so a file is matched against each layout in turn.
+struct V1Booking {
+    int trip_id;
+    unsigned char seat, from_stop, to_stop;
+    char name[NAME_LEN];
+};
+
+struct V1ReferencedBooking {
+    uint64_t reference;
+    int trip_id;
+    unsigned char seat, from_stop, to_stop;
+    char name[NAME_LEN];
+    int name_prev, name_next;
+};
+
+struct V1WaitlistEntry {
+    uint64_t request;
+    unsigned char priority, from_stop, to_stop;
+    char name[NAME_LEN];
+};
+
+static uint32_t crc32c_table[8][256];
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+static void initCrc32c(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1; // Castagnoli, reflected
+        }
+        crc32c_table[0][i] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int i = 0; i < 256; i++) {
+            uint32_t prev = crc32c_table[k - 1][i];
+            crc32c_table[k][i] = (prev >> 8) ^ crc32c_table[0][prev & 0xFF];
+        }
+    }
+}
+
+/**
+ * @brief CRC32C, eight bytes per step ("slicing-by-8"). Pass the previous
+ * result as 'crc' to continue a running checksum, 0 to start one.
+ */
+static uint32_t crc32c(uint32_t crc, const void *data, size_t len) {
+    pthread_once(&crc32c_once, initCrc32c);
+    const unsigned char *p = data;
+    crc = ~crc;
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        word ^= crc; // Little-endian: the low byte is the first one
+        crc = crc32c_table[7][word & 0xFF] ^ crc32c_table[6][(word >> 8) & 0xFF] ^
+              crc32c_table[5][(word >> 16) & 0xFF] ^ crc32c_table[4][(word >> 24) & 0xFF] ^
+              crc32c_table[3][(word >> 32) & 0xFF] ^ crc32c_table[2][(word >> 40) & 0xFF] ^
+              crc32c_table[1][(word >> 48) & 0xFF] ^ crc32c_table[0][word >> 56];
+    }
+    for (; len > 0; p++, len--) {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p) & 0xFF];
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Returns the header size of a snapshot version. Newer versions only
+ * add fields at the end, so an older header reads as a prefix of this one.
+ */
+static uint32_t snapshotHeaderSize(uint32_t version) {
+    return version == 2   ? offsetof(struct SnapshotHeader, next_reference)
+           : version == 3 ? offsetof(struct SnapshotHeader, sales_count)
+                          : sizeof(struct SnapshotHeader);
+}
+
+static uint32_t headerCrc(struct SnapshotHeader header) {
+    header.header_crc = 0;
+    return crc32c(0, &header, header.header_size);
+}
+
+/**
+ * @brief Maps a whole file read-only.
+ * @return The mapping (size 0 gives a non-NULL dummy), or NULL if the file
+ * cannot be opened or mapped.
+ */
+static const unsigned char *mapFile(const char *path, size_t *size) {
+    static const unsigned char empty[1];
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) != 0) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    void *data = *size ? mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0) : (void *)empty;
+    close(fd); // The mapping stays valid
+    return data == MAP_FAILED ? NULL : data;
+}
+
+static void unmapFile(const unsigned char *data, size_t size) {
+    if (size > 0) {
+        munmap((void *)data, size);
+    }
+}
+
+/**
+ * @brief Converts an unversioned snapshot into version-2 records.
+ * @return 1 on success, 0 if no known layout matches the file.
+ */
+static int migrateV1Snapshot(const unsigned char *data, size_t size, struct SnapshotView *view) {
+    int trip_count, booking_count, waiting = 0;
+    if (size < sizeof(uint64_t) + sizeof(int)) {
+        return 0;
+    }
+    memcpy(&view->lsn, data, sizeof(uint64_t));
+    memcpy(&trip_count, data + sizeof(uint64_t), sizeof(int));
+    size_t pos = sizeof(uint64_t) + sizeof(int);
+    if (trip_count < 0 || (size - pos) / sizeof(struct TripRecord) < (size_t)trip_count) {
+        return 0;
+    }
+    size_t trips_pos = pos;
+    pos += (size_t)trip_count * sizeof(struct TripRecord);
+    if (size - pos < sizeof(int)) {
+        return 0;
+    }
+    memcpy(&booking_count, data + pos, sizeof(int));
+    pos += sizeof(int);
+    if (booking_count < 0) {
+        return 0;
+    }
+
+    // Bookings without references (no waitlist section, or with one), then
+    // bookings with references: pick the layout that ends exactly at EOF
+    static const size_t booking_sizes[3] = {sizeof(struct V1Booking), sizeof(struct V1Booking),
+                                            sizeof(struct V1ReferencedBooking)};
+    static const int has_waitlist[3] = {0, 1, 1};
+    const size_t pair_size = sizeof(int) + sizeof(struct V1WaitlistEntry);
+    int layout = -1;
+    for (int l = 0; l < 3 && layout == -1; l++) {
+        if ((size - pos) / booking_sizes[l] < (size_t)booking_count) {
+            continue;
+        }
+        size_t rest = size - pos - (size_t)booking_count * booking_sizes[l];
+        if (!has_waitlist[l] && rest == 0) {
+            layout = l;
+        } else if (has_waitlist[l] && rest >= sizeof(int)) {
+            memcpy(&waiting, data + size - rest, sizeof(int));
+            if (waiting >= 0 && (rest - sizeof(int)) == (size_t)waiting * pair_size) {
+                layout = l;
+            }
+        }
+    }
+    if (layout == -1) {
+        return 0;
+    }
+    if (!has_waitlist[layout]) {
+        waiting = 0;
+    }
+
+    size_t bytes = (size_t)trip_count * sizeof(struct TripRecord) +
+                   (size_t)booking_count * sizeof(struct SnapshotBooking) +
+                   (size_t)waiting * sizeof(struct SnapshotWaitlistEntry);
+    unsigned char *converted = calloc(1, bytes ? bytes : 1);
+    if (converted == NULL) {
+        return 0;
+    }
+    struct TripRecord *trips = (struct TripRecord *)converted;
+    struct SnapshotBooking *bookings = (struct SnapshotBooking *)(trips + trip_count);
+    struct SnapshotWaitlistEntry *waitlist = (struct SnapshotWaitlistEntry *)(bookings + booking_count);
+    memcpy(trips, data + trips_pos, (size_t)trip_count * sizeof(struct TripRecord));
+    for (int i = 0; i < booking_count; i++, pos += booking_sizes[layout]) {
+        struct SnapshotBooking *b = &bookings[i];
+        if (layout == 2) {
+            struct V1ReferencedBooking old;
+            memcpy(&old, data + pos, sizeof(old));
+            *b = (struct SnapshotBooking){old.reference, (uint32_t)old.trip_id, old.seat, old.from_stop,
+                                          old.to_stop, 0, "", 0};
+            memcpy(b->name, old.name, NAME_LEN);
+        } else {
+            struct V1Booking old;
+            memcpy(&old, data + pos, sizeof(old));
+            *b = (struct SnapshotBooking){0, (uint32_t)old.trip_id, old.seat, old.from_stop, old.to_stop, 0, "", 0};
+            memcpy(b->name, old.name, NAME_LEN);
+        }
+    }
+    pos += sizeof(int);
+    for (int i = 0; i < waiting; i++, pos += pair_size) {
+        int trip_id;
+        struct V1WaitlistEntry old;
+        memcpy(&trip_id, data + pos, sizeof(int));
+        memcpy(&old, data + pos + sizeof(int), sizeof(old));
+        waitlist[i] = (struct SnapshotWaitlistEntry){old.request, (uint32_t)trip_id, old.priority,
+                                                     old.from_stop, old.to_stop, 0, "", 0};
+        memcpy(waitlist[i].name, old.name, NAME_LEN);
+    }
+
+    view->version = 1;
+    view->trips = trips;
+    view->trip_count = trip_count;
+    view->bookings = bookings;
+    view->booking_count = booking_count;
+    view->waitlist = waitlist;
+    view->waitlist_count = waiting;
+    view->converted = converted;
+    return 1;
+}
+
+/**
+ * @brief Checks that a section of 'count' records of 'record_size' bytes
+ * lies inside the file, 8-byte aligned.
+ */
+static int sectionFits(uint64_t offset, uint32_t count, uint32_t record_size, uint64_t file_size) {
+    return offset % 8 == 0 && offset <= file_size && (file_size - offset) / record_size >= count;
+}
+
+/**
+ * @brief Validates a mapped snapshot and sets up a view of its records.
+ * Versioned files are checked in full (magic, version, layout, bounds and
+ * both checksums) before anything is read from them; unversioned files
+ * are converted.
+ * @param error Receives a description of what is wrong on failure.
+ * @return 1 on success, 0 if the file cannot be used, -1 if it was written
+ * by a newer version of this program.
+ */
+static int openSnapshotView(const unsigned char *data, size_t size, struct SnapshotView *view, const char **error) {
+    memset(view, 0, sizeof(*view));
+    struct SnapshotHeader header = {0};
+    uint32_t oldest_size = snapshotHeaderSize(2);
+    if (size < oldest_size || memcmp(data, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        *error = "is not a valid snapshot";
+        return migrateV1Snapshot(data, size, view);
+    }
+    memcpy(&header, data, oldest_size);
+    if (header.version > SNAPSHOT_VERSION) {
+        *error = "was written by a newer version of this program";
+        return -1;
+    }
+    if (header.version < 2 || header.header_size != snapshotHeaderSize(header.version) ||
+        header.header_size > size) {
+        *error = "has a damaged header";
+        return 0;
+    }
+    memcpy(&header, data, header.header_size); // Fields newer than the file stay zero
+    if (header.header_crc != headerCrc(header)) {
+        *error = "has a damaged header";
+        return 0;
+    }
+    if (header.file_size != size) {
+        *error = "is truncated";
+        return 0;
+    }
+    if (header.trip_size != sizeof(struct TripRecord) || header.booking_size != sizeof(struct SnapshotBooking) ||
+        header.waitlist_size != sizeof(struct SnapshotWaitlistEntry) ||
+        !sectionFits(header.trips_offset, header.trip_count, header.trip_size, size) ||
+        !sectionFits(header.bookings_offset, header.booking_count, header.booking_size, size) ||
+        !sectionFits(header.waitlist_offset, header.waitlist_count, header.waitlist_size, size) ||
+        (header.version >= 4 && (header.sales_size != sizeof(struct SnapshotTripSales) ||
+                                 header.sales_count > header.trip_count ||
+                                 !sectionFits(header.sales_offset, header.sales_count, header.sales_size, size)))) {
+        *error = "has an unknown record layout";
+        return 0;
+    }
+    if (crc32c(0, data + header.header_size, size - header.header_size) != header.body_crc) {
+        *error = "fails its checksum";
+        return 0;
+    }
+    view->lsn = header.lsn;
+    view->version = header.version;
+    view->next_reference = header.next_reference;
+    view->next_request = header.next_request;
+    view->trips = (const struct TripRecord *)(data + header.trips_offset);
+    view->trip_count = header.trip_count;
+    view->bookings = (const struct SnapshotBooking *)(data + header.bookings_offset);
+    view->booking_count = header.booking_count;
+    view->waitlist = (const struct SnapshotWaitlistEntry *)(data + header.waitlist_offset);
+    view->waitlist_count = header.waitlist_count;
+    view->sales = (const struct SnapshotTripSales *)(data + header.sales_offset);
+    view->sales_count = header.sales_count;
+    return 1;
+}
+
+static void closeSnapshotView(struct SnapshotView *view) {
+    free(view->converted);
+    memset(view, 0, sizeof(*view));
+}
+
+/**
+ * @brief Appends one record to a snapshot being written.
+ * @return 1 on success, 0 on a short write.
+ */
+static int writeSnapshotRecord(FILE *fp, const void *record, size_t size, uint32_t *crc) {
+    *crc = crc32c(*crc, record, size);
+    return fwrite(record, size, 1, fp) == 1;
+}
+
+/**
+ * @brief Flushes the current directory, so a rename into it survives a crash.
+ * @return 1 on success, 0 on an I/O error.
+ */
+static int syncDirectory() {
+    int fd = open(".", O_RDONLY);
+    if (fd == -1) {
+        return 0;
+    }
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/**
+ * @brief Writes a full snapshot to a temporary file, fsyncs it and renames
+ * it over the old one, so a crash leaves either the old or the new file.
+ * Any failed write leaves the old snapshot in place and removes the
+ * temporary file. Layout: the header, then the trip, booking, waitlist and
+ * sales history sections. Seat bitmaps and lookup indexes are rebuilt on load.
+ * @return 1 on success, 0 on an I/O error.
+ */
+static int writeSnapshot(uint64_t lsn) {
+    FILE *fp = fopen(FILENAME ".tmp", "wb");
+    if (fp == NULL) {
+        return 0;
+    }
+    struct SnapshotHeader header = {.magic = SNAPSHOT_MAGIC, .version = SNAPSHOT_VERSION,
+                                    .header_size = sizeof(struct SnapshotHeader), .lsn = lsn};
+    header.trip_size = sizeof(struct TripRecord);
+    header.booking_size = sizeof(struct SnapshotBooking);
+    header.waitlist_size = sizeof(struct SnapshotWaitlistEntry);
+    header.sales_size = sizeof(struct SnapshotTripSales);
+    header.next_reference = atomic_load(&next_reference);
+    header.next_request = atomic_load(&next_request);
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1; // Rewritten once the counts are known
+
+    uint32_t crc = 0;
+    header.trips_offset = sizeof(header);
+    header.trip_count = inventory.trip_count;
+    for (int id = 0; id < inventory.trip_count; id++) {
+        struct Trip *trip = getTrip(&inventory, id);
+        struct TripRecord record = {trip->key, trip->num_stops};
+        ok = writeSnapshotRecord(fp, &record, sizeof(record), &crc) && ok;
+    }
+
+    header.bookings_offset = header.trips_offset + (uint64_t)header.trip_count * header.trip_size;
+    for (int id = 0; id < inventory.trip_count; id++) {
+        _Atomic uint32_t *starts = getSeatStarts(&inventory, id, 0);
+        int entries = starts ? TOTAL_SEATS * (getTrip(&inventory, id)->num_stops - 1) : 0;
+        for (int e = 0; e < entries; e++) {
+            uint32_t entry = atomic_load(&starts[e]);
+            if (entry == 0) {
+                continue;
+            }
+            struct Booking *b = getBooking(&inventory, entry - 1);
+            struct SnapshotBooking record = {b->reference, (uint32_t)id, b->seat, b->from_stop, b->to_stop, 0, "", 0};
+            memcpy(record.name, b->name, NAME_LEN);
+            ok = writeSnapshotRecord(fp, &record, sizeof(record), &crc) && ok;
+            header.booking_count++;
+        }
+    }
+
+    // Waitlists in heap order. The waitlist locks are not taken: saveData
+    // holds the journal lock, and waitlist changes take the two locks in the
+    // opposite order.
+    header.waitlist_offset = header.bookings_offset + (uint64_t)header.booking_count * header.booking_size;
+    for (int id = 0; id < inventory.trip_count; id++) {
+        struct Waitlist *w = getWaitlist(&inventory, id, 0);
+        for (int i = 0; w != NULL && i < w->size; i++) {
+            struct WaitlistEntry *e = &w->entries[w->heap[i].slot];
+            struct SnapshotWaitlistEntry record = {e->request, (uint32_t)id, e->priority, e->from_stop,
+                                                   e->to_stop, 0, "", 0};
+            memcpy(record.name, e->name, NAME_LEN);
+            ok = writeSnapshotRecord(fp, &record, sizeof(record), &crc) && ok;
+            header.waitlist_count++;
+        }
+    }
+
+    header.sales_offset = header.waitlist_offset + (uint64_t)header.waitlist_count * header.waitlist_size;
+    header.sales_count = inventory.trip_count;
+    for (int id = 0; id < inventory.trip_count; id++) {
+        struct TripSales *sales = getTripSales(&inventory, id, 0);
+        struct SnapshotTripSales record = {0};
+        if (sales != NULL) {
+            record.bookings = atomic_load(&sales->bookings);
+            record.cancellations = atomic_load(&sales->cancellations);
+            for (int seat = 0; seat < TOTAL_SEATS; seat++) {
+                record.seat_rank_sum[seat] = atomic_load(&sales->seat_rank_sum[seat]);
+                record.seat_sales[seat] = atomic_load(&sales->seat_sales[seat]);
+            }
+        }
+        ok = writeSnapshotRecord(fp, &record, sizeof(record), &crc) && ok;
+    }
+
+    header.file_size = header.sales_offset + (uint64_t)header.sales_count * header.sales_size;
+    header.body_crc = crc;
+    header.header_crc = headerCrc(header);
+    ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1;
+
+    // A short write (a full disk, say) must never replace the good snapshot,
+    // since saveData empties the journal once this returns
+    ok = ok && fflush(fp) == 0 && !ferror(fp) && fsync(fileno(fp)) == 0;
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(FILENAME ".tmp", FILENAME) != 0) {
+        remove(FILENAME ".tmp");
+        return 0;
+    }
+    return syncDirectory();
+}
+
+/**
+ * @brief Saves a snapshot of every trip and empties the journal it covers.
+ * Appends are held off meanwhile, so no record can fall between the
+ * snapshot and the truncation.
+ */
+void saveData() {
+    struct Journal *j = &journal;
+    if (j->fd == -1) {
+        if (!writeSnapshot(0)) {
+            printf("Error opening file for writing.\n");
+        }
+        return;
+    }
+    pthread_mutex_lock(&j->lock);
+    while (j->flushing) {
+        pthread_cond_wait(&j->changed, &j->lock);
+    }
+    if (j->pending_count > 0) {
+        flushPending(j); // Returns with the lock held and nothing flushing
+    }
+    if (!writeSnapshot(j->next_lsn)) {
+        printf("Error: Could not write the snapshot; the journal was kept.\n");
+    } else if (ftruncate(j->fd, 0) != 0 || fdatasync(j->fd) != 0) {
+        printf("Warning: Could not truncate the journal.\n");
+    } else {
+        j->records_since_snapshot = 0;
+    }
+    pthread_mutex_unlock(&j->lock);
+}
+
+/**
+ * @brief Compacts the journal into a snapshot once it has grown long enough
+ * to slow down startup noticeably.
+ */
+static void compactJournalIfNeeded() {
+    if (journal.fd != -1 && journal.records_since_snapshot >= JOURNAL_COMPACT_RECORDS) {
+        saveData();
+    }
+}
+
+/**
+ * @brief Claims the seat of a stored booking and records it again.
+ * @param op The journal operation when replaying a sale made after the
+ * snapshot, so it joins the sales history; 0 if it is already there.
+ * @return 1 on success, 0 if the record is invalid or clashes with another.
+ */
+static int restoreBooking(const struct Booking *b, int op) {
+    if (b->trip_id < 0 || b->trip_id >= inventory.trip_count || b->seat >= TOTAL_SEATS) {
+        return 0;
+    }
+    struct Trip *trip = getTrip(&inventory, b->trip_id);
+    if (b->from_stop >= b->to_stop || b->to_stop >= trip->num_stops) {
+        return 0;
+    }
+    if (!claimSeats(trip, 1ULL << b->seat, b->from_stop, b->to_stop, NULL)) {
+        return 0;
+    }
+    char name[NAME_LEN];
+    memcpy(name, b->name, NAME_LEN);
+    name[NAME_LEN - 1] = 0;
+    uint64_t reference = b->reference & REFERENCE_MASK; // 0 for older records: a new one is made
+    return publishBooking(&inventory, b->trip_id, b->seat, b->from_stop, b->to_stop, name,
+                          reference, op, 0) != -1;
+}
+
+/**
+ * @brief Puts a stored waitlist entry back on its trip's waitlist.
+ * @return 1 on success, 0 if the entry is invalid or out of memory.
+ */
+static int restoreWaitlistEntry(int trip_id, const struct WaitlistEntry *e) {
+    if (trip_id < 0 || trip_id >= inventory.trip_count || e->priority < 1 ||
+        e->priority > PRIORITY_CLASSES || e->from_stop >= e->to_stop ||
+        e->to_stop >= getTrip(&inventory, trip_id)->num_stops) {
+        return 0;
+    }
+    struct Waitlist *w = getWaitlist(&inventory, trip_id, 1);
+    struct WaitlistEntry copy = *e;
+    copy.name[NAME_LEN - 1] = 0;
+    if (w == NULL || !waitlistPush(w, &copy)) {
+        return 0;
+    }
+    // Keep request numbers unique after a restart
+    if (copy.request >= atomic_load(&next_request)) {
+        atomic_store(&next_request, copy.request + 1);
+    }
+    return 1;
+}
+
+/**
+ * @brief Applies every journal record newer than the snapshot. Replay is
+ * idempotent: a booking already in the snapshot fails to claim its seat
+ * and is skipped, and a cancellation of a missing booking does nothing, so
+ * neither is counted twice in the sales history.
+ * A torn record at the end (crash during a write) is cut off.
+ * @return The number of records applied.
+ */
+static long replayJournal(uint64_t snapshot_lsn) {
+    FILE *fp = fopen(JOURNAL_FILENAME, "rb");
+    if (fp == NULL) {
+        journal.next_lsn = snapshot_lsn;
+        return 0;
+    }
+    long applied = 0, valid = 0;
+    uint64_t last_lsn = 0;
+    struct JournalRecord rec;
+    while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+        if (rec.checksum != journalChecksum(&rec) || rec.lsn <= last_lsn) {
+            break; // Torn or stale data: LSNs only ever increase
+        }
+        valid++;
+        last_lsn = rec.lsn;
+        if (rec.lsn <= snapshot_lsn) {
+            continue; // Already part of the snapshot (crash before truncation)
+        }
+        applied++;
+        rec.name[NAME_LEN - 1] = 0;
+        if (rec.op == JOURNAL_ADD_TRIP) {
+            if (rec.to_stop >= 2 && rec.to_stop <= MAX_STOPS) {
+                findOrAddTrip(&inventory, rec.key, rec.to_stop);
+            }
+            continue;
+        }
+        int trip_id = findTrip(&inventory, rec.key);
+        if (trip_id == -1) {
+            continue;
+        }
+        if (rec.op == JOURNAL_BOOK || rec.op == JOURNAL_PROMOTE) {
+            struct Booking b = {rec.booking_ref, trip_id, rec.seat, rec.from_stop, rec.to_stop, "", -1, -1};
+            memcpy(b.name, rec.name, NAME_LEN);
+            restoreBooking(&b, rec.op);
+            if (rec.op == JOURNAL_PROMOTE) {
+                removeWaitlistRequest(&inventory, trip_id, rec.ref);
+            }
+        } else if (rec.op == JOURNAL_WAITLIST_ADD) {
+            struct WaitlistEntry e = {rec.ref, rec.seat, rec.from_stop, rec.to_stop, ""};
+            memcpy(e.name, rec.name, NAME_LEN);
+            restoreWaitlistEntry(trip_id, &e);
+        } else if (rec.op == JOURNAL_CANCEL && rec.seat < TOTAL_SEATS &&
+                   rec.from_stop < getTrip(&inventory, trip_id)->num_stops - 1) {
+            cancelSeat(&inventory, trip_id, rec.seat, rec.from_stop);
+            if (rec.booking_ref != 0) {
+                newReference(rec.booking_ref & REFERENCE_MASK); // Its number stays used
+            }
+        }
+    }
+    fclose(fp);
+
+    // Drop a torn tail so new records are appended right after valid ones
+    if (truncate(JOURNAL_FILENAME, valid * (long)sizeof(struct JournalRecord)) != 0) {
+        printf("Warning: Could not trim the end of %s.\n", JOURNAL_FILENAME);
+    }
+    journal.next_lsn = last_lsn > snapshot_lsn ? last_lsn : snapshot_lsn;
+    journal.records_since_snapshot = valid;
+    return applied;
+}
+
+/**
+ * @brief Imports the old single-bus file as trip (route 1, bus 1) on the
+ * given date, so bookings made with earlier versions are not lost.
+ * @return 1 if the legacy file was imported, 0 otherwise.
+ */
+static int importLegacyData(int date) {
+    FILE *fp = fopen(LEGACY_FILENAME, "rb");
+    if (fp == NULL) {
+        return 0;
+    }
+    struct Seat legacy[TOTAL_SEATS];
+    size_t read_count = fread(legacy, sizeof(struct Seat), TOTAL_SEATS, fp);
+    fclose(fp);
+    if (read_count != TOTAL_SEATS) {
+        printf("Warning: %s is truncated and was not imported.\n", LEGACY_FILENAME);
+        return 0;
+    }
+
+    struct TripKey key = {1, date, 1};
+    int id = findOrAddTrip(&inventory, key, 2);
+    if (id == -1) {
+        return 0;
+    }
+    for (int i = 0; i < TOTAL_SEATS; i++) {
+        if (legacy[i].is_booked) {
+            struct Booking b = {0, id, (unsigned char)i, 0, 1, "", -1, -1};
+            memcpy(b.name, legacy[i].passenger_name, NAME_LEN);
+            restoreBooking(&b, 0);
+        }
+    }
+    current_trip = id;
+    printf("Imported single-bus data from %s as Route 1, Date %d, Bus 1.\n", LEGACY_FILENAME, date);
+    return 1;
+}
+
+/**
+ * @brief Reads the last snapshot into the inventory. The file is mapped and
+ * its records are used in place; nothing is read before it is validated.
+ * An unusable file is kept as FILENAME.corrupt and the program starts
+ * from the journal alone.
+ * @param migrated Set to 1 if the file was in an older format.
+ * @return The LSN the snapshot covers (0 if there is none).
+ */
+static uint64_t loadSnapshot(int *migrated) {
+    size_t size;
+    const unsigned char *data = mapFile(FILENAME, &size);
+    if (data == NULL) {
+        return 0;
+    }
+    struct SnapshotView view;
+    const char *error = NULL;
+    int status = openSnapshotView(data, size, &view, &error);
+    if (status != 1) {
+        unmapFile(data, size);
+        if (status == -1) {
+            printf("Error: %s %s.\n", FILENAME, error);
+            exit(1); // Saving on exit would overwrite it with less
+        }
+        rename(FILENAME, FILENAME ".corrupt");
+        printf("Error: %s %s; it was kept as %s.\n", FILENAME, error, FILENAME ".corrupt");
+        return 0;
+    }
+    *migrated = view.version < SNAPSHOT_VERSION;
+
+    for (uint32_t i = 0; i < view.trip_count; i++) {
+        const struct TripRecord *record = &view.trips[i];
+        if (record->num_stops < 2 || record->num_stops > MAX_STOPS ||
+            findOrAddTrip(&inventory, record->key, record->num_stops) != (int)i) {
+            printf("Error: %s has an invalid or duplicate trip record.\n", FILENAME);
+            break;
+        }
+    }
+    int skipped = 0;
+    for (uint32_t i = 0; i < view.booking_count; i++) {
+        const struct SnapshotBooking *record = &view.bookings[i];
+        struct Booking b = {record->reference, (int)record->trip_id, record->seat, record->from_stop,
+                            record->to_stop, "", -1, -1};
+        memcpy(b.name, record->name, NAME_LEN);
+        if (!restoreBooking(&b, 0)) {
+            skipped++;
+        }
+    }
+    for (uint32_t i = 0; i < view.waitlist_count; i++) {
+        const struct SnapshotWaitlistEntry *record = &view.waitlist[i];
+        struct WaitlistEntry e = {record->request, record->priority, record->from_stop, record->to_stop, ""};
+        memcpy(e.name, record->name, NAME_LEN);
+        if (!restoreWaitlistEntry((int)record->trip_id, &e)) {
+            skipped++;
+        }
+    }
+    for (uint32_t i = 0; i < view.sales_count && i < (uint32_t)inventory.trip_count; i++) {
+        const struct SnapshotTripSales *record = &view.sales[i];
+        if (record->bookings == 0 && record->cancellations == 0) {
+            continue;
+        }
+        struct TripSales *sales = getTripSales(&inventory, (int)i, 1);
+        if (sales == NULL) {
+            skipped++;
+            continue;
+        }
+        atomic_store(&sales->bookings, record->bookings);
+        atomic_store(&sales->cancellations, record->cancellations);
+        for (int seat = 0; seat < TOTAL_SEATS; seat++) {
+            atomic_store(&sales->seat_rank_sum[seat], record->seat_rank_sum[seat]);
+            atomic_store(&sales->seat_sales[seat], record->seat_sales[seat]);
+        }
+    }
+    // Bookings and requests that were gone by the time of the snapshot are
+    // not in it, but their numbers must still never be handed out again
+    if (view.next_reference > atomic_load(&next_reference)) {
+        atomic_store(&next_reference, view.next_reference);
+    }
+    if (view.next_request > atomic_load(&next_request)) {
+        atomic_store(&next_request, view.next_request);
+    }
+    uint64_t lsn = view.lsn;
+    closeSnapshotView(&view);
+    unmapFile(data, size);
+    if (skipped > 0) {
+        printf("Warning: %d invalid or unrestorable record(s) were skipped.\n", skipped);
+    }
+    return lsn;
+}
+
+/**
+ * @brief Rebuilds the inventory from the last snapshot plus the journal,
+ * then starts journaling. On the very first run, offers to import the old
+ * single-bus file instead.
+ */
+void loadData() {
+    FILE *snapshot = fopen(FILENAME, "rb");
+    FILE *old_journal = fopen(JOURNAL_FILENAME, "rb");
+    int first_run = snapshot == NULL && old_journal == NULL;
+    if (snapshot != NULL) {
+        fclose(snapshot);
+    }
+    if (old_journal != NULL) {
+        fclose(old_journal);
+    }
+
+    int imported = 0, migrated = 0;
+    if (first_run) {
+        FILE *legacy = fopen(LEGACY_FILENAME, "rb");
+        if (legacy != NULL) {
+            fclose(legacy);
+            int date;
+            printf("Found %s from an older version. Enter its travel date (YYYYMMDD): ", LEGACY_FILENAME);
+            scanf("%d", &date);
+            while (getchar() != '\n');
+            if (isValidDate(date)) {
+                imported = importLegacyData(date);
+            } else {
+                printf("Invalid date; the old file was left untouched.\n");
+            }
+        }
+    } else {
+        uint64_t snapshot_lsn = loadSnapshot(&migrated);
+        long replayed = replayJournal(snapshot_lsn);
+        if (replayed > 0) {
+            printf("Recovered %ld change(s) from the journal.\n", replayed);
+        }
+    }
+
+    if (!openJournal(&journal, JOURNAL_FILENAME)) {
+        printf("Warning: Could not open %s; changes are only saved on exit.\n", JOURNAL_FILENAME);
+    } else {
+        inventory.journal = &journal;
+    }
+    if (imported || migrated) {
+        saveData(); // Make the imported trip durable right away
+        if (migrated) {
+            printf("Converted %s to snapshot format version %d.\n", FILENAME, SNAPSHOT_VERSION);
+        }
+    }
+
+    if (inventory.trip_count > 0) {
+        if (current_trip == -1) {
+            current_trip = 0;
+        }
+        printf("Loaded %d trip(s) of booking data.\n", inventory.trip_count);
+    }
+    compactJournalIfNeeded();
+}
+
+// --- Concurrency Benchmark ---
+
+struct BenchShared {
+    struct Trip *trip;
+    struct TripInventory *inv;           // Full bookings go here; NULL = seat claims only
+    int trip_id;
+    _Atomic int seat_owner[TOTAL_SEATS]; // Thread id + 1 holding each seat, 0 = free
+    _Atomic int start;                   // Threads spin until this is set
+    long ops_per_thread;
+};
+
+struct BenchWorker {
+    struct BenchShared *shared;
+    int thread_id;
+    long bookings;
+    long retries;
+    long sold_out;
+    long failures; // Bookings that could not be stored (out of memory)
+    long violations;
+};
+
+/**
+ * @brief One booking agent: repeatedly claims the first free seat of the hot
+ * trip and cancels it again. Records ownership of every seat it claims so
+ * that a double booking would be detected. With an inventory, each claim is
+ * stored, indexed, looked up by reference and canceled like a real booking.
+ */
+static void *benchWorker(void *arg) {
+    struct BenchWorker *w = arg;
+    struct BenchShared *shared = w->shared;
+    int legs = shared->trip->num_stops - 1;
+    char name[NAME_LEN];
+    while (!atomic_load(&shared->start)); // Start all agents together
+
+    for (long i = 0; i < shared->ops_per_thread; i++) {
+        int seat = claimFirstFreeSeat(shared->trip, 0, legs, &w->retries);
+        if (seat == -1) {
+            w->sold_out++;
+            continue;
+        }
+        if (atomic_exchange(&shared->seat_owner[seat], w->thread_id + 1) != 0) {
+            w->violations++; // Another agent thinks it holds this seat too
+        }
+        int id = -1;
+        if (shared->inv != NULL) {
+            snprintf(name, sizeof(name), "Agent %d passenger %ld", w->thread_id, i);
+            id = recordBooking(shared->inv, shared->trip_id, seat, 0, legs, name);
+            if (id == -1) {
+                w->failures++;
+            } else if (findBookingByReference(shared->inv, getBooking(shared->inv, id)->reference) != id) {
+                w->violations++;
+            }
+        }
+        if (id != -1 || shared->inv == NULL) {
+            w->bookings++;
+        }
+        atomic_store(&shared->seat_owner[seat], 0);
+        if (id != -1) {
+            if (cancelSeat(shared->inv, shared->trip_id, seat, 0) != id) {
+                w->violations++;
+            }
+        } else if (!releaseSeats(shared->trip, 1ULL << seat, 0, legs)) {
+            w->violations++;
+        }
+    }
+    return NULL;
+}
+
+static double elapsedSeconds(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Runs N threads that book and cancel seats on the same hot trip and
+ * reports throughput, compare-and-swap retry rates and any double bookings.
+ * Either only the seat bitmaps are exercised, or the whole booking path
+ * (booking record, lookup indexes, cancellation) without the journal.
+ * Uses a private trip so the real inventory is left untouched.
+ */
+void runConcurrencyBenchmark() {
+    int mode, thread_count, prebooked;
+    long ops;
+    printf("Benchmark mode (1 = seat claims only, 2 = full bookings): ");
+    scanf("%d", &mode);
+    while (getchar() != '\n');
+    printf("Enter number of booking threads (1-%d): ", MAX_BENCH_THREADS);
+    scanf("%d", &thread_count);
+    while (getchar() != '\n');
+    printf("Enter bookings per thread: ");
+    scanf("%ld", &ops);
+    while (getchar() != '\n');
+    printf("Enter seats already sold before the run (0-%d): ", TOTAL_SEATS - 1);
+    scanf("%d", &prebooked);
+    while (getchar() != '\n');
+
+    if ((mode != 1 && mode != 2) || thread_count < 1 || thread_count > MAX_BENCH_THREADS || ops <= 0 ||
+        prebooked < 0 || prebooked >= TOTAL_SEATS ||
+        (mode == 2 && ops > (long)MAX_BOOKING_CHUNKS * BOOKING_CHUNK_SIZE / thread_count)) {
+        printf("Error: Invalid benchmark parameters.\n");
+        return;
+    }
+
+    // A nearly sold-out trip concentrates every agent on the same few seats
+    struct Trip hot_trip;
+    struct TripInventory *bench_inv = NULL;
+    struct Trip *trip = &hot_trip;
+    int trip_id = -1;
+    if (mode == 2) {
+        bench_inv = malloc(sizeof(struct TripInventory));
+        if (bench_inv == NULL) {
+            printf("Error: Out of memory.\n");
+            return;
+        }
+        initInventory(bench_inv);
+        trip_id = findOrAddTrip(bench_inv, (struct TripKey){1, 20000101, 1}, 2);
+        if (trip_id == -1) {
+            printf("Error: Out of memory.\n");
+            freeInventory(bench_inv);
+            free(bench_inv);
+            return;
+        }
+        trip = getTrip(bench_inv, trip_id);
+    } else {
+        initTripLegs(&hot_trip, 2);
+    }
+    atomic_store(&trip->legs[0], (1ULL << prebooked) - 1);
+    struct BenchShared *shared = calloc(1, sizeof(struct BenchShared));
+    struct BenchWorker *workers = calloc(thread_count, sizeof(struct BenchWorker));
+    pthread_t *threads = calloc(thread_count, sizeof(pthread_t));
+    if (shared == NULL || workers == NULL || threads == NULL) {
+        printf("Error: Out of memory.\n");
+        free(shared);
+        free(workers);
+        free(threads);
+        if (bench_inv != NULL) {
+            freeInventory(bench_inv);
+            free(bench_inv);
+        }
+        return;
+    }
+    shared->trip = trip;
+    shared->inv = bench_inv;
+    shared->trip_id = trip_id;
+    shared->ops_per_thread = ops;
+
+    int started = 0;
+    for (; started < thread_count; started++) {
+        workers[started].shared = shared;
+        workers[started].thread_id = started;
+        if (pthread_create(&threads[started], NULL, benchWorker, &workers[started]) != 0) {
+            printf("Warning: Only %d thread(s) could be started.\n", started);
+            break;
+        }
+    }
+
+    struct timespec t_start, t_end;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    atomic_store(&shared->start, 1);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+    long bookings = 0, retries = 0, sold_out = 0, failures = 0, violations = 0;
+    for (int i = 0; i < started; i++) {
+        bookings += workers[i].bookings;
+        retries += workers[i].retries;
+        sold_out += workers[i].sold_out;
+        failures += workers[i].failures;
+        violations += workers[i].violations;
+    }
+    double seconds = elapsedSeconds(t_start, t_end);
+    uint64_t expected_left = (1ULL << prebooked) - 1;
+
+    printf("\n--- Concurrency Benchmark Results ---\n");
+    printf("Mode:                  %s\n", mode == 2 ? "full bookings" : "seat claims only");
+    printf("Threads:               %d\n", started);
+    printf("Free seats at start:   %d\n", TOTAL_SEATS - prebooked);
+    printf("Bookings:              %ld\n", bookings);
+    printf("Sold-out attempts:     %ld\n", sold_out);
+    if (mode == 2) {
+        printf("Out of memory:         %ld\n", failures);
+    }
+    printf("Elapsed:               %.3f s\n", seconds);
+    printf("Bookings/sec:          %.0f\n", seconds > 0 ? bookings / seconds : 0.0);
+    printf("CAS retries:           %ld (%.3f per booking)\n", retries,
+           bookings > 0 ? (double)retries / bookings : 0.0);
+    printf("Double bookings:       %ld\n", violations);
+    printf("Final bitmap intact:   %s\n",
+           atomic_load(&trip->legs[0]) == expected_left ? "yes" : "NO");
+    printf("-------------------------------------\n");
+
+    free(shared);
+    free(workers);
+    free(threads);
+    if (bench_inv != NULL) {
+        freeInventory(bench_inv);
+        free(bench_inv);
+    }
+}
+
+// --- Trace Replay and Latency Harness ---
+
+enum TraceOpType {
+    TRACE_BOOK = 0,   // "B <trip> <from> <to>": bookSeat() with the first free seat
+    TRACE_CANCEL = 1, // "C <trip> <seat> <from>": cancelBooking()
+    TRACE_LIST = 2,   // "L <trip>": displayBookedSeats() without the printing
+    TRACE_OP_TYPES = 3
+};
+
+static const char *const trace_op_names[TRACE_OP_TYPES] = {"book", "cancel", "list"};
+
+// One operation of a trace. Trips, seats and stops are numbered from 0.
+struct TraceOp {
+    int trip;
+    unsigned char type;
+    unsigned char seat;
+    unsigned char from_stop;
+    unsigned char to_stop;
+};
+
+struct Trace {
+    struct TraceOp *ops;
+    long count;
+    int trips;
+    int stops;
+};
+
+/**
+ * @brief xorshift64* generator: fast, and the same seed gives the same trace.
+ */
+static uint64_t traceRandom(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static double traceUniform(uint64_t *state) {
+    return (traceRandom(state) >> 11) * (1.0 / 9007199254740992.0); // [0, 1)
+}
+
+/**
+ * @brief Builds the cumulative distribution of a Zipf law over n trips:
+ * trip k is chosen with probability proportional to 1 / (k + 1)^skew.
+ * A skew of 0 gives a uniform choice.
+ */
+static double *buildZipfTable(int n, double skew) {
+    double *cdf = malloc(n * sizeof(double));
+    if (cdf == NULL) {
+        return NULL;
+    }
+    double sum = 0;
+    for (int k = 0; k < n; k++) {
+        sum += 1.0 / pow(k + 1, skew);
+        cdf[k] = sum;
+    }
+    for (int k = 0; k < n; k++) {
+        cdf[k] /= sum;
+    }
+    return cdf;
+}
+
+/**
+ * @brief Picks a trip from a Zipf table with a binary search, O(log n).
+ */
+static int zipfPick(const double *cdf, int n, double u) {
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cdf[mid] > u) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+/**
+ * @brief Creates the trips of a trace in an empty inventory. Trip i of the
+ * trace is route i + 1, so trace trip numbers are also trip ids.
+ */
+static int addTraceTrips(struct TripInventory *inv, const struct Trace *trace) {
+    for (int i = 0; i < trace->trips; i++) {
+        struct TripKey key = {i + 1, 20260101, 1};
+        if (findOrAddTrip(inv, key, trace->stops) != i) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Performs one trace operation against the reservation core, the way
+ * the menu functions do.
+ * @return 1 if the operation succeeded, 0 if there was no free seat or no
+ * such booking.
+ */
+static int applyTraceOp(struct TripInventory *inv, const struct TraceOp *op) {
+    static int ids[TOTAL_SEATS * (MAX_STOPS - 1)];
+    struct Trip *trip = getTrip(inv, op->trip);
+    if (op->type == TRACE_BOOK) {
+        int seat = claimFirstFreeSeat(trip, op->from_stop, op->to_stop, NULL);
+        if (seat == -1) {
+            return 0;
+        }
+        if (recordBooking(inv, op->trip, seat, op->from_stop, op->to_stop, "Trace passenger") == -1) {
+            releaseSeats(trip, 1ULL << seat, op->from_stop, op->to_stop);
+            return 0;
+        }
+        return 1;
+    }
+    if (op->type == TRACE_CANCEL) {
+        if (cancelSeat(inv, op->trip, op->seat, op->from_stop) == -1) {
+            return 0;
+        }
+        promoteWaitlisted(inv, op->trip, NULL, 0);
+        return 1;
+    }
+    int count = listTripBookings(inv, op->trip, ids);
+    volatile size_t chars = 0; // Touch every name, as printing them would
+    for (int i = 0; i < count; i++) {
+        chars += strlen(getBooking(inv, ids[i])->name);
+    }
+    return count > 0;
+}
+
+/**
+ * @brief Generates a trace. Operations are simulated on a scratch inventory
+ * while generating, so that every cancellation names a booking that exists
+ * at that point of the trace.
+ * @return 1 on success, 0 if out of memory.
+ */
+static int generateTrace(struct Trace *trace, double skew, int book_pct, int list_pct, uint64_t seed) {
+    static int ids[TOTAL_SEATS * (MAX_STOPS - 1)];
+    struct TripInventory *scratch = malloc(sizeof(struct TripInventory));
+    double *cdf = buildZipfTable(trace->trips, skew);
+    trace->ops = malloc(trace->count * sizeof(struct TraceOp));
+    if (scratch == NULL || cdf == NULL || trace->ops == NULL) {
+        free(scratch);
+        free(cdf);
+        free(trace->ops);
+        trace->ops = NULL;
+        return 0;
+    }
+    initInventory(scratch);
+    int ok = addTraceTrips(scratch, trace);
+    uint64_t state = seed ? seed : 1;
+    int legs = trace->stops - 1;
+
+    for (long i = 0; ok && i < trace->count; i++) {
+        struct TraceOp *op = &trace->ops[i];
+        memset(op, 0, sizeof(*op));
+        op->trip = zipfPick(cdf, trace->trips, traceUniform(&state));
+        int roll = traceRandom(&state) % 100;
+        int count = 0;
+        if (roll >= book_pct + list_pct) {
+            count = listTripBookings(scratch, op->trip, ids);
+        }
+        if (roll < book_pct || (roll >= book_pct + list_pct && count == 0)) {
+            // Nothing to cancel on an empty trip: book instead
+            op->type = TRACE_BOOK;
+            op->from_stop = traceRandom(&state) % legs;
+            op->to_stop = op->from_stop + 1 + traceRandom(&state) % (legs - op->from_stop);
+        } else if (roll < book_pct + list_pct) {
+            op->type = TRACE_LIST;
+        } else {
+            struct Booking *b = getBooking(scratch, ids[traceRandom(&state) % count]);
+            op->type = TRACE_CANCEL;
+            op->seat = b->seat;
+            op->from_stop = b->from_stop;
+        }
+        applyTraceOp(scratch, op);
+    }
+    freeInventory(scratch);
+    free(scratch);
+    free(cdf);
+    if (!ok) {
+        free(trace->ops);
+        trace->ops = NULL;
+    }
+    return ok;
+}
+
+/**
+ * @brief Writes a trace as text: a header line, then one operation per line.
+ */
+static int saveTrace(const struct Trace *trace, const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        return 0;
+    }
+    fprintf(fp, "bus-trace 1 %d %d %ld\n", trace->trips, trace->stops, trace->count);
+    for (long i = 0; i < trace->count; i++) {
+        const struct TraceOp *op = &trace->ops[i];
+        if (op->type == TRACE_BOOK) {
+            fprintf(fp, "B %d %d %d\n", op->trip, op->from_stop, op->to_stop);
+        } else if (op->type == TRACE_CANCEL) {
+            fprintf(fp, "C %d %d %d\n", op->trip, op->seat, op->from_stop);
+        } else {
+            fprintf(fp, "L %d\n", op->trip);
+        }
+    }
+    return fclose(fp) == 0;
+}
+
+/**
+ * @brief Reads a trace written by saveTrace, validating every operation.
+ */
+static int loadTrace(struct Trace *trace, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("Error: Could not open %s.\n", path);
+        return 0;
+    }
+    int version;
+    if (fscanf(fp, "bus-trace %d %d %d %ld", &version, &trace->trips, &trace->stops, &trace->count) != 4 ||
+        version != 1 || trace->trips < 1 || trace->trips > MAX_TRIP_CHUNKS * TRIP_CHUNK_SIZE ||
+        trace->stops < 2 || trace->stops > MAX_STOPS || trace->count < 0) {
+        printf("Error: %s is not a bus trace.\n", path);
+        fclose(fp);
+        return 0;
+    }
+    trace->ops = malloc((trace->count ? trace->count : 1) * sizeof(struct TraceOp));
+    if (trace->ops == NULL) {
+        printf("Error: Out of memory.\n");
+        fclose(fp);
+        return 0;
+    }
+    for (long i = 0; i < trace->count; i++) {
+        struct TraceOp *op = &trace->ops[i];
+        char type;
+        int a = 0, b = 0, read = fscanf(fp, " %c %d", &type, &op->trip);
+        if (read == 2 && (type == 'B' || type == 'C')) {
+            read += fscanf(fp, "%d %d", &a, &b);
+        }
+        int legs = trace->stops - 1;
+        int valid = read >= 2 && op->trip >= 0 && op->trip < trace->trips;
+        if (valid && type == 'B') {
+            op->type = TRACE_BOOK;
+            valid = read == 4 && a >= 0 && a < b && b <= legs;
+        } else if (valid && type == 'C') {
+            op->type = TRACE_CANCEL;
+            valid = read == 4 && a >= 0 && a < TOTAL_SEATS && b >= 0 && b < legs;
+        } else if (valid && type == 'L') {
+            op->type = TRACE_LIST;
+        } else {
+            valid = 0;
+        }
+        if (!valid) {
+            printf("Error: Invalid operation %ld in %s.\n", i + 1, path);
+            free(trace->ops);
+            trace->ops = NULL;
+            fclose(fp);
+            return 0;
+        }
+        op->seat = op->type == TRACE_CANCEL ? a : 0;
+        op->from_stop = a;
+        op->to_stop = b;
+        if (op->type == TRACE_CANCEL) {
+            op->from_stop = b;
+        }
+    }
+    fclose(fp);
+    return 1;
+}
+
+static int compareLatencies(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Nearest-rank percentile of sorted latencies.
+ */
+static uint64_t percentile(const uint64_t *sorted, long n, double p) {
+    if (n == 0) {
+        return 0;
+    }
+    long rank = (long)(p * n + 0.999999999);
+    return sorted[(rank < 1 ? 1 : rank > n ? n : rank) - 1];
+}
+
+/**
+ * @brief Replays a trace against a fresh inventory, timing every operation,
+ * and prints one JSON object per operation type. The same lines are
+ * appended to BENCH_RESULTS_FILENAME so runs can be compared over time.
+ * @return 1 on success, 0 if out of memory.
+ */
+static int replayTrace(const struct Trace *trace, const char *label) {
+    struct TripInventory *inv = malloc(sizeof(struct TripInventory));
+    uint64_t *latencies[TRACE_OP_TYPES] = {0};
+    long counts[TRACE_OP_TYPES] = {0}, succeeded[TRACE_OP_TYPES] = {0};
+    uint64_t busy_ns[TRACE_OP_TYPES] = {0}; // Time spent inside each operation type
+    for (int t = 0; t < TRACE_OP_TYPES; t++) {
+        latencies[t] = malloc((trace->count ? trace->count : 1) * sizeof(uint64_t));
+    }
+    if (inv == NULL || latencies[TRACE_BOOK] == NULL || latencies[TRACE_CANCEL] == NULL ||
+        latencies[TRACE_LIST] == NULL) {
+        printf("Error: Out of memory.\n");
+        free(inv);
+        for (int t = 0; t < TRACE_OP_TYPES; t++) {
+            free(latencies[t]);
+        }
+        return 0;
+    }
+    initInventory(inv); // No journal: this measures the in-memory core
+    if (!addTraceTrips(inv, trace)) {
+        printf("Error: Could not create the trips of the trace.\n");
+        freeInventory(inv);
+        free(inv);
+        for (int t = 0; t < TRACE_OP_TYPES; t++) {
+            free(latencies[t]);
+        }
+        return 0;
+    }
+
+    struct timespec t_start, t_end, op_start, op_end;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    for (long i = 0; i < trace->count; i++) {
+        const struct TraceOp *op = &trace->ops[i];
+        clock_gettime(CLOCK_MONOTONIC, &op_start);
+        int ok = applyTraceOp(inv, op);
+        clock_gettime(CLOCK_MONOTONIC, &op_end);
+        uint64_t ns = (op_end.tv_sec - op_start.tv_sec) * 1000000000LL + (op_end.tv_nsec - op_start.tv_nsec);
+        latencies[op->type][counts[op->type]++] = ns;
+        busy_ns[op->type] += ns;
+        succeeded[op->type] += ok;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    double seconds = elapsedSeconds(t_start, t_end);
+
+    FILE *results = fopen(BENCH_RESULTS_FILENAME, "a");
+    long now = (long)time(NULL);
+    for (int t = 0; t < TRACE_OP_TYPES; t++) {
+        qsort(latencies[t], counts[t], sizeof(uint64_t), compareLatencies);
+        char line[512];
+        snprintf(line, sizeof(line),
+                 "{\"time\":%ld,\"trace\":\"%s\",\"op\":\"%s\",\"count\":%ld,\"succeeded\":%ld,"
+                 "\"ops_per_sec\":%.0f,\"p50_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu}",
+                 now, label, trace_op_names[t], counts[t], succeeded[t],
+                 busy_ns[t] > 0 ? counts[t] * 1e9 / busy_ns[t] : 0.0,
+                 (unsigned long long)percentile(latencies[t], counts[t], 0.50),
+                 (unsigned long long)percentile(latencies[t], counts[t], 0.99),
+                 (unsigned long long)percentile(latencies[t], counts[t], 0.999));
+        printf("%s\n", line);
+        if (results != NULL) {
+            fprintf(results, "%s\n", line);
+        }
+    }
+    printf("{\"time\":%ld,\"trace\":\"%s\",\"op\":\"all\",\"count\":%ld,\"ops_per_sec\":%.0f}\n",
+           now, label, trace->count, seconds > 0 ? trace->count / seconds : 0.0);
+    if (results != NULL) {
+        fclose(results);
+    }
+
+    freeInventory(inv);
+    free(inv);
+    for (int t = 0; t < TRACE_OP_TYPES; t++) {
+        free(latencies[t]);
+    }
+    return 1;
+}
+
+/**
+ * @brief Loads a trace file and replays it. Used for "--replay-trace".
+ * @return 1 on success, 0 on error.
+ */
+int replayTraceFile(const char *path) {
+    struct Trace trace;
+    if (!loadTrace(&trace, path)) {
+        return 0;
+    }
+    // The label goes into JSON, so keep only characters that need no escaping
+    char label[NAME_LEN];
+    int n = 0;
+    for (const char *c = path; *c != '\0' && n < NAME_LEN - 1; c++) {
+        if (*c != '"' && *c != '\\' && (unsigned char)*c >= ' ') {
+            label[n++] = *c;
+        }
+    }
+    label[n] = '\0';
+    int ok = replayTrace(&trace, label);
+    free(trace.ops);
+    return ok;
+}
+
+/**
+ * @brief Menu front end: generates a uniform or Zipf-skewed trace (and can
+ * save it), or replays a saved one, then reports the latencies.
+ */
+void runTraceBenchmark() {
+    int mode;
+    printf("1. Generate a new trace\n");
+    printf("2. Replay a trace file\n");
+    printf("Enter your choice: ");
+    scanf("%d", &mode);
+    while (getchar() != '\n');
+
+    char path[256];
+    if (mode == 2) {
+        printf("Enter trace file name: ");
+        fgets(path, sizeof(path), stdin);
+        path[strcspn(path, "\n")] = 0;
+        printf("\n");
+        replayTraceFile(path);
+        return;
+    }
+    if (mode != 1) {
+        printf("Invalid choice.\n");
+        return;
+    }
+
+    struct Trace trace;
+    double skew;
+    int book_pct, list_pct;
+    unsigned long long seed;
+    printf("Enter number of trips: ");
+    scanf("%d", &trace.trips);
+    while (getchar() != '\n');
+    printf("Enter number of stops per trip (2-%d): ", MAX_STOPS);
+    scanf("%d", &trace.stops);
+    while (getchar() != '\n');
+    printf("Enter number of operations: ");
+    scanf("%ld", &trace.count);
+    while (getchar() != '\n');
+    printf("Enter Zipf skew of trip popularity (0 = uniform, e.g. 1.1 = one popular trip): ");
+    scanf("%lf", &skew);
+    while (getchar() != '\n');
+    printf("Enter percentage of bookings: ");
+    scanf("%d", &book_pct);
+    while (getchar() != '\n');
+    printf("Enter percentage of booked-seat listings (the rest are cancellations): ");
+    scanf("%d", &list_pct);
+    while (getchar() != '\n');
+    printf("Enter random seed: ");
+    scanf("%llu", &seed);
+    while (getchar() != '\n');
+    printf("Save the trace to file (leave empty to skip): ");
+    fgets(path, sizeof(path), stdin);
+    path[strcspn(path, "\n")] = 0;
+
+    if (trace.trips < 1 || trace.trips > MAX_TRIP_CHUNKS * TRIP_CHUNK_SIZE || trace.stops < 2 ||
+        trace.stops > MAX_STOPS || trace.count <= 0 || skew < 0 || book_pct < 0 || list_pct < 0 ||
+        book_pct + list_pct > 100) {
+        printf("Error: Invalid trace parameters.\n");
+        return;
+    }
+    if (!generateTrace(&trace, skew, book_pct, list_pct, seed)) {
+        printf("Error: Out of memory.\n");
+        return;
+    }
+    if (path[0] != '\0' && !saveTrace(&trace, path)) {
+        printf("Warning: Could not write the trace to %s.\n", path);
+    }
+    char label[64];
+    snprintf(label, sizeof(label), "generated skew=%.2f seed=%llu", skew, seed);
+    printf("\n");
+    replayTrace(&trace, label);
+    free(trace.ops);
+}
+
+// --- Occupancy Analytics ---
+
+static const char *const weekday_names[7] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+
+// Totals for one route; load factors are kept per weekday
+struct RouteStats {
+    int route_id;
+    int used;               // Slot in use
+    double load_sum[7];     // Sum of trip load factors
+    long trips[7];
+    long bookings;          // Bookings ever made: sales histories plus journal events
+    long cancellations;
+};
+
+// One worker's partial result. Workers never share one, so no locking is
+// needed until the final merge.
+struct AnalyticsResult {
+    struct RouteStats *routes; // Open-addressing table keyed by route id
+    int route_capacity;        // Power of two
+    int route_count;
+    double seat_rank_sum[TOTAL_SEATS]; // Sum of "n-th seat sold on its trip"
+    long seat_sales[TOTAL_SEATS];
+    long files, bad_files, trips, bookings, events; // bookings: ever made, as in RouteStats
+    int out_of_memory;
+};
+
+// Columns decoded from one file before they are aggregated. Keeping each
+// field in its own array lets the aggregation loops run over tight,
+// sequential memory.
+struct TripColumns {
+    int *route;
+    unsigned char *weekday;
+    int *seat_legs_sold; // Booked seat-legs, for the load factor
+    int *capacity;       // TOTAL_SEATS * legs
+    int *sold_so_far;    // Bookings seen so far, for the fill order
+    int *cancelled;      // Cancellations in the trip's sales history
+    struct TripKey *key;
+    int count;
+    int allocated;
+    int *lookup;         // Journal files only: key hash -> row + 1
+    int lookup_capacity;
+};
+
+struct AnalyticsJob {
+    char (*paths)[512];
+    int file_count;
+    _Atomic int next_file; // Files are handed out one at a time
+    struct AnalyticsResult *results;
+};
+
+struct AnalyticsWorker {
+    struct AnalyticsJob *job;
+    int index;
+};
+
+/**
+ * @brief Day of the week of a YYYYMMDD date, 0 = Sunday (Sakamoto's method).
+ */
+static int weekdayOf(int date) {
+    static const int offsets[12] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+    int y = date / 10000, m = date / 100 % 100, d = date % 100;
+    if (m < 1 || m > 12) {
+        return 0;
+    }
+    if (m < 3) {
+        y--;
+    }
+    return (y + y / 4 - y / 100 + y / 400 + offsets[m - 1] + d) % 7;
+}
+
+static struct RouteStats *routeStats(struct AnalyticsResult *r, int route_id) {
+    if ((r->route_count + 1) * 2 > r->route_capacity) {
+        int capacity = r->route_capacity ? r->route_capacity * 2 : 64;
+        struct RouteStats *grown = calloc(capacity, sizeof(struct RouteStats));
+        if (grown == NULL) {
+            r->out_of_memory = 1;
+            return NULL;
+        }
+        for (int i = 0; i < r->route_capacity; i++) {
+            if (r->routes[i].used) {
+                int slot = (int)(hashReference((uint64_t)r->routes[i].route_id) >> 40) & (capacity - 1);
+                while (grown[slot].used) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                grown[slot] = r->routes[i];
+            }
+        }
+        free(r->routes);
+        r->routes = grown;
+        r->route_capacity = capacity;
+    }
+    int mask = r->route_capacity - 1;
+    int slot = (int)(hashReference((uint64_t)route_id) >> 40) & mask;
+    while (r->routes[slot].used && r->routes[slot].route_id != route_id) {
+        slot = (slot + 1) & mask;
+    }
+    if (!r->routes[slot].used) {
+        r->routes[slot].used = 1;
+        r->routes[slot].route_id = route_id;
+        r->route_count++;
+    }
+    return &r->routes[slot];
+}
+
+static void freeColumns(struct TripColumns *c) {
+    free(c->route);
+    free(c->weekday);
+    free(c->seat_legs_sold);
+    free(c->capacity);
+    free(c->sold_so_far);
+    free(c->cancelled);
+    free(c->key);
+    free(c->lookup);
+    memset(c, 0, sizeof(*c));
+}
+
+/**
+ * @brief Makes room for 'rows' trips in every column.
+ * @return 1 on success, 0 if out of memory.
+ */
+static int reserveColumns(struct TripColumns *c, int rows) {
+    if (rows <= c->allocated) {
+        return 1;
+    }
+    int n = c->allocated ? c->allocated : 256;
+    while (n < rows) {
+        n *= 2;
+    }
+    // Each column keeps its old block if growing it fails, so freeColumns
+    // stays correct either way
+    int *route = realloc(c->route, n * sizeof(int));
+    c->route = route ? route : c->route;
+    unsigned char *weekday = realloc(c->weekday, n);
+    c->weekday = weekday ? weekday : c->weekday;
+    int *sold = realloc(c->seat_legs_sold, n * sizeof(int));
+    c->seat_legs_sold = sold ? sold : c->seat_legs_sold;
+    int *capacity = realloc(c->capacity, n * sizeof(int));
+    c->capacity = capacity ? capacity : c->capacity;
+    int *so_far = realloc(c->sold_so_far, n * sizeof(int));
+    c->sold_so_far = so_far ? so_far : c->sold_so_far;
+    int *cancelled = realloc(c->cancelled, n * sizeof(int));
+    c->cancelled = cancelled ? cancelled : c->cancelled;
+    struct TripKey *key = realloc(c->key, n * sizeof(struct TripKey));
+    c->key = key ? key : c->key;
+    if (route == NULL || weekday == NULL || sold == NULL || capacity == NULL || so_far == NULL ||
+        cancelled == NULL || key == NULL) {
+        return 0;
+    }
+    c->allocated = n;
+    return 1;
+}
+
+static void setColumnRow(struct TripColumns *c, int row, struct TripKey key, int num_stops) {
+    c->route[row] = key.route_id;
+    c->weekday[row] = (unsigned char)weekdayOf(key.date);
+    c->seat_legs_sold[row] = 0;
+    c->capacity[row] = TOTAL_SEATS * (num_stops > 1 ? num_stops - 1 : 1);
+    c->sold_so_far[row] = 0;
+    c->cancelled[row] = 0;
+    c->key[row] = key;
+}
+
+/**
+ * @brief Finds the column row of a trip seen in a journal, adding it on
+ * first sight. Journal files may start after the trip was added, so rows
+ * are created from whatever record names the trip first.
+ * @return The row, or -1 if out of memory.
+ */
+static int journalTripRow(struct TripColumns *c, struct TripKey key) {
+    if ((c->count + 1) * 2 > c->lookup_capacity) {
+        int capacity = c->lookup_capacity ? c->lookup_capacity * 2 : 1024;
+        int *grown = calloc(capacity, sizeof(int));
+        if (grown == NULL) {
+            return -1;
+        }
+        for (int row = 0; row < c->count; row++) {
+            int slot = (int)(hashTripKey(c->key[row]) & (capacity - 1));
+            while (grown[slot] != 0) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            grown[slot] = row + 1;
+        }
+        free(c->lookup);
+        c->lookup = grown;
+        c->lookup_capacity = capacity;
+    }
+    int mask = c->lookup_capacity - 1;
+    int slot = (int)(hashTripKey(key) & mask);
+    for (; c->lookup[slot] != 0; slot = (slot + 1) & mask) {
+        if (sameTripKey(c->key[c->lookup[slot] - 1], key)) {
+            return c->lookup[slot] - 1;
+        }
+    }
+    if (!reserveColumns(c, c->count + 1)) {
+        return -1;
+    }
+    setColumnRow(c, c->count, key, 2);
+    c->lookup[slot] = c->count + 1;
+    return c->count++;
+}
+
+/**
+ * @brief Decodes a snapshot (any version) into trip columns, sums booked
+ * seat-legs and adds the sales histories (version 4 on) to the fill order.
+ * @return 1 on success, 0 if the file is not a valid snapshot.
+ */
+static int decodeSnapshot(const unsigned char *data, size_t size, struct TripColumns *c, struct AnalyticsResult *r) {
+    struct SnapshotView view;
+    const char *error;
+    if (openSnapshotView(data, size, &view, &error) != 1) {
+        return 0;
+    }
+    if (!reserveColumns(c, view.trip_count)) {
+        closeSnapshotView(&view);
+        return 0;
+    }
+    for (uint32_t i = 0; i < view.trip_count; i++) {
+        setColumnRow(c, i, view.trips[i].key, view.trips[i].num_stops);
+    }
+    c->count = view.trip_count;
+    for (uint32_t i = 0; i < view.booking_count; i++) {
+        const struct SnapshotBooking *b = &view.bookings[i];
+        if (b->trip_id < view.trip_count && b->from_stop < b->to_stop) {
+            c->seat_legs_sold[b->trip_id] += b->to_stop - b->from_stop;
+        }
+    }
+    for (uint32_t i = 0; i < view.sales_count; i++) {
+        const struct SnapshotTripSales *sales = &view.sales[i];
+        c->sold_so_far[i] = (int)sales->bookings;
+        c->cancelled[i] = (int)sales->cancellations;
+        for (int seat = 0; seat < TOTAL_SEATS; seat++) {
+            r->seat_rank_sum[seat] += sales->seat_rank_sum[seat];
+            r->seat_sales[seat] += sales->seat_sales[seat];
+        }
+    }
+    for (uint32_t i = 0; i < view.sales_count; i++) {
+        r->bookings += view.sales[i].bookings;
+    }
+    closeSnapshotView(&view);
+    return 1;
+}
+
+/**
+ * @brief Prepares the rows of a journal from its snapshot, the .dat file of
+ * the same name: each trip's fill-order count continues from the snapshot's
+ * sales history. Without a usable snapshot the journal stands alone.
+ * @param snapshot_lsn Receives the journal position the snapshot covers.
+ * @return 1 on success, 0 if out of memory.
+ */
+static int seedJournalRows(const char *journal_path, struct TripColumns *c, uint64_t *snapshot_lsn) {
+    char path[512];
+    size_t len = strlen(journal_path) - strlen(".journal");
+    if (len + strlen(".dat") >= sizeof(path)) {
+        return 1;
+    }
+    memcpy(path, journal_path, len);
+    strcpy(path + len, ".dat");
+    size_t size;
+    const unsigned char *data = mapFile(path, &size);
+    if (data == NULL) {
+        return 1;
+    }
+    struct SnapshotView view;
+    const char *error;
+    int ok = 1;
+    if (openSnapshotView(data, size, &view, &error) == 1) {
+        *snapshot_lsn = view.lsn;
+        for (uint32_t i = 0; ok && i < view.sales_count; i++) {
+            int row = journalTripRow(c, view.trips[i].key);
+            if (row == -1) {
+                ok = 0;
+            } else {
+                c->sold_so_far[row] = (int)view.sales[i].bookings;
+            }
+        }
+        closeSnapshotView(&view);
+    }
+    unmapFile(data, size);
+    return ok;
+}
+
+/**
+ * @brief Runs one file through the aggregation. Snapshots give the final
+ * load factor of each trip and, from version 4 on, its whole sales history:
+ * the order seats were sold in and the cancellations. A journal adds the
+ * events logged since its snapshot (the .dat file of the same name).
+ * Pre-trip single-bus files count as route 1 on the day they were last
+ * written.
+ */
+static void analyzeFile(const char *path, struct AnalyticsResult *r) {
+    size_t size;
+    const unsigned char *data = mapFile(path, &size);
+    struct stat st;
+    if (data == NULL || stat(path, &st) != 0) {
+        if (data != NULL) {
+            unmapFile(data, size);
+        }
+        r->bad_files++;
+        return;
+    }
+
+    struct TripColumns c = {0};
+    size_t len = strlen(path);
+    int is_journal = len > 8 && strcmp(path + len - 8, ".journal") == 0;
+    int ok = 1;
+    if (is_journal) {
+        // Event columns: walk the records in log order, after those the
+        // snapshot already covers
+        uint64_t snapshot_lsn = 0;
+        ok = seedJournalRows(path, &c, &snapshot_lsn);
+        size_t records = size / sizeof(struct JournalRecord);
+        const struct JournalRecord *rec = (const struct JournalRecord *)data;
+        for (size_t i = 0; ok && i < records; i++) {
+            if (rec[i].checksum != journalChecksum(&rec[i])) {
+                break; // Torn tail
+            }
+            if (rec[i].lsn <= snapshot_lsn) {
+                continue; // Already in the snapshot (crash before truncation)
+            }
+            r->events++;
+            int row = journalTripRow(&c, rec[i].key);
+            if (row == -1) {
+                ok = 0;
+                break;
+            }
+            struct RouteStats *rs = routeStats(r, c.route[row]);
+            if (rs == NULL) {
+                ok = 0;
+                break;
+            }
+            if ((rec[i].op == JOURNAL_BOOK || rec[i].op == JOURNAL_PROMOTE) && rec[i].seat < TOTAL_SEATS) {
+                r->seat_rank_sum[rec[i].seat] += c.sold_so_far[row]++;
+                r->seat_sales[rec[i].seat]++;
+                rs->bookings++;
+                r->bookings++;
+            } else if (rec[i].op == JOURNAL_CANCEL) {
+                rs->cancellations++;
+            }
+        }
+    } else if (size == TOTAL_SEATS * sizeof(struct Seat)) {
+        const struct Seat *legacy = (const struct Seat *)data;
+        struct tm day;
+        localtime_r(&st.st_mtime, &day);
+        struct TripKey key = {1, (day.tm_year + 1900) * 10000 + (day.tm_mon + 1) * 100 + day.tm_mday, 1};
+        ok = reserveColumns(&c, 1);
+        if (ok) {
+            setColumnRow(&c, 0, key, 2);
+            for (int i = 0; i < TOTAL_SEATS; i++) {
+                c.seat_legs_sold[0] += legacy[i].is_booked != 0;
+            }
+            c.count = 1;
+        }
+    } else if (!decodeSnapshot(data, size, &c, r)) {
+        unmapFile(data, size);
+        freeColumns(&c);
+        r->bad_files++;
+        return;
+    }
+    unmapFile(data, size);
+
+    // Column pass: fold every snapshot trip's load factor and sales history
+    // into its route
+    if (!is_journal) {
+        for (int i = 0; ok && i < c.count; i++) {
+            struct RouteStats *rs = routeStats(r, c.route[i]);
+            if (rs == NULL) {
+                ok = 0;
+                break;
+            }
+            rs->load_sum[c.weekday[i]] += (double)c.seat_legs_sold[i] / c.capacity[i];
+            rs->trips[c.weekday[i]]++;
+            rs->bookings += c.sold_so_far[i];
+            rs->cancellations += c.cancelled[i];
+        }
+        r->trips += c.count;
+    }
+    freeColumns(&c);
+    if (!ok) {
+        r->out_of_memory = 1;
+    }
+    r->files++;
+}
+
+static void *analyticsWorker(void *arg) {
+    struct AnalyticsWorker *w = arg;
+    struct AnalyticsJob *job = w->job;
+    int file;
+    while ((file = atomic_fetch_add(&job->next_file, 1)) < job->file_count) {
+        analyzeFile(job->paths[file], &job->results[w->index]);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Adds one worker's partial result into another.
+ */
+static void mergeResults(struct AnalyticsResult *into, const struct AnalyticsResult *from) {
+    for (int i = 0; i < from->route_capacity; i++) {
+        const struct RouteStats *src = &from->routes[i];
+        if (!src->used) {
+            continue;
+        }
+        struct RouteStats *dst = routeStats(into, src->route_id);
+        if (dst == NULL) {
+            return;
+        }
+        for (int d = 0; d < 7; d++) {
+            dst->load_sum[d] += src->load_sum[d];
+            dst->trips[d] += src->trips[d];
+        }
+        dst->bookings += src->bookings;
+        dst->cancellations += src->cancellations;
+    }
+    for (int s = 0; s < TOTAL_SEATS; s++) {
+        into->seat_rank_sum[s] += from->seat_rank_sum[s];
+        into->seat_sales[s] += from->seat_sales[s];
+    }
+    into->files += from->files;
+    into->bad_files += from->bad_files;
+    into->trips += from->trips;
+    into->bookings += from->bookings;
+    into->events += from->events;
+    into->out_of_memory |= from->out_of_memory;
+}
+
+static int compareRouteStats(const void *a, const void *b) {
+    const struct RouteStats *x = a, *y = b;
+    return (x->route_id > y->route_id) - (x->route_id < y->route_id);
+}
+
+static void printAnalytics(struct AnalyticsResult *r, int threads, double seconds) {
+    printf("\n--- Occupancy Analytics ---\n");
+    printf("Files: %ld (%ld unreadable), trips: %ld, bookings made: %ld, journal events: %ld\n",
+           r->files, r->bad_files, r->trips, r->bookings, r->events);
+    printf("Threads: %d, elapsed: %.3f s\n", threads, seconds);
+
+    // Compact the route table and sort it by route number
+    int n = 0;
+    for (int i = 0; i < r->route_capacity; i++) {
+        if (r->routes[i].used) {
+            r->routes[n++] = r->routes[i];
+        }
+    }
+    qsort(r->routes, n, sizeof(struct RouteStats), compareRouteStats);
+
+    printf("\nAverage load factor by route and weekday (%%):\n");
+    printf("%-7s", "Route");
+    for (int d = 0; d < 7; d++) {
+        printf(" %6s", weekday_names[d]);
+    }
+    printf(" %8s %8s\n", "Trips", "Cancel%");
+    printf("-------------------------------------------------------------------------\n");
+    for (int i = 0; i < n; i++) {
+        struct RouteStats *rs = &r->routes[i];
+        long trips = 0;
+        printf("%-7d", rs->route_id);
+        for (int d = 0; d < 7; d++) {
+            trips += rs->trips[d];
+            if (rs->trips[d] > 0) {
+                printf(" %6.1f", 100.0 * rs->load_sum[d] / rs->trips[d]);
+            } else {
+                printf(" %6s", "-");
+            }
+        }
+        if (rs->bookings > 0) {
+            printf(" %8ld %7.1f%%\n", trips, 100.0 * rs->cancellations / rs->bookings);
+        } else {
+            printf(" %8ld %8s\n", trips, "-");
+        }
+    }
+
+    printf("\nSeat fill order (average position in which each seat is sold, 1 = first):\n");
+    for (int s = 0; s < TOTAL_SEATS; s++) {
+        if (r->seat_sales[s] > 0) {
+            printf("[%5.1f] ", 1.0 + r->seat_rank_sum[s] / r->seat_sales[s]);
+        } else {
+            printf("[  -  ] ");
+        }
+        if ((s + 1) % SEATS_PER_ROW == 0) {
+            printf("\n");
+        }
+    }
+    printf("-------------------------------------------------------------------------\n");
+}
+
+/**
+ * @brief Analyzes every *.dat and *.journal file in a directory, with one
+ * worker per online CPU.
+ * @return 1 on success, 0 on error.
+ */
+int analyzeArchive(const char *dir_path) {
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL) {
+        printf("Error: Could not open directory %s.\n", dir_path);
+        return 0;
+    }
+    struct AnalyticsJob job = {0};
+    int allocated = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        int wanted = (len > 4 && strcmp(entry->d_name + len - 4, ".dat") == 0) ||
+                     (len > 8 && strcmp(entry->d_name + len - 8, ".journal") == 0);
+        if (!wanted) {
+            continue;
+        }
+        if (job.file_count == allocated) {
+            allocated = allocated ? allocated * 2 : 256;
+            char (*grown)[512] = realloc(job.paths, allocated * sizeof(*job.paths));
+            if (grown == NULL) {
+                break;
+            }
+            job.paths = grown;
+        }
+        snprintf(job.paths[job.file_count++], sizeof(*job.paths), "%s/%s", dir_path, entry->d_name);
+    }
+    closedir(dir);
+    if (job.file_count == 0) {
+        printf("No .dat or .journal files found in %s.\n", dir_path);
+        free(job.paths);
+        return 1;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus < 1 ? 1 : cpus > MAX_BENCH_THREADS ? MAX_BENCH_THREADS : (int)cpus;
+    if (threads > job.file_count) {
+        threads = job.file_count;
+    }
+    job.results = calloc(threads, sizeof(struct AnalyticsResult));
+    struct AnalyticsWorker *workers = calloc(threads, sizeof(struct AnalyticsWorker));
+    pthread_t *ids = calloc(threads, sizeof(pthread_t));
+    if (job.results == NULL || workers == NULL || ids == NULL) {
+        printf("Error: Out of memory.\n");
+        free(job.paths);
+        free(job.results);
+        free(workers);
+        free(ids);
+        return 0;
+    }
+
+    struct timespec t_start, t_end;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    int started = 0;
+    for (; started < threads; started++) {
+        workers[started].job = &job;
+        workers[started].index = started;
+        if (pthread_create(&ids[started], NULL, analyticsWorker, &workers[started]) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        workers[0].job = &job;
+        analyticsWorker(&workers[0]); // Do the work on this thread instead
+        started = 1;
+    } else {
+        for (int i = 0; i < started; i++) {
+            pthread_join(ids[i], NULL);
+        }
+    }
+    for (int i = 1; i < started; i++) {
+        mergeResults(&job.results[0], &job.results[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+    if (job.results[0].out_of_memory) {
+        printf("Warning: Ran out of memory; the figures below are incomplete.\n");
+    }
+    printAnalytics(&job.results[0], started, elapsedSeconds(t_start, t_end));
+    for (int i = 0; i < threads; i++) {
+        free(job.results[i].routes);
+    }
+    free(job.results);
+    free(workers);
+    free(ids);
+    free(job.paths);
+    return 1;
+}
+
+/**
+ * @brief Menu front end for analyzeArchive().
+ */
+void runAnalytics() {
+    char path[256];
+    printf("Enter the directory holding archived .dat and .journal files: ");
+    fgets(path, sizeof(path), stdin);
+    path[strcspn(path, "\n")] = 0;
+    analyzeArchive(path[0] != '\0' ? path : ".");
+}
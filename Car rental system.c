@@ -1,280 +1,3840 @@
-/*
- * -----------------------------------------------------------------------------
- *
- * Project: 13 - Car Rental System
- *
- * -----------------------------------------------------------------------------
- *
- * Question:
- * Create a C program to manage a small car rental business. The system
- * should keep track of the cars in the fleet and manage rentals.
- *
- * The system must support the following operations:
- * 1.  Add a new car to the fleet (Car ID, Model Name, Rent per Day).
- * 2.  Display a list of all available cars for rent.
- * 3.  Display a list of all cars in the fleet (both available and rented).
- * 4.  Rent a car: The user provides their name and the ID of the car they
- * wish to rent. The car's status is changed to "Rented".
- * 5.  Return a car: The user provides the car ID. The system calculates the
- * total rent based on the number of days it was rented and changes the
- * car's status back to "Available".
- * 6.  Save the fleet's data to a file ("cars.dat") and load it on startup.
- *
- * Concepts Covered:
- * - Inventory status management (tracking availability).
- * - Transactional logic for renting and returning items.
- * - User interaction for cost calculation.
- * - Reinforcing CRUD principles and file persistence.
- *
- * -----------------------------------------------------------------------------
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-// --- Constants ---
-#define MAX_CARS 50
-#define FILENAME "cars.dat"
-
-// --- Data Structures ---
-struct Car {
-    int id;
-    char model[100];
-    double rent_per_day;
-    int is_available; // 1 for available, 0 for rented
-    char customer_name[100]; // To store who rented the car
-};
-
-// --- Global Data ---
-struct Car fleet[MAX_CARS];
-int car_count = 0;
-
-// --- Function Prototypes ---
-void addCar();
-void displayAvailableCars();
-void displayAllCars();
-void rentCar();
-void returnCar();
-int findCarById(int id);
-void saveData();
-void loadData();
-
-int main() {
-    loadData();
-    int choice;
-
-    while (1) {
-        printf("\n\n--- Car Rental System ---\n");
-        printf("1. Add New Car to Fleet\n");
-        printf("2. Display Available Cars\n");
-        printf("3. Display All Cars\n");
-        printf("4. Rent a Car\n");
-        printf("5. Return a Car\n");
-        printf("6. Save and Exit\n");
-        printf("Enter your choice: ");
-        scanf("%d", &choice);
-        while (getchar() != '\n'); // Clear input buffer
-
-        switch (choice) {
-            case 1: addCar(); break;
-            case 2: displayAvailableCars(); break;
-            case 3: displayAllCars(); break;
-            case 4: rentCar(); break;
-            case 5: returnCar(); break;
-            case 6:
-                saveData();
-                printf("Fleet data saved. Exiting...\n");
-                exit(0);
-            default:
-                printf("Invalid choice. Please try again.\n");
-        }
-    }
-
-    return 0;
-}
-
-/**
- * @brief Adds a new car to the fleet.
- */
-void addCar() {
-    if (car_count >= MAX_CARS) {
-        printf("Fleet is at maximum capacity.\n");
-        return;
-    }
-
-    struct Car *car = &fleet[car_count];
-    printf("\n--- Add New Car ---\n");
-    printf("Enter Car ID: ");
-    scanf("%d", &car->id);
-    while (getchar() != '\n');
-
-    if (findCarById(car->id) != -1) {
-        printf("Error: A car with ID %d already exists.\n", car->id);
-        return;
-    }
-
-    printf("Enter Car Model: ");
-    fgets(car->model, sizeof(car->model), stdin);
-    car->model[strcspn(car->model, "\n")] = 0;
-
-    printf("Enter Rent per Day: ");
-    scanf("%lf", &car->rent_per_day);
-    while (getchar() != '\n');
-
-    car->is_available = 1; // New cars are available by default
-    strcpy(car->customer_name, "N/A");
-
-    car_count++;
-    printf("Car added to the fleet successfully!\n");
-}
-
-/**
- * @brief Displays only the cars that are available for rent.
- */
-void displayAvailableCars() {
-    printf("\n--- Available Cars for Rent ---\n");
-    printf("%-10s %-30s %-15s\n", "Car ID", "Model", "Rent per Day");
-    printf("------------------------------------------------------\n");
-    int available_count = 0;
-    for (int i = 0; i < car_count; i++) {
-        if (fleet[i].is_available) {
-            printf("%-10d %-30s %-15.2f\n", fleet[i].id, fleet[i].model, fleet[i].rent_per_day);
-            available_count++;
-        }
-    }
-    if (available_count == 0) {
-        printf("No cars are currently available for rent.\n");
-    }
-    printf("------------------------------------------------------\n");
-}
-
-/**
- * @brief Displays all cars in the fleet, along with their status.
- */
-void displayAllCars() {
-    if (car_count == 0) {
-        printf("\nThe fleet is empty.\n");
-        return;
-    }
-    printf("\n--- Full Fleet Status ---\n");
-    printf("%-10s %-30s %-15s %-15s %-s\n", "Car ID", "Model", "Rent per Day", "Status", "Rented By");
-    printf("----------------------------------------------------------------------------------------\n");
-    for (int i = 0; i < car_count; i++) {
-        const char* status = fleet[i].is_available ? "Available" : "Rented";
-        printf("%-10d %-30s %-15.2f %-15s %-s\n",
-               fleet[i].id, fleet[i].model, fleet[i].rent_per_day, status, fleet[i].customer_name);
-    }
-    printf("----------------------------------------------------------------------------------------\n");
-}
-
-/**
- * @brief Rents a car to a customer.
- */
-void rentCar() {
-    displayAvailableCars();
-    int id;
-    printf("\nEnter the ID of the car you want to rent: ");
-    scanf("%d", &id);
-    while (getchar() != '\n');
-
-    int index = findCarById(id);
-    if (index == -1) {
-        printf("Error: Car with ID %d not found.\n", id);
-        return;
-    }
-
-    if (!fleet[index].is_available) {
-        printf("Error: Car is already rented by %s.\n", fleet[index].customer_name);
-        return;
-    }
-
-    printf("Enter your name: ");
-    fgets(fleet[index].customer_name, sizeof(fleet[index].customer_name), stdin);
-    fleet[index].customer_name[strcspn(fleet[index].customer_name, "\n")] = 0;
-
-    fleet[index].is_available = 0; // Mark as rented
-    printf("Car ID %d has been successfully rented to %s.\n", id, fleet[index].customer_name);
-}
-
-/**
- * @brief Returns a rented car and calculates the cost.
- */
-void returnCar() {
-    int id, days;
-    printf("Enter the ID of the car you are returning: ");
-    scanf("%d", &id);
-    while (getchar() != '\n');
-
-    int index = findCarById(id);
-    if (index == -1) {
-        printf("Error: Car with ID %d not found.\n", id);
-        return;
-    }
-
-    if (fleet[index].is_available) {
-        printf("Error: This car is already marked as available.\n");
-        return;
-    }
-
-    printf("Enter the number of days the car was rented: ");
-    scanf("%d", &days);
-    while (getchar() != '\n');
-
-    if (days <= 0) {
-        printf("Invalid number of days.\n");
-        return;
-    }
-
-    double total_cost = days * fleet[index].rent_per_day;
-    printf("\n--- Return Summary ---\n");
-    printf("Car Model: %s\n", fleet[index].model);
-    printf("Rented by: %s\n", fleet[index].customer_name);
-    printf("Total Rent for %d days: $%.2f\n", days, total_cost);
-    printf("------------------------\n");
-
-    fleet[index].is_available = 1; // Mark as available again
-    strcpy(fleet[index].customer_name, "N/A");
-    printf("Car ID %d has been successfully returned.\n", id);
-}
-
-/**
- * @brief Finds a car by its ID.
- * @return Index of the car, or -1 if not found.
- */
-int findCarById(int id) {
-    for (int i = 0; i < car_count; i++) {
-        if (fleet[i].id == id) {
-            return i;
-        }
-    }
-    return -1;
-}
-
-/**
- * @brief Saves fleet data to a file.
- */
-void saveData() {
-    FILE *fp = fopen(FILENAME, "wb");
-    if (fp == NULL) {
-        printf("Error opening file for writing.\n");
-        return;
-    }
-    fwrite(fleet, sizeof(struct Car), car_count, fp);
-    fclose(fp);
-}
-
-/**
- * @brief Loads fleet data from a file.
- */
-void loadData() {
-    FILE *fp = fopen(FILENAME, "rb");
-    if (fp == NULL) {
-        return;
-    }
-    car_count = fread(fleet, sizeof(struct Car), MAX_CARS, fp);
-    fclose(fp);
-    if (car_count > 0) {
-        printf("Loaded %d car(s) from the fleet data.\n", car_count);
-    }
-}
+/*
+ * -----------------------------------------------------------------------------
+ *
+ * Project: 13 - Car Rental System
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Question:
+ * Create a C program to manage a small car rental business. The system
+ * should keep track of the cars in the fleet and manage rentals.
+ *
+ * The system must support the following operations:
+ * 1.  Add a new car to the fleet (Car ID, Model Name, Rent per Day, Vehicle
+ * Class, Branch).
+ * 2.  Display a list of all available cars for rent.
+ * 3.  Display a list of all cars in the fleet (both available and rented).
+ * 4.  Rent a car: The user provides their name, the ID of the car they
+ * wish to rent and how many days they plan to keep it. The car must not be
+ * reserved for those days. The car's status is changed to "Rented".
+ * 5.  Return a car: The user provides the car ID. The system calculates the
+ * total rent based on the number of days it was rented and changes the
+ * car's status back to "Available".
+ * 6.  Reserve a car for a future date range (pick-up and return dates).
+ * 7.  List every car that is free for a given date range.
+ * 8.  Cancel a reservation by its number.
+ * 9.  Show the reservation calendar of one car.
+ * 10. Search the available cars by model name and maximum rent per day.
+ * 11. Show rental reports: revenue by month, fleet utilisation and the top
+ * models by revenue, computed from the rental ledger.
+ * 12. Manage branches: list every location with its cars, or open a new one.
+ * 13. Benchmark renting and returning cars from many threads at many
+ * branches at once.
+ * 14. Show the pricing rules.
+ * 15. Search the fleet by model name. The search ignores case and
+ * punctuation, tolerates typos ("corola", "civc hybrid") and lists the
+ * closest models first.
+ * 16. Import cars in bulk from a CSV file, or export the fleet to one. An
+ * import either adds every row or, if any row is invalid, none of them;
+ * alternatively invalid rows can be skipped and reported.
+ * 17. Forecast utilisation per model from the rental history: cars out per
+ * day, moving averages, peak-day percentiles, a forecast for the next 28
+ * days and the number of cars each model needs.
+ * 18. Save the fleet's data to a file ("cars.dat"), the branches to
+ * "branches.dat" and the reservations to "reservations.dat", and load them
+ * on startup. Every returned rental is also appended to a ledger file
+ * ("rentals.ledger") that is never rewritten.
+ *
+ * The fleet has no fixed size: it grows as cars are added, and a hash
+ * index finds any car by its ID in constant time. The available cars are
+ * also linked into a list of their own, so listing them costs only as much
+ * as the number of cars that are actually available.
+ *
+ * Every car is based at a branch. Cars are picked up at their branch and may
+ * be returned to any branch (a one-way rental), which moves them there.
+ * Each branch has its own lock and its own list of available cars, so
+ * rentals at different branches never wait for each other.
+ *
+ * Prices start from each car's rent per day, which is multiplied for each
+ * day by its vehicle class, the season and the weekend, and then reduced by
+ * a duration tier and an optional discount code. The rules are read from
+ * "pricing.txt" (every rule is optional; without the file a rental costs
+ * days x rent per day, as before), one per line:
+ *     class <Economy|Compact|Midsize|SUV|Luxury|Van> <multiplier>
+ *     weekend <multiplier>
+ *     season <MMDD from> <MMDD to> <multiplier> [class]
+ *     duration <minimum days> <percent off>
+ *     discount <code> <percent off>
+ *
+ * CSV files have one car per line, optionally after a header line:
+ *     id,model,rent_per_day,class,branch[,status,customer]
+ * The class is a name (Economy, ...) or a number from 1 to 6, and the
+ * branch must already exist. Fields containing commas or quotes are
+ * enclosed in double quotes, with any quote inside doubled. Exports add
+ * each car's status and customer; imports ignore those columns, since new
+ * cars arrive available.
+ *
+ * Concepts Covered:
+ * - Inventory status management (tracking availability).
+ * - Transactional logic for renting and returning items.
+ * - User interaction for cost calculation.
+ * - Reinforcing CRUD principles and file persistence.
+ * - Growable arrays and an open-addressing hash index (linear probing).
+ * - An intrusive doubly linked list for O(1) set membership changes.
+ * - A trigram index (every three-letter piece of a name points to the
+ * models containing it) for fuzzy, ranked text search.
+ * - Compiling rules into prefix sums, so the price of any date range is two
+ * table lookups and many cars are quoted in one pass.
+ * - Sharding with one mutex per branch; taking two locks in a fixed order
+ * to move a car between shards without deadlocks.
+ * - A columnar, append-only binary file: each block stores every field as
+ * its own array, so reports run tight loops over just the columns they
+ * need.
+ * - Streaming file processing: reading through a large buffer and parsing
+ * fields in place by hand, and staging a batch so it commits all at once.
+ * - A thread pool whose workers take models from a shared atomic counter,
+ * and difference arrays: each rental becomes two counter updates, and one
+ * running sum turns them into cars out per day.
+ * - Date arithmetic with day numbers.
+ * - An interval tree (a treap augmented with the largest end date of each
+ * subtree) for range-overlap queries, and binary search over sorted
+ * per-car calendars.
+ *
+ * Note on Compilation:
+ * - Uses POSIX truncate() to repair the end of the rental ledger after a
+ * crash: gcc -std=c11 ... on Linux or macOS.
+ * - Uses the GCC/Clang builtin __builtin_prefetch when available.
+ * - Needs C11 atomics and POSIX threads: gcc -std=c11 ... -pthread
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#define _POSIX_C_SOURCE 200809L // For truncate(), clock_gettime()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// --- Constants ---
+#define INITIAL_FLEET_CAPACITY 64
+#define FILENAME "cars.dat"
+#define FLEET_MAGIC "CARFLEET"
+#define FLEET_VERSION 3
+#define BRANCHES_FILENAME "branches.dat"
+#define BRANCH_NAME_LEN 50
+#define DEFAULT_BRANCH_ID 1 // Where cars from files without branches are placed
+#define MAX_BENCH_THREADS 64
+#define PRICING_FILENAME "pricing.txt"
+#define GRAM_ALPHABET 37 // Space, a-z, 0-9 after folding
+#define GRAM_SPACE (GRAM_ALPHABET * GRAM_ALPHABET * GRAM_ALPHABET)
+#define MAX_MODEL_GRAMS 102 // A 100-character model padded with a space at each end
+#define MODEL_RESULTS 10
+#define CSV_BUFFER_SIZE (1 << 20) // Also the longest allowed CSV record
+#define CSV_FIELDS 7
+#define CSV_ERRORS_SHOWN 10
+#define CSV_BATCH_ROWS 256
+#define MAX_FORECAST_THREADS 64
+#define FORECAST_CHUNK 16   // Models a forecast worker takes at a time
+#define FORECAST_HORIZON 28 // Days ahead that are forecast
+#define FORECAST_ROWS 20
+#define VEHICLE_CLASSES 6
+#define MAX_SEASONS 16
+#define MAX_DURATION_TIERS 8
+#define MAX_DISCOUNTS 32
+#define DISCOUNT_CODE_LEN 20
+#define PRICE_WINDOW_PAST_DAYS (2 * 366)   // Compiled prices cover this many days back
+#define PRICE_WINDOW_FUTURE_DAYS (4 * 366) // ... and this many ahead of today
+#define RESERVATIONS_FILENAME "reservations.dat"
+#define LEDGER_FILENAME "rentals.ledger"
+#define LEDGER_BLOCK_ROWS 65536
+#define LEDGER_FIRST_YEAR 1970
+#define LEDGER_LAST_YEAR 2199
+#define TOP_MODELS 10
+#define PREFETCH_DISTANCE 16 // Rows ahead to fetch in batch loops over the fleet
+
+#if defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address) ((void)0)
+#endif
+
+// --- Data Structures ---
+struct Car {
+    int id;
+    char model[100];
+    double rent_per_day;
+    int is_available; // 1 for available, 0 for rented
+    char customer_name[100]; // To store who rented the car
+    int branch_id; // Where the car is, or was picked up if it is rented
+    int vehicle_class; // enum VehicleClass
+};
+
+enum VehicleClass { CLASS_ECONOMY, CLASS_COMPACT, CLASS_MIDSIZE, CLASS_SUV, CLASS_LUXURY, CLASS_VAN };
+
+static const char *const class_names[VEHICLE_CLASSES] = {"Economy", "Compact", "Midsize", "SUV", "Luxury", "Van"};
+
+// Layout of a car in version 2 of cars.dat, before vehicle classes
+struct CarV2 {
+    int id;
+    char model[100];
+    double rent_per_day;
+    int is_available;
+    char customer_name[100];
+    int branch_id;
+};
+
+// Layout of a car in cars.dat files written before branches existed (a raw
+// array with no header)
+struct CarV1 {
+    int id;
+    char model[100];
+    double rent_per_day;
+    int is_available;
+    char customer_name[100];
+};
+
+// Header at the start of cars.dat, followed by 'count' records of struct Car
+struct FleetFileHeader {
+    char magic[8]; // FLEET_MAGIC, not NUL-terminated
+    uint32_t version;
+    uint32_t record_size;
+    int64_t count;
+};
+
+// A seasonal multiplier for the days from one month and day to another
+// (wrapping over New Year if 'from' is later than 'to')
+struct Season {
+    int from_mmdd;
+    int to_mmdd;
+    double factor;
+    int vehicle_class; // -1 for every class
+};
+
+// Rentals of at least 'min_days' days get 'percent_off'
+struct DurationTier {
+    int min_days;
+    double percent_off;
+};
+
+struct Discount {
+    char code[DISCOUNT_CODE_LEN];
+    double percent_off;
+};
+
+// The pricing rules as written in pricing.txt
+struct PricingRules {
+    double class_factor[VEHICLE_CLASSES];
+    double weekend_factor;
+    struct Season seasons[MAX_SEASONS];
+    int season_count;
+    struct DurationTier tiers[MAX_DURATION_TIERS]; // Sorted by min_days
+    int tier_count;
+    struct Discount discounts[MAX_DISCOUNTS];
+    int discount_count;
+};
+
+// The rules compiled for quoting: for each class, prefix sums of the daily
+// multiplier (class x season x weekend) over a window of days, so the sum
+// for any date range inside it is prefix[end] - prefix[start].
+struct PriceTable {
+    int first_day;
+    int days;
+    double *prefix[VEHICLE_CLASSES]; // days + 1 entries each
+};
+
+// A distinct model name (compared after folding case and punctuation) and
+// the cars of that model
+struct ModelEntry {
+    char name[100]; // As first entered
+    char key[100];  // Folded name, compared by the hash table
+    int gram_count; // Distinct trigrams of the folded name
+    int *cars;      // Fleet indexes
+    int car_count;
+    int car_capacity;
+};
+
+// Models that contain one trigram
+struct GramPostings {
+    int *models;
+    int count;
+    int capacity;
+};
+
+// Reads a CSV file one record at a time through a large buffer. Fields
+// are parsed in place, so they stay valid until the next record is read.
+struct CsvReader {
+    FILE *fp;
+    char *buffer; // CSV_BUFFER_SIZE bytes plus one for a terminator
+    size_t start; // First unread byte
+    size_t end;   // End of the bytes read so far
+    int eof;
+};
+
+// Rows of a CSV import whose IDs are looked up in the index together
+struct CsvBatch {
+    int count;
+    int valid;                          // Rows that passed every other check
+    long rows[CSV_BATCH_ROWS];          // Row numbers, for messages
+    const char *errors[CSV_BATCH_ROWS]; // NULL for a valid row
+    int32_t ids[CSV_BATCH_ROWS];        // IDs of the valid rows, in order
+};
+
+// One location of the business. Its lock guards its list of available cars,
+// its counters, and the rental state of every car that is at the branch or
+// was picked up there. Each branch is allocated on its own and padded, so
+// the locks of different branches never share a cache line.
+struct Branch {
+    pthread_mutex_t lock;
+    int id;
+    char name[BRANCH_NAME_LEN];
+    int available_head; // First available car, linked through available_next
+    int available_count;
+    int car_count;      // Cars based here, available or out on rental
+    long contended;     // Lock acquisitions that had to wait
+    char padding[64];
+};
+
+// A branch as stored in branches.dat
+struct BranchRecord {
+    int id;
+    char name[BRANCH_NAME_LEN];
+};
+
+// The branches and the live location and availability links of every car.
+// The real fleet uses the global 'network'; the benchmark builds its own.
+struct FleetNetwork {
+    struct Branch **branches;
+    int branch_count;
+    int branch_capacity;
+    struct Car *cars;         // fleet, or a scratch fleet
+    int car_capacity;
+    _Atomic int *car_branch;  // Parallel to cars: index of the branch the car is at
+    int *available_prev;      // Parallel to cars: links of the branch's available list, -1 ends
+    int *available_next;
+};
+
+// A booking of one car for the days [start_day, end_day). Days are counted
+// from 1970-01-01, so date ranges compare and subtract like integers.
+struct Reservation {
+    int car_id;
+    int start_day;
+    int end_day;   // Exclusive: the day the car comes back
+    int is_active; // 0 once canceled, or returned before the first day
+    int is_rental; // 0 for a booking, 1 for a car that is out now, 2 once it is returned
+    char customer_name[100];
+};
+
+// Interval tree node of a reservation, stored at the reservation's index.
+// The tree is a treap ordered by start day, and each node also knows the
+// latest end day in its subtree, so whole subtrees that end before a
+// query range can be skipped.
+struct IntervalNode {
+    int left;
+    int right;
+    int max_end;
+    uint32_t priority;
+};
+
+// Active reservations of one car, sorted by start day. They never overlap,
+// so they are sorted by end day as well.
+struct CarCalendar {
+    int *reservations;
+    int count;
+    int capacity;
+};
+
+// Header in front of every block of the rental ledger. The block then holds
+// its columns one after the other: car_id, start_day, end_day (int32 each),
+// amount_cents (int64), name_offset (uint32), and finally the customer
+// names as NUL-terminated strings.
+struct LedgerBlockHeader {
+    char magic[4]; // "RLB1"
+    uint32_t rows;
+    uint32_t names_size;
+    uint32_t reserved;
+};
+
+// One block of the ledger in memory, one array per column
+struct LedgerColumns {
+    int32_t *car_id;
+    int32_t *start_day;
+    int32_t *end_day;    // Exclusive, like reservations
+    int64_t *amount_cents;
+    uint32_t *name_offset;
+    char *names;
+    uint32_t rows;
+    uint32_t names_size;
+    uint32_t names_capacity;
+};
+
+// --- Global Data ---
+struct Car *fleet = NULL;
+int car_count = 0;
+int fleet_capacity = 0;
+struct CarCalendar *calendars = NULL; // Parallel to fleet
+int *active_rental = NULL;            // Parallel to fleet: reservation of the current rental, -1 if none
+int *busy_marks = NULL;               // Parallel to fleet: last free-car query that found it busy
+
+// The available cars of each branch form a doubly linked list threaded
+// through two arrays parallel to fleet, so renting or returning a car is
+// O(1) and listing touches only the available ones.
+struct FleetNetwork network;
+
+struct PricingRules pricing;
+
+// Model search index: the distinct models, a hash table from folded name to
+// model, and for every possible trigram the models containing it. Cars
+// share models, so the index grows with the number of models, not cars.
+struct ModelEntry *models = NULL;
+int model_count = 0;
+int model_capacity = 0;
+int *model_slots = NULL; // Open addressing over models, -1 = empty
+int model_slot_capacity = 0;
+struct GramPostings *gram_postings = NULL; // GRAM_SPACE lists
+struct PriceTable price_table;
+
+// Returned rentals not yet written to the ledger. They are appended as one
+// block when the block is full or when the data is saved.
+struct LedgerColumns ledger_tail;
+long ledger_file_rows = 0;
+
+// Car ID -> fleet index, open addressing with linear probing. Cars are never
+// removed, so no tombstones are needed. The table is kept at most half full.
+// Each slot keeps a copy of the ID, so a probe never has to touch the
+// 216-byte car records.
+struct CarIndexSlot {
+    int id;
+    int index; // -1 marks an empty slot
+};
+struct CarIndexSlot *car_index = NULL;
+int car_index_capacity = 0; // Power of two
+
+struct Reservation *reservations = NULL;
+struct IntervalNode *interval_nodes = NULL; // Parallel to reservations
+int reservation_count = 0;
+int reservation_capacity = 0;
+int interval_root = -1;
+
+// --- Function Prototypes ---
+void addCar();
+void displayAvailableCars();
+void displayAllCars();
+void rentCar();
+void returnCar();
+int findCarById(int id);
+void findCarsById(const int32_t *ids, int count, int *indexes);
+int reserveFleet(int capacity);
+void indexCar(int index);
+void rebuildCarIndex();
+int addBranch(struct FleetNetwork *net, int id, const char *name);
+int findBranch(const struct FleetNetwork *net, int id);
+int askBranch(const char *prompt);
+int growNetwork(struct FleetNetwork *net, int capacity);
+void placeCar(struct FleetNetwork *net, int index, int branch);
+void markAvailable(struct FleetNetwork *net, int index);
+void markRented(struct FleetNetwork *net, int index);
+int rentFromBranch(struct FleetNetwork *net, int branch, int index);
+int rentAnyFromBranch(struct FleetNetwork *net, int branch);
+int returnToBranch(struct FleetNetwork *net, int index, int branch);
+int countAvailable(const struct FleetNetwork *net);
+int listAvailableCars(int branch, const char *model, double max_rent);
+void manageBranches();
+void importExportFleet();
+void displayUtilisationForecast();
+int indexModel(int index);
+int searchModels(const char *query, int *results, double *scores, int max_results);
+void searchCarsByModel();
+void loadPricing();
+double dayFactor(int vehicle_class, int day);
+double rangeFactor(int vehicle_class, int start_day, int end_day);
+double durationFactor(int days);
+int findDiscount(const char *code);
+void quoteCars(const int *indexes, int count, int start_day, int end_day, double percent_off, double *prices);
+double askDiscount();
+void displayPricingRules();
+void loadBranches();
+void saveBranches();
+void runBranchBenchmark();
+void searchAvailableCars();
+void recordRental(int index, int start_day, int end_day, double amount);
+int flushLedger();
+void openLedger();
+void displayRentalReports();
+void reserveCar();
+void displayFreeCars();
+void cancelReservation();
+void displayCarCalendar();
+int addReservation(int index, int start_day, int end_day, int is_rental, const char *customer_name);
+void endReservation(int reservation, int end_day);
+static int isCalendarFree(int index, int start_day, int end_day);
+int isCarFree(int index, int start_day, int end_day);
+int findFreeCars(int start_day, int end_day, int *indexes);
+int daysFromDate(int date);
+int dateFromDays(int day);
+int today();
+int newReservation();
+void saveData();
+void loadData();
+
+int main() {
+    loadData();
+    int choice;
+
+    while (1) {
+        printf("\n\n--- Car Rental System ---\n");
+        printf("1. Add New Car to Fleet\n");
+        printf("2. Display Available Cars\n");
+        printf("3. Display All Cars\n");
+        printf("4. Rent a Car\n");
+        printf("5. Return a Car\n");
+        printf("6. Reserve a Car for Dates\n");
+        printf("7. Find Cars Free for Dates\n");
+        printf("8. Cancel a Reservation\n");
+        printf("9. Show a Car's Calendar\n");
+        printf("10. Search Available Cars\n");
+        printf("11. Rental Reports\n");
+        printf("12. Manage Branches\n");
+        printf("13. Run Branch Concurrency Benchmark\n");
+        printf("14. Show Pricing Rules\n");
+        printf("15. Search Cars by Model\n");
+        printf("16. Import/Export Fleet CSV\n");
+        printf("17. Utilisation Forecast\n");
+        printf("18. Save and Exit\n");
+        printf("Enter your choice: ");
+        scanf("%d", &choice);
+        while (getchar() != '\n'); // Clear input buffer
+
+        switch (choice) {
+            case 1: addCar(); break;
+            case 2: displayAvailableCars(); break;
+            case 3: displayAllCars(); break;
+            case 4: rentCar(); break;
+            case 5: returnCar(); break;
+            case 6: reserveCar(); break;
+            case 7: displayFreeCars(); break;
+            case 8: cancelReservation(); break;
+            case 9: displayCarCalendar(); break;
+            case 10: searchAvailableCars(); break;
+            case 11: displayRentalReports(); break;
+            case 12: manageBranches(); break;
+            case 13: runBranchBenchmark(); break;
+            case 14: displayPricingRules(); break;
+            case 15: searchCarsByModel(); break;
+            case 16: importExportFleet(); break;
+            case 17: displayUtilisationForecast(); break;
+            case 18:
+                saveData();
+                printf("Fleet data saved. Exiting...\n");
+                exit(0);
+            default:
+                printf("Invalid choice. Please try again.\n");
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Adds a new car to the fleet.
+ */
+void addCar() {
+    if (car_count == fleet_capacity && !reserveFleet(fleet_capacity ? fleet_capacity * 2 : INITIAL_FLEET_CAPACITY)) {
+        printf("Error: Out of memory; the car cannot be added.\n");
+        return;
+    }
+
+    struct Car *car = &fleet[car_count];
+    printf("\n--- Add New Car ---\n");
+    printf("Enter Car ID: ");
+    scanf("%d", &car->id);
+    while (getchar() != '\n');
+
+    if (findCarById(car->id) != -1) {
+        printf("Error: A car with ID %d already exists.\n", car->id);
+        return;
+    }
+
+    printf("Enter Car Model: ");
+    fgets(car->model, sizeof(car->model), stdin);
+    car->model[strcspn(car->model, "\n")] = 0;
+
+    printf("Enter Rent per Day: ");
+    scanf("%lf", &car->rent_per_day);
+    while (getchar() != '\n');
+
+    printf("Enter Vehicle Class (");
+    for (int c = 0; c < VEHICLE_CLASSES; c++) {
+        printf("%s%d %s", c ? ", " : "", c + 1, class_names[c]);
+    }
+    printf("): ");
+    if (scanf("%d", &car->vehicle_class) != 1 || car->vehicle_class < 1 || car->vehicle_class > VEHICLE_CLASSES) {
+        car->vehicle_class = 0;
+    }
+    while (getchar() != '\n');
+    if (car->vehicle_class == 0) {
+        printf("Error: Invalid vehicle class.\n");
+        return;
+    }
+    car->vehicle_class--;
+
+    int branch = askBranch("Enter Branch ID");
+    if (branch == -1) {
+        return;
+    }
+
+    strcpy(car->customer_name, "N/A");
+    car->is_available = 1; // New cars are available by default
+
+    indexCar(car_count);
+    if (indexModel(car_count) == -1) {
+        printf("Warning: Out of memory; the car will not appear in model searches.\n");
+    }
+    car_count++;
+    placeCar(&network, car_count - 1, branch);
+    printf("Car added to the fleet successfully!\n");
+}
+
+/**
+ * @brief Displays only the cars that are available for rent.
+ */
+void displayAvailableCars() {
+    printf("\n--- Available Cars for Rent (%d) ---\n", countAvailable(&network));
+    listAvailableCars(-1, "", 0);
+}
+
+/**
+ * @brief Displays the available cars whose model contains a text and whose
+ * rent per day is within a limit.
+ */
+void searchAvailableCars() {
+    char model[100];
+    double max_rent;
+    printf("Enter part of the model name (or leave blank for any): ");
+    fgets(model, sizeof(model), stdin);
+    model[strcspn(model, "\n")] = 0;
+    printf("Enter the maximum rent per day (0 for no limit): ");
+    if (scanf("%lf", &max_rent) != 1) {
+        max_rent = 0;
+    }
+    while (getchar() != '\n');
+
+    printf("\n--- Matching Available Cars ---\n");
+    int found = listAvailableCars(-1, model, max_rent);
+    printf("%d of %d available car(s) match.\n", found, countAvailable(&network));
+}
+
+/**
+ * @brief Displays all cars in the fleet, along with their status.
+ */
+void displayAllCars() {
+    if (car_count == 0) {
+        printf("\nThe fleet is empty.\n");
+        return;
+    }
+    printf("\n--- Full Fleet Status ---\n");
+    printf("%-10s %-30s %-15s %-10s %-15s %-10s %-s\n", "Car ID", "Model", "Rent per Day", "Class", "Status", "Branch",
+           "Rented By");
+    printf("--------------------------------------------------------------------------------------------------------------\n");
+    for (int i = 0; i < car_count; i++) {
+        const char* status = fleet[i].is_available ? "Available" : "Rented";
+        printf("%-10d %-30s %-15.2f %-10s %-15s %-10d %-s\n", fleet[i].id, fleet[i].model, fleet[i].rent_per_day,
+               class_names[fleet[i].vehicle_class], status, network.branches[atomic_load(&network.car_branch[i])]->id,
+               fleet[i].customer_name);
+    }
+    printf("--------------------------------------------------------------------------------------------------------------\n");
+}
+
+/**
+ * @brief Rents a car to a customer.
+ */
+void rentCar() {
+    int branch = askBranch("Enter the ID of the pick-up branch");
+    if (branch == -1) {
+        return;
+    }
+    printf("\n--- Available Cars at %s ---\n", network.branches[branch]->name);
+    listAvailableCars(branch, "", 0);
+    int id;
+    printf("\nEnter the ID of the car you want to rent: ");
+    scanf("%d", &id);
+    while (getchar() != '\n');
+
+    int index = findCarById(id);
+    if (index == -1) {
+        printf("Error: Car with ID %d not found.\n", id);
+        return;
+    }
+
+    if (!fleet[index].is_available) {
+        printf("Error: Car is already rented by %s.\n", fleet[index].customer_name);
+        return;
+    }
+    if (atomic_load(&network.car_branch[index]) != branch) {
+        printf("Error: Car ID %d is at branch %d, not here.\n", id,
+               network.branches[atomic_load(&network.car_branch[index])]->id);
+        return;
+    }
+
+    int days;
+    printf("Enter the number of days you plan to keep the car: ");
+    scanf("%d", &days);
+    while (getchar() != '\n');
+    if (days <= 0) {
+        printf("Invalid number of days.\n");
+        return;
+    }
+    int start = today();
+    if (!isCarFree(index, start, start + days)) {
+        printf("Error: Car ID %d is reserved during the next %d days.\n", id, days);
+        return;
+    }
+
+    char name[100];
+    printf("Enter your name: ");
+    fgets(name, sizeof(name), stdin);
+    name[strcspn(name, "\n")] = 0;
+
+    if (!rentFromBranch(&network, branch, index)) {
+        printf("Error: Car ID %d is no longer available.\n", id);
+        return;
+    }
+    int reservation = addReservation(index, start, start + days, 1, name);
+    if (reservation == -1) {
+        printf("Warning: Out of memory; the rental is not on the car's calendar.\n");
+    }
+    active_rental[index] = reservation;
+    strcpy(fleet[index].customer_name, name);
+    printf("Car ID %d has been successfully rented to %s.\n", id, fleet[index].customer_name);
+}
+
+/**
+ * @brief Returns a rented car and calculates the cost.
+ */
+void returnCar() {
+    int id, days;
+    printf("Enter the ID of the car you are returning: ");
+    scanf("%d", &id);
+    while (getchar() != '\n');
+
+    int index = findCarById(id);
+    if (index == -1) {
+        printf("Error: Car with ID %d not found.\n", id);
+        return;
+    }
+
+    if (fleet[index].is_available) {
+        printf("Error: This car is already marked as available.\n");
+        return;
+    }
+
+    int start_day;
+    if (active_rental[index] != -1) {
+        // The calendar knows the pick-up day
+        start_day = reservations[active_rental[index]].start_day;
+        days = today() - start_day;
+        days = days < 1 ? 1 : days; // A car back on the day it left is charged one day
+    } else {
+        // Rented before reservations existed: ask
+        printf("Enter the number of days the car was rented: ");
+        scanf("%d", &days);
+        while (getchar() != '\n');
+
+        if (days <= 0) {
+            printf("Invalid number of days.\n");
+            return;
+        }
+        start_day = today() - days;
+    }
+
+    int from = atomic_load(&network.car_branch[index]);
+    int to = askBranch("Enter the ID of the branch where the car is returned");
+    if (to == -1) {
+        return;
+    }
+
+    double percent_off = askDiscount();
+    if (percent_off < 0) {
+        return;
+    }
+    double total_cost;
+    quoteCars(&index, 1, start_day, start_day + days, percent_off, &total_cost);
+    printf("\n--- Return Summary ---\n");
+    printf("Car Model: %s\n", fleet[index].model);
+    printf("Rented by: %s\n", fleet[index].customer_name);
+    if (total_cost != days * fleet[index].rent_per_day) {
+        printf("Base Rent for %d days: $%.2f\n", days, days * fleet[index].rent_per_day);
+    }
+    printf("Total Rent for %d days: $%.2f\n", days, total_cost);
+    if (to != from) {
+        printf("One-way rental from %s to %s\n", network.branches[from]->name, network.branches[to]->name);
+    }
+    printf("------------------------\n");
+    recordRental(index, start_day, start_day + days, total_cost);
+
+    if (active_rental[index] != -1) {
+        endReservation(active_rental[index], today()); // Frees unused days, or covers late ones
+        reservations[active_rental[index]].is_rental = 2;
+        active_rental[index] = -1;
+    }
+    strcpy(fleet[index].customer_name, "N/A");
+    returnToBranch(&network, index, to);
+    printf("Car ID %d has been successfully returned.\n", id);
+}
+
+// --- Fleet Store ---
+
+static unsigned int hashCarId(int id) {
+    // Finalizer of MurmurHash3: spreads sequential IDs over the whole table
+    uint32_t h = (uint32_t)id;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * @brief Finds a car by its ID.
+ * @return Index of the car, or -1 if not found.
+ */
+int findCarById(int id) {
+    if (car_index_capacity == 0) {
+        return -1;
+    }
+    unsigned int mask = car_index_capacity - 1;
+    for (unsigned int slot = hashCarId(id) & mask; car_index[slot].index != -1; slot = (slot + 1) & mask) {
+        if (car_index[slot].id == id) {
+            return car_index[slot].index;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Looks up many car IDs at once. While one ID is probed, the slot of
+ * an ID further ahead is already being fetched from memory, which hides
+ * most of the cache misses of a large index.
+ * @param indexes Receives the fleet index of each ID, or -1.
+ */
+void findCarsById(const int32_t *ids, int count, int *indexes) {
+    if (car_index_capacity == 0) {
+        for (int i = 0; i < count; i++) {
+            indexes[i] = -1;
+        }
+        return;
+    }
+    unsigned int mask = car_index_capacity - 1;
+    for (int i = 0; i < count; i++) {
+        if (i + PREFETCH_DISTANCE < count) {
+            PREFETCH(&car_index[hashCarId(ids[i + PREFETCH_DISTANCE]) & mask]);
+        }
+        unsigned int slot = hashCarId(ids[i]) & mask;
+        while (car_index[slot].index != -1 && car_index[slot].id != ids[i]) {
+            slot = (slot + 1) & mask;
+        }
+        indexes[i] = car_index[slot].index;
+    }
+}
+
+/**
+ * @brief Adds fleet[index] to the ID index. The caller has checked that the
+ * ID is new and that reserveFleet() made room for it.
+ */
+void indexCar(int index) {
+    unsigned int mask = car_index_capacity - 1;
+    unsigned int slot = hashCarId(fleet[index].id) & mask;
+    while (car_index[slot].index != -1) {
+        slot = (slot + 1) & mask;
+    }
+    car_index[slot] = (struct CarIndexSlot){fleet[index].id, index};
+}
+
+/**
+ * @brief Rebuilds the ID index from the cars in the fleet, dropping any
+ * other entries.
+ */
+void rebuildCarIndex() {
+    for (int i = 0; i < car_index_capacity; i++) {
+        car_index[i].index = -1;
+    }
+    for (int i = 0; i < car_count; i++) {
+        indexCar(i);
+    }
+}
+
+/**
+ * @brief Grows the fleet and its parallel arrays to hold 'capacity' cars,
+ * and the ID index to at least twice that. Existing cars keep their index.
+ * @return 1 on success, 0 if out of memory (nothing is lost).
+ */
+int reserveFleet(int capacity) {
+    if (capacity <= fleet_capacity) {
+        return 1;
+    }
+    struct Car *cars = realloc(fleet, (size_t)capacity * sizeof(struct Car));
+    if (cars == NULL) {
+        return 0;
+    }
+    fleet = cars;
+    struct CarCalendar *cals = realloc(calendars, (size_t)capacity * sizeof(struct CarCalendar));
+    if (cals == NULL) {
+        return 0;
+    }
+    calendars = cals;
+    int *rentals = realloc(active_rental, (size_t)capacity * sizeof(int));
+    if (rentals == NULL) {
+        return 0;
+    }
+    active_rental = rentals;
+    int *marks = realloc(busy_marks, (size_t)capacity * sizeof(int));
+    if (marks == NULL) {
+        return 0;
+    }
+    busy_marks = marks;
+    network.cars = fleet;
+    if (!growNetwork(&network, capacity)) {
+        return 0;
+    }
+    for (int i = fleet_capacity; i < capacity; i++) {
+        calendars[i] = (struct CarCalendar){NULL, 0, 0};
+        active_rental[i] = -1;
+        busy_marks[i] = 0;
+    }
+
+    int index_capacity = car_index_capacity ? car_index_capacity : 16;
+    while (index_capacity < 2 * capacity) {
+        index_capacity *= 2;
+    }
+    if (index_capacity != car_index_capacity) {
+        struct CarIndexSlot *slots = malloc((size_t)index_capacity * sizeof(struct CarIndexSlot));
+        if (slots == NULL) {
+            return 0;
+        }
+        free(car_index);
+        car_index = slots;
+        car_index_capacity = index_capacity;
+        rebuildCarIndex();
+    }
+    fleet_capacity = capacity;
+    return 1;
+}
+
+// Case-insensitive substring test; an empty pattern matches everything
+static int containsIgnoreCase(const char *text, const char *pattern) {
+    for (; *text; text++) {
+        int i = 0;
+        while (pattern[i] && tolower((unsigned char)text[i]) == tolower((unsigned char)pattern[i])) {
+            i++;
+        }
+        if (pattern[i] == 0) {
+            return 1;
+        }
+    }
+    return pattern[0] == 0;
+}
+
+/**
+ * @brief Prints the available cars, walking only the availability lists.
+ * @param branch Branch index to list, or -1 for every branch.
+ * @param model Text the model must contain (any case), or "" for all.
+ * @param max_rent Highest rent per day to show, or 0 for no limit.
+ * @return The number of cars printed.
+ */
+int listAvailableCars(int branch, const char *model, double max_rent) {
+    printf("%-10s %-30s %-15s %-s\n", "Car ID", "Model", "Rent per Day", "Branch");
+    printf("-----------------------------------------------------------------\n");
+    int found = 0, available = 0;
+    for (int b = 0; b < network.branch_count; b++) {
+        if (branch != -1 && b != branch) {
+            continue;
+        }
+        struct Branch *br = network.branches[b];
+        pthread_mutex_lock(&br->lock);
+        available += br->available_count;
+        for (int i = br->available_head; i != -1; i = network.available_next[i]) {
+            if ((max_rent <= 0 || fleet[i].rent_per_day <= max_rent) && containsIgnoreCase(fleet[i].model, model)) {
+                printf("%-10d %-30s %-15.2f %-d\n", fleet[i].id, fleet[i].model, fleet[i].rent_per_day, br->id);
+                found++;
+            }
+        }
+        pthread_mutex_unlock(&br->lock);
+    }
+    if (found == 0) {
+        printf(available == 0 ? "No cars are currently available for rent.\n" : "No available cars match.\n");
+    }
+    printf("-----------------------------------------------------------------\n");
+    return found;
+}
+
+/**
+ * @brief Saves fleet data to a file.
+ */
+void saveData() {
+    FILE *fp = fopen(FILENAME, "wb");
+    if (fp == NULL) {
+        printf("Error opening file for writing.\n");
+        return;
+    }
+    for (int i = 0; i < car_count; i++) {
+        fleet[i].branch_id = network.branches[atomic_load(&network.car_branch[i])]->id;
+    }
+    struct FleetFileHeader header = {.version = FLEET_VERSION, .record_size = sizeof(struct Car), .count = car_count};
+    memcpy(header.magic, FLEET_MAGIC, sizeof(header.magic));
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(fleet, sizeof(struct Car), car_count, fp);
+    fclose(fp);
+    saveBranches();
+
+    // Canceled and returned ones are kept too, so reservation numbers stay the same
+    fp = fopen(RESERVATIONS_FILENAME, "wb");
+    if (fp == NULL) {
+        printf("Error opening %s for writing.\n", RESERVATIONS_FILENAME);
+        return;
+    }
+    fwrite(reservations, sizeof(struct Reservation), reservation_count, fp);
+    fclose(fp);
+
+    if (!flushLedger()) {
+        printf("Error writing %s.\n", LEDGER_FILENAME);
+    }
+}
+
+/**
+ * @brief Loads fleet data from a file.
+ */
+void loadData() {
+    openLedger();
+    loadBranches();
+    loadPricing();
+    if (!reserveFleet(INITIAL_FLEET_CAPACITY)) {
+        printf("Error: Out of memory.\n");
+        exit(1);
+    }
+    FILE *fp = fopen(FILENAME, "rb");
+    if (fp == NULL) {
+        return;
+    }
+    // Size everything once from the file, so a large fleet loads without
+    // repeated growth and rehashing
+    fseek(fp, 0, SEEK_END);
+    long file_size = ftell(fp);
+    rewind(fp);
+    struct FleetFileHeader header;
+    int legacy = fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, FLEET_MAGIC, sizeof(header.magic)) != 0;
+    long records;
+    if (legacy) {
+        rewind(fp); // A raw array of struct CarV1 from before branches existed
+        records = file_size / (long)sizeof(struct CarV1);
+    } else if (header.version > FLEET_VERSION ||
+               header.record_size != (header.version == 2 ? sizeof(struct CarV2) : sizeof(struct Car))) {
+        printf("Error: %s was written by a newer version of this program.\n", FILENAME);
+        fclose(fp);
+        exit(1);
+    } else {
+        records = (file_size - (long)sizeof(header)) / (long)header.record_size;
+        if (header.count < records) {
+            records = (long)header.count;
+        }
+    }
+    if (records < 0) {
+        records = 0;
+    }
+    if (records > INT_MAX / 2 || !reserveFleet(records > 0 ? (int)records : INITIAL_FLEET_CAPACITY)) {
+        printf("Error: Not enough memory to load %ld car(s).\n", records);
+        fclose(fp);
+        exit(1);
+    }
+    int read = 0;
+    if (legacy) {
+        struct CarV1 old;
+        while (read < records && fread(&old, sizeof(old), 1, fp) == 1) {
+            struct Car *car = &fleet[read++];
+            car->id = old.id;
+            memcpy(car->model, old.model, sizeof(car->model));
+            car->rent_per_day = old.rent_per_day;
+            car->is_available = old.is_available;
+            memcpy(car->customer_name, old.customer_name, sizeof(car->customer_name));
+            car->branch_id = network.branches[0]->id;
+            car->vehicle_class = CLASS_ECONOMY;
+        }
+    } else if (header.version == 2) {
+        struct CarV2 old;
+        while (read < records && fread(&old, sizeof(old), 1, fp) == 1) {
+            struct Car *car = &fleet[read++];
+            car->id = old.id;
+            memcpy(car->model, old.model, sizeof(car->model));
+            car->rent_per_day = old.rent_per_day;
+            car->is_available = old.is_available;
+            memcpy(car->customer_name, old.customer_name, sizeof(car->customer_name));
+            car->branch_id = old.branch_id;
+            car->vehicle_class = CLASS_ECONOMY;
+        }
+    } else {
+        read = fread(fleet, sizeof(struct Car), records, fp);
+    }
+    fclose(fp);
+
+    int duplicates = 0, unknown_branch = 0;
+    for (int i = 0; i < read; i++) {
+        if (findCarById(fleet[i].id) != -1) {
+            duplicates++;
+            continue;
+        }
+        if (fleet[i].vehicle_class < 0 || fleet[i].vehicle_class >= VEHICLE_CLASSES) {
+            fleet[i].vehicle_class = CLASS_ECONOMY;
+        }
+        fleet[car_count] = fleet[i];
+        indexCar(car_count);
+        indexModel(car_count);
+        int branch = findBranch(&network, fleet[car_count].branch_id);
+        if (branch == -1) {
+            unknown_branch++;
+            branch = 0;
+        }
+        placeCar(&network, car_count, branch);
+        car_count++;
+    }
+    if (car_count > 0) {
+        printf("Loaded %d car(s) from the fleet data.\n", car_count);
+    }
+    if (legacy && car_count > 0) {
+        printf("Converted %s from the old format; all cars are at branch %d (%s).\n", FILENAME,
+               network.branches[0]->id, network.branches[0]->name);
+    }
+    if (duplicates > 0) {
+        printf("Warning: %d car(s) with a repeated ID were skipped.\n", duplicates);
+    }
+    if (unknown_branch > 0) {
+        printf("Warning: %d car(s) from unknown branches were moved to branch %d.\n", unknown_branch,
+               network.branches[0]->id);
+    }
+
+    int loaded = 0, skipped = 0;
+    fp = fopen(RESERVATIONS_FILENAME, "rb");
+    if (fp != NULL) {
+        struct Reservation r;
+        while (fread(&r, sizeof(r), 1, fp) == 1) {
+            int index = findCarById(r.car_id);
+            r.customer_name[sizeof(r.customer_name) - 1] = 0;
+            if (r.is_active && (index == -1 || r.start_day >= r.end_day ||
+                                !isCalendarFree(index, r.start_day, r.end_day))) {
+                skipped++;
+                r.is_active = 0;
+            }
+            if (!r.is_active) {
+                if (newReservation() != -1) {
+                    reservations[reservation_count - 1] = r; // Keeps its number, but not indexed
+                }
+                continue;
+            }
+            if (r.is_rental == 1 && fleet[index].is_available) {
+                r.is_rental = 2; // Returned before returns were recorded in the file
+            }
+            int id = addReservation(index, r.start_day, r.end_day, r.is_rental, r.customer_name);
+            if (id != -1 && r.is_rental == 1) {
+                active_rental[index] = id;
+            }
+            loaded++;
+        }
+        fclose(fp);
+    }
+    if (loaded > 0) {
+        printf("Loaded %d reservation(s).\n", loaded);
+    }
+    if (skipped > 0) {
+        printf("Warning: %d invalid or overlapping reservation(s) were skipped.\n", skipped);
+    }
+
+    // Cars rented out before reservations existed get a rental from today
+    for (int i = 0; i < car_count; i++) {
+        if (!fleet[i].is_available && active_rental[i] == -1) {
+            int start = today();
+            if (isCarFree(i, start, start + 1)) {
+                active_rental[i] = addReservation(i, start, start + 1, 1, fleet[i].customer_name);
+            }
+        }
+    }
+}
+
+// --- Reservation Calendar ---
+
+/**
+ * @brief Converts a YYYYMMDD date to a day number (days since 1970-01-01).
+ * @return The day number, or INT_MIN if the date does not exist.
+ */
+int daysFromDate(int date) {
+    int y = date / 10000, m = date / 100 % 100, d = date % 100;
+    static const int month_days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if (y < 1970 || y > 9999 || m < 1 || m > 12 || d < 1 || d > month_days[m - 1] + (m == 2 && leap)) {
+        return INT_MIN;
+    }
+    // Count from March so the leap day is the last day of the year
+    y -= m <= 2;
+    int era = y / 400;
+    int year_of_era = y - era * 400;
+    int day_of_year = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+/**
+ * @brief Converts a day number back to a YYYYMMDD date.
+ */
+int dateFromDays(int day) {
+    day += 719468;
+    int era = (day >= 0 ? day : day - 146096) / 146097;
+    int day_of_era = day - era * 146097;
+    int year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    int day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int mp = (5 * day_of_year + 2) / 153;
+    int d = day_of_year - (153 * mp + 2) / 5 + 1;
+    int m = mp < 10 ? mp + 3 : mp - 9;
+    int y = year_of_era + era * 400 + (m <= 2);
+    return y * 10000 + m * 100 + d;
+}
+
+/**
+ * @brief Today's day number in local time.
+ */
+int today() {
+    time_t now = time(NULL);
+    struct tm *local = localtime(&now);
+    return daysFromDate((local->tm_year + 1900) * 10000 + (local->tm_mon + 1) * 100 + local->tm_mday);
+}
+
+static uint32_t nextPriority() {
+    static uint32_t state = 2463534242u; // xorshift32; any fixed seed will do
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static int maxEnd(int node) {
+    return node == -1 ? INT_MIN : interval_nodes[node].max_end;
+}
+
+static void updateNode(int node) {
+    struct IntervalNode *n = &interval_nodes[node];
+    int best = reservations[node].end_day;
+    if (maxEnd(n->left) > best) {
+        best = maxEnd(n->left);
+    }
+    if (maxEnd(n->right) > best) {
+        best = maxEnd(n->right);
+    }
+    n->max_end = best;
+}
+
+// Tree order: by start day, then by reservation number
+static int startsBefore(int a, int b) {
+    return reservations[a].start_day < reservations[b].start_day ||
+           (reservations[a].start_day == reservations[b].start_day && a < b);
+}
+
+/**
+ * @brief Inserts a node into the treap; rotations keep the heap order of
+ * the random priorities, which keeps the expected depth at O(log n).
+ * @return The new root of the subtree.
+ */
+static int treeInsert(int root, int node) {
+    if (root == -1) {
+        return node;
+    }
+    struct IntervalNode *r = &interval_nodes[root];
+    if (startsBefore(node, root)) {
+        r->left = treeInsert(r->left, node);
+        if (interval_nodes[r->left].priority > r->priority) {
+            int pivot = r->left;
+            r->left = interval_nodes[pivot].right;
+            interval_nodes[pivot].right = root;
+            updateNode(root);
+            updateNode(pivot);
+            return pivot;
+        }
+    } else {
+        r->right = treeInsert(r->right, node);
+        if (interval_nodes[r->right].priority > r->priority) {
+            int pivot = r->right;
+            r->right = interval_nodes[pivot].left;
+            interval_nodes[pivot].left = root;
+            updateNode(root);
+            updateNode(pivot);
+            return pivot;
+        }
+    }
+    updateNode(root);
+    return root;
+}
+
+/**
+ * @brief Joins two treaps where every key of 'a' is below every key of 'b'.
+ */
+static int treeMerge(int a, int b) {
+    if (a == -1) {
+        return b;
+    }
+    if (b == -1) {
+        return a;
+    }
+    if (interval_nodes[a].priority > interval_nodes[b].priority) {
+        interval_nodes[a].right = treeMerge(interval_nodes[a].right, b);
+        updateNode(a);
+        return a;
+    }
+    interval_nodes[b].left = treeMerge(a, interval_nodes[b].left);
+    updateNode(b);
+    return b;
+}
+
+/**
+ * @brief Removes a node from the treap.
+ * @return The new root of the subtree.
+ */
+static int treeRemove(int root, int node) {
+    if (root == -1) {
+        return -1;
+    }
+    if (root == node) {
+        return treeMerge(interval_nodes[root].left, interval_nodes[root].right);
+    }
+    if (startsBefore(node, root)) {
+        interval_nodes[root].left = treeRemove(interval_nodes[root].left, node);
+    } else {
+        interval_nodes[root].right = treeRemove(interval_nodes[root].right, node);
+    }
+    updateNode(root);
+    return root;
+}
+
+/**
+ * @brief Calls 'visit' for every active reservation overlapping the days
+ * [start_day, end_day), in O(log n + k) for k overlaps.
+ */
+static void treeQuery(int node, int start_day, int end_day, void (*visit)(int reservation)) {
+    while (node != -1 && interval_nodes[node].max_end > start_day) {
+        struct IntervalNode *n = &interval_nodes[node];
+        treeQuery(n->left, start_day, end_day, visit);
+        if (reservations[node].start_day >= end_day) {
+            return; // This node and everything to its right start too late
+        }
+        if (reservations[node].end_day > start_day) {
+            visit(node);
+        }
+        node = n->right;
+    }
+}
+
+/**
+ * @brief Index in a car's calendar of the last reservation that starts
+ * before 'day', or -1 (binary search).
+ */
+static int lastStartingBefore(const struct CarCalendar *cal, int day) {
+    int lo = 0, hi = cal->count; // Answer lies in [lo - 1, hi - 1]
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (reservations[cal->reservations[mid]].start_day < day) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo - 1;
+}
+
+/**
+ * @brief Checks the calendar alone: no reservation of the car on any of
+ * the days [start_day, end_day), in O(log m) for m reservations of the car.
+ */
+static int isCalendarFree(int index, int start_day, int end_day) {
+    const struct CarCalendar *cal = &calendars[index];
+    // Only the last reservation starting before end_day can reach into the range
+    int last = lastStartingBefore(cal, end_day);
+    return last == -1 || reservations[cal->reservations[last]].end_day <= start_day;
+}
+
+/**
+ * @brief Checks whether a car that is out now overlaps [start_day, end_day)
+ * past its planned return. An overdue car stays away until at least
+ * tomorrow, whatever its calendar entry says.
+ */
+static int isOverdueDuring(int index, int start_day, int end_day, int now) {
+    if (fleet[index].is_available || active_rental[index] == -1) {
+        return 0;
+    }
+    const struct Reservation *r = &reservations[active_rental[index]];
+    int until = r->end_day > now ? r->end_day : now + 1;
+    return start_day < until && end_day > r->start_day;
+}
+
+/**
+ * @brief Checks that a car has no reservation on any of the days
+ * [start_day, end_day) and is not still out from an overdue rental.
+ */
+int isCarFree(int index, int start_day, int end_day) {
+    return isCalendarFree(index, start_day, end_day) && !isOverdueDuring(index, start_day, end_day, today());
+}
+
+/**
+ * @brief Appends an empty reservation, growing the arrays when full.
+ * @return The reservation number, or -1 if out of memory.
+ */
+int newReservation() {
+    if (reservation_count == reservation_capacity) {
+        int capacity = reservation_capacity ? reservation_capacity * 2 : 256;
+        struct Reservation *grown = realloc(reservations, capacity * sizeof(struct Reservation));
+        if (grown == NULL) {
+            return -1;
+        }
+        reservations = grown;
+        struct IntervalNode *nodes = realloc(interval_nodes, capacity * sizeof(struct IntervalNode));
+        if (nodes == NULL) {
+            return -1;
+        }
+        interval_nodes = nodes;
+        reservation_capacity = capacity;
+    }
+    return reservation_count++;
+}
+
+/**
+ * @brief Records a reservation in the car's calendar and the interval tree.
+ * The caller checks first that the car is free for those days.
+ * @return The reservation number, or -1 if out of memory.
+ */
+int addReservation(int index, int start_day, int end_day, int is_rental, const char *customer_name) {
+    struct CarCalendar *cal = &calendars[index];
+    if (cal->count == cal->capacity) {
+        int capacity = cal->capacity ? cal->capacity * 2 : 4;
+        int *grown = realloc(cal->reservations, capacity * sizeof(int));
+        if (grown == NULL) {
+            return -1;
+        }
+        cal->reservations = grown;
+        cal->capacity = capacity;
+    }
+
+    int id = newReservation();
+    if (id == -1) {
+        return -1;
+    }
+    struct Reservation *r = &reservations[id];
+    r->car_id = fleet[index].id;
+    r->start_day = start_day;
+    r->end_day = end_day;
+    r->is_active = 1;
+    r->is_rental = is_rental;
+    strncpy(r->customer_name, customer_name, sizeof(r->customer_name) - 1);
+    r->customer_name[sizeof(r->customer_name) - 1] = 0;
+
+    int pos = lastStartingBefore(cal, start_day) + 1;
+    memmove(&cal->reservations[pos + 1], &cal->reservations[pos], (cal->count - pos) * sizeof(int));
+    cal->reservations[pos] = id;
+    cal->count++;
+
+    interval_nodes[id] = (struct IntervalNode){-1, -1, end_day, nextPriority()};
+    interval_root = treeInsert(interval_root, id);
+    return id;
+}
+
+static int findCalendarSlot(const struct CarCalendar *cal, int reservation) {
+    int pos = lastStartingBefore(cal, reservations[reservation].start_day) + 1;
+    while (pos < cal->count && cal->reservations[pos] != reservation) {
+        pos++; // Reservations of one car never share a start day, so at most one step
+    }
+    return pos < cal->count ? pos : -1;
+}
+
+/**
+ * @brief Ends a reservation at 'end_day': a returned rental or a
+ * cancellation. If 'end_day' still leaves some days, the reservation is set
+ * to end then and kept; otherwise it is removed. A late return is extended
+ * to 'end_day', but never into the car's next reservation.
+ */
+void endReservation(int reservation, int end_day) {
+    struct Reservation *r = &reservations[reservation];
+    if (end_day == r->end_day) {
+        return; // Returned on time
+    }
+    struct CarCalendar *cal = &calendars[findCarById(r->car_id)];
+    if (end_day > r->end_day) {
+        int pos = findCalendarSlot(cal, reservation);
+        if (pos != -1 && pos + 1 < cal->count && reservations[cal->reservations[pos + 1]].start_day < end_day) {
+            end_day = reservations[cal->reservations[pos + 1]].start_day;
+        }
+        if (end_day <= r->end_day) {
+            return;
+        }
+    }
+    interval_root = treeRemove(interval_root, reservation);
+    if (end_day > r->start_day) {
+        r->end_day = end_day; // Sorted positions do not change: the start is the same
+        interval_nodes[reservation] = (struct IntervalNode){-1, -1, end_day, interval_nodes[reservation].priority};
+        interval_root = treeInsert(interval_root, reservation);
+        return;
+    }
+    r->is_active = 0;
+    int pos = findCalendarSlot(cal, reservation);
+    if (pos != -1) {
+        memmove(&cal->reservations[pos], &cal->reservations[pos + 1], (cal->count - pos - 1) * sizeof(int));
+        cal->count--;
+    }
+}
+
+static int query_number = 0;
+
+static void markBusy(int reservation) {
+    int index = findCarById(reservations[reservation].car_id);
+    if (index != -1) {
+        busy_marks[index] = query_number;
+    }
+}
+
+/**
+ * @brief Finds every car with no reservation on the days
+ * [start_day, end_day). The interval tree reports the k overlapping
+ * reservations in O(log n + k); every car they do not mark is free unless
+ * it is still out from an overdue rental.
+ * @param indexes Receives the fleet indexes of the free cars.
+ * @return The number of free cars.
+ */
+int findFreeCars(int start_day, int end_day, int *indexes) {
+    query_number++;
+    treeQuery(interval_root, start_day, end_day, markBusy);
+    int now = today(), count = 0;
+    for (int i = 0; i < car_count; i++) {
+        if (busy_marks[i] != query_number && !isOverdueDuring(i, start_day, end_day, now)) {
+            indexes[count++] = i;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Asks for a pick-up and a return date.
+ * @return 1 if both are valid and the return is after the pick-up.
+ */
+static int askDateRange(int *start_day, int *end_day) {
+    int start_date, end_date;
+    printf("Enter pick-up date (YYYYMMDD): ");
+    scanf("%d", &start_date);
+    while (getchar() != '\n');
+    printf("Enter return date (YYYYMMDD): ");
+    scanf("%d", &end_date);
+    while (getchar() != '\n');
+
+    *start_day = daysFromDate(start_date);
+    *end_day = daysFromDate(end_date);
+    if (*start_day == INT_MIN || *end_day == INT_MIN) {
+        printf("Error: Invalid date.\n");
+        return 0;
+    }
+    if (*end_day <= *start_day) {
+        printf("Error: The return date must be after the pick-up date.\n");
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Lists the cars free for a date range, with the rent for it.
+ * @return The number of free cars.
+ */
+static const double *sort_prices; // Quotes used by compareByPrice()
+
+static int compareByPrice(const void *a, const void *b) {
+    double x = sort_prices[*(const int *)a], y = sort_prices[*(const int *)b];
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Lists the cars free for a date range with their quoted price,
+ * cheapest first.
+ * @return The number of free cars.
+ */
+static int printFreeCars(int start_day, int end_day, double percent_off) {
+    int *indexes = malloc((car_count > 0 ? car_count : 1) * sizeof(int));
+    double *prices = malloc((car_count > 0 ? car_count : 1) * sizeof(double));
+    int *order = malloc((car_count > 0 ? car_count : 1) * sizeof(int));
+    if (indexes == NULL || prices == NULL || order == NULL) {
+        printf("Error: Out of memory.\n");
+        free(indexes);
+        free(prices);
+        free(order);
+        return 0;
+    }
+    int count = findFreeCars(start_day, end_day, indexes);
+    quoteCars(indexes, count, start_day, end_day, percent_off, prices);
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    sort_prices = prices;
+    qsort(order, count, sizeof(int), compareByPrice);
+
+    int days = end_day - start_day;
+    printf("\n--- Cars Free from %d to %d (%d day(s)) ---\n", dateFromDays(start_day), dateFromDays(end_day), days);
+    printf("%-10s %-30s %-10s %-15s %-15s\n", "Car ID", "Model", "Class", "Rent per Day", "Total Rent");
+    printf("---------------------------------------------------------------------------------\n");
+    for (int i = 0; i < count; i++) {
+        struct Car *car = &fleet[indexes[order[i]]];
+        printf("%-10d %-30s %-10s %-15.2f %-15.2f\n", car->id, car->model, class_names[car->vehicle_class],
+               car->rent_per_day, prices[order[i]]);
+    }
+    if (count == 0) {
+        printf("No cars are free for these dates.\n");
+    }
+    printf("---------------------------------------------------------------------------------\n");
+    free(indexes);
+    free(prices);
+    free(order);
+    return count;
+}
+
+/**
+ * @brief Lists every car that is free for a date range.
+ */
+void displayFreeCars() {
+    int start_day, end_day;
+    if (!askDateRange(&start_day, &end_day)) {
+        return;
+    }
+    double percent_off = askDiscount();
+    if (percent_off >= 0) {
+        printFreeCars(start_day, end_day, percent_off);
+    }
+}
+
+/**
+ * @brief Reserves a car for a future date range.
+ */
+void reserveCar() {
+    int start_day, end_day;
+    if (!askDateRange(&start_day, &end_day)) {
+        return;
+    }
+    if (start_day < today()) {
+        printf("Error: The pick-up date is in the past.\n");
+        return;
+    }
+    if (printFreeCars(start_day, end_day, 0) == 0) {
+        return;
+    }
+
+    int id;
+    printf("\nEnter the ID of the car to reserve: ");
+    scanf("%d", &id);
+    while (getchar() != '\n');
+    int index = findCarById(id);
+    if (index == -1) {
+        printf("Error: Car with ID %d not found.\n", id);
+        return;
+    }
+    if (!isCarFree(index, start_day, end_day)) {
+        printf("Error: Car ID %d is not free for these dates.\n", id);
+        return;
+    }
+
+    char name[100];
+    printf("Enter your name: ");
+    fgets(name, sizeof(name), stdin);
+    name[strcspn(name, "\n")] = 0;
+
+    int reservation = addReservation(index, start_day, end_day, 0, name);
+    if (reservation == -1) {
+        printf("Error: Out of memory.\n");
+        return;
+    }
+    printf("Reservation #%d: car ID %d for %s from %d to %d.\n", reservation + 1, id, name,
+           dateFromDays(start_day), dateFromDays(end_day));
+}
+
+/**
+ * @brief Cancels a future reservation by its number.
+ */
+void cancelReservation() {
+    int number;
+    printf("Enter the reservation number to cancel: ");
+    scanf("%d", &number);
+    while (getchar() != '\n');
+    if (number < 1 || number > reservation_count || !reservations[number - 1].is_active) {
+        printf("Error: No active reservation #%d.\n", number);
+        return;
+    }
+    struct Reservation *r = &reservations[number - 1];
+    if (r->is_rental == 1) {
+        printf("Error: Reservation #%d is a car that is out now; use Return a Car.\n", number);
+        return;
+    }
+    if (r->is_rental == 2) {
+        printf("Error: Reservation #%d is a rental that has already ended.\n", number);
+        return;
+    }
+    endReservation(number - 1, r->start_day);
+    printf("Reservation #%d for %s has been canceled.\n", number, r->customer_name);
+}
+
+/**
+ * @brief Shows the active reservations of one car in date order.
+ */
+void displayCarCalendar() {
+    int id;
+    printf("Enter Car ID: ");
+    scanf("%d", &id);
+    while (getchar() != '\n');
+    int index = findCarById(id);
+    if (index == -1) {
+        printf("Error: Car with ID %d not found.\n", id);
+        return;
+    }
+    const struct CarCalendar *cal = &calendars[index];
+    printf("\n--- Calendar of Car ID %d (%s) ---\n", id, fleet[index].model);
+    printf("%-8s %-12s %-12s %-10s %-s\n", "No.", "Pick-up", "Return", "Type", "Customer");
+    printf("------------------------------------------------------------\n");
+    for (int i = 0; i < cal->count; i++) {
+        int n = cal->reservations[i];
+        struct Reservation *r = &reservations[n];
+        printf("%-8d %-12d %-12d %-10s %-s\n", n + 1, dateFromDays(r->start_day), dateFromDays(r->end_day),
+               r->is_rental == 1 ? "Rental" : r->is_rental == 2 ? "Returned" : "Booking", r->customer_name);
+    }
+    if (cal->count == 0) {
+        printf("No reservations.\n");
+    }
+    printf("------------------------------------------------------------\n");
+}
+
+// --- Rental Ledger ---
+
+/**
+ * @brief Allocates the column arrays of a block of LEDGER_BLOCK_ROWS rows.
+ * @return 1 on success, 0 if out of memory.
+ */
+static int allocLedgerColumns(struct LedgerColumns *c) {
+    c->car_id = malloc(LEDGER_BLOCK_ROWS * sizeof(int32_t));
+    c->start_day = malloc(LEDGER_BLOCK_ROWS * sizeof(int32_t));
+    c->end_day = malloc(LEDGER_BLOCK_ROWS * sizeof(int32_t));
+    c->amount_cents = malloc(LEDGER_BLOCK_ROWS * sizeof(int64_t));
+    c->name_offset = malloc(LEDGER_BLOCK_ROWS * sizeof(uint32_t));
+    c->names_capacity = LEDGER_BLOCK_ROWS * 16;
+    c->names = malloc(c->names_capacity);
+    c->rows = 0;
+    c->names_size = 0;
+    return c->car_id && c->start_day && c->end_day && c->amount_cents && c->name_offset && c->names;
+}
+
+static void freeLedgerColumns(struct LedgerColumns *c) {
+    free(c->car_id);
+    free(c->start_day);
+    free(c->end_day);
+    free(c->amount_cents);
+    free(c->name_offset);
+    free(c->names);
+}
+
+/**
+ * @brief Writes the in-memory tail as one block at the end of the ledger.
+ * @return 1 on success (or nothing to write), 0 on a write error.
+ */
+int flushLedger() {
+    struct LedgerColumns *c = &ledger_tail;
+    if (c->rows == 0) {
+        return 1;
+    }
+    FILE *fp = fopen(LEDGER_FILENAME, "ab");
+    if (fp == NULL) {
+        return 0;
+    }
+    struct LedgerBlockHeader header = {{'R', 'L', 'B', '1'}, c->rows, c->names_size, 0};
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+             fwrite(c->car_id, sizeof(int32_t), c->rows, fp) == c->rows &&
+             fwrite(c->start_day, sizeof(int32_t), c->rows, fp) == c->rows &&
+             fwrite(c->end_day, sizeof(int32_t), c->rows, fp) == c->rows &&
+             fwrite(c->amount_cents, sizeof(int64_t), c->rows, fp) == c->rows &&
+             fwrite(c->name_offset, sizeof(uint32_t), c->rows, fp) == c->rows &&
+             fwrite(c->names, 1, c->names_size, fp) == c->names_size;
+    ok = fclose(fp) == 0 && ok;
+    if (ok) {
+        ledger_file_rows += c->rows;
+        c->rows = 0;
+        c->names_size = 0;
+    }
+    return ok;
+}
+
+/**
+ * @brief Adds a returned rental to the ledger.
+ */
+void recordRental(int index, int start_day, int end_day, double amount) {
+    struct LedgerColumns *c = &ledger_tail;
+    if (c->car_id == NULL && !allocLedgerColumns(c)) {
+        printf("Error: Out of memory; the rental was not recorded in the ledger.\n");
+        return;
+    }
+    size_t name_size = strlen(fleet[index].customer_name) + 1;
+    if (c->names_size + name_size > c->names_capacity) {
+        char *names = realloc(c->names, c->names_capacity * 2);
+        if (names == NULL) {
+            printf("Error: Out of memory; the rental was not recorded in the ledger.\n");
+            return;
+        }
+        c->names = names;
+        c->names_capacity *= 2;
+    }
+    uint32_t row = c->rows++;
+    c->car_id[row] = fleet[index].id;
+    c->start_day[row] = start_day;
+    c->end_day[row] = end_day;
+    c->amount_cents[row] = (int64_t)(amount * 100 + (amount < 0 ? -0.5 : 0.5));
+    c->name_offset[row] = c->names_size;
+    memcpy(c->names + c->names_size, fleet[index].customer_name, name_size);
+    c->names_size += name_size;
+    if (c->rows == LEDGER_BLOCK_ROWS && !flushLedger()) {
+        printf("Error writing %s.\n", LEDGER_FILENAME);
+    }
+}
+
+/**
+ * @brief Reads the next block of the ledger into 'c'. The names are skipped
+ * unless 'with_names' is set.
+ * @return 1 if a block was read, 0 at the end of the file or at a damaged block.
+ */
+static int readLedgerBlock(FILE *fp, struct LedgerColumns *c, int with_names) {
+    struct LedgerBlockHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, "RLB1", 4) != 0 ||
+        header.rows == 0 || header.rows > LEDGER_BLOCK_ROWS) {
+        return 0;
+    }
+    uint32_t rows = header.rows;
+    if (fread(c->car_id, sizeof(int32_t), rows, fp) != rows ||
+        fread(c->start_day, sizeof(int32_t), rows, fp) != rows ||
+        fread(c->end_day, sizeof(int32_t), rows, fp) != rows ||
+        fread(c->amount_cents, sizeof(int64_t), rows, fp) != rows ||
+        fread(c->name_offset, sizeof(uint32_t), rows, fp) != rows) {
+        return 0;
+    }
+    if (with_names) {
+        if (header.names_size > c->names_capacity) {
+            char *names = realloc(c->names, header.names_size);
+            if (names == NULL) {
+                return 0;
+            }
+            c->names = names;
+            c->names_capacity = header.names_size;
+        }
+        if (fread(c->names, 1, header.names_size, fp) != header.names_size) {
+            return 0;
+        }
+    } else if (fseek(fp, header.names_size, SEEK_CUR) != 0) {
+        return 0;
+    }
+    c->rows = rows;
+    c->names_size = header.names_size;
+    return 1;
+}
+
+/**
+ * @brief Counts the rentals in the ledger at startup. A block left half
+ * written by a crash is cut off, so new blocks follow the last good one.
+ */
+void openLedger() {
+    FILE *fp = fopen(LEDGER_FILENAME, "rb");
+    if (fp == NULL) {
+        return;
+    }
+    long good_end = 0;
+    struct LedgerBlockHeader header;
+    while (fread(&header, sizeof(header), 1, fp) == 1 && memcmp(header.magic, "RLB1", 4) == 0 &&
+           header.rows > 0 && header.rows <= LEDGER_BLOCK_ROWS) {
+        long size = (long)header.rows * (3 * sizeof(int32_t) + sizeof(int64_t) + sizeof(uint32_t)) + header.names_size;
+        long end = good_end + (long)sizeof(header) + size;
+        if (fseek(fp, 0, SEEK_END) != 0 || ftell(fp) < end) {
+            break;
+        }
+        fseek(fp, end, SEEK_SET);
+        good_end = end;
+        ledger_file_rows += header.rows;
+    }
+    fseek(fp, 0, SEEK_END);
+    long file_size = ftell(fp);
+    fclose(fp);
+    if (file_size > good_end) {
+        printf("Warning: %ld damaged byte(s) at the end of %s were removed.\n", file_size - good_end, LEDGER_FILENAME);
+        if (truncate(LEDGER_FILENAME, good_end) != 0) {
+            printf("Error: Could not repair %s.\n", LEDGER_FILENAME);
+        }
+    }
+}
+
+// Per-car totals of a report. Kept together (16 bytes) because rows hit
+// the cars in random order: one cache line per row instead of three.
+struct CarTotals {
+    int64_t revenue_cents;
+    int32_t days;
+    int32_t rentals;
+};
+
+// Totals gathered in one pass over the ledger
+struct LedgerReport {
+    struct CarTotals *cars; // Parallel to fleet
+    int64_t month_revenue[(LEDGER_LAST_YEAR - LEDGER_FIRST_YEAR + 1) * 12];
+    uint16_t *month_of_day; // Day number -> month slot, built once per report
+    int month_days;
+    int first_day;
+    int last_day;
+    long rows;
+    long unknown_cars;
+    int64_t total_cents;
+};
+
+/**
+ * @brief Adds one block to the report. Each statistic is its own straight
+ * loop over only the columns it needs, with totals kept in locals, so the
+ * compiler can vectorize the simple ones.
+ */
+static void aggregateLedgerBlock(const struct LedgerColumns *c, struct LedgerReport *r, int *indexes) {
+    uint32_t rows = c->rows;
+    const int32_t *restrict starts = c->start_day;
+    const int32_t *restrict ends = c->end_day;
+    const int64_t *restrict cents = c->amount_cents;
+
+    int64_t total = 0;
+    int32_t first = r->first_day, last = r->last_day;
+    for (uint32_t i = 0; i < rows; i++) {
+        total += cents[i];
+        first = starts[i] < first ? starts[i] : first;
+        last = ends[i] > last ? ends[i] : last;
+    }
+    r->total_cents += total;
+    r->first_day = first;
+    r->last_day = last;
+
+    // Revenue counts in the month the car came back (the last rented day)
+    const uint16_t *restrict month_of_day = r->month_of_day;
+    int64_t *restrict month_revenue = r->month_revenue;
+    for (uint32_t i = 0; i < rows; i++) {
+        uint32_t day = (uint32_t)(ends[i] - 1);
+        if (day < (uint32_t)r->month_days) {
+            month_revenue[month_of_day[day]] += cents[i];
+        }
+    }
+
+    // Resolve car IDs to fleet indexes first, so the per-car sums are plain array updates
+    findCarsById(c->car_id, rows, indexes);
+    struct CarTotals *restrict cars = r->cars;
+    long unknown = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        if (i + PREFETCH_DISTANCE < rows && indexes[i + PREFETCH_DISTANCE] >= 0) {
+            PREFETCH(&cars[indexes[i + PREFETCH_DISTANCE]]);
+        }
+        int index = indexes[i];
+        if (index < 0) {
+            unknown++;
+            continue;
+        }
+        cars[index].revenue_cents += cents[i];
+        cars[index].days += ends[i] - starts[i];
+        cars[index].rentals++;
+    }
+    r->unknown_cars += unknown;
+    r->rows += rows;
+}
+
+static int compareByModel(const void *a, const void *b) {
+    return strcmp(fleet[*(const int *)a].model, fleet[*(const int *)b].model);
+}
+
+/**
+ * @brief Scans the whole ledger once and prints revenue by month, fleet
+ * utilisation and the top models by revenue.
+ */
+void displayRentalReports() {
+    struct LedgerReport r;
+    memset(&r, 0, sizeof(r));
+    r.first_day = INT_MAX;
+    r.last_day = INT_MIN;
+    r.month_days = daysFromDate((LEDGER_LAST_YEAR + 1) * 10000 + 101);
+    r.cars = calloc(car_count + 1, sizeof(struct CarTotals));
+    r.month_of_day = malloc(r.month_days * sizeof(uint16_t));
+    int *indexes = malloc(LEDGER_BLOCK_ROWS * sizeof(int));
+    struct LedgerColumns block = {0};
+    if (!r.cars || !r.month_of_day || !indexes || !allocLedgerColumns(&block)) {
+        printf("Error: Out of memory.\n");
+        goto done;
+    }
+    for (int day = 0, month = 0, next = daysFromDate(LEDGER_FIRST_YEAR * 10000 + 201); day < r.month_days; day++) {
+        if (day == next) {
+            month++;
+            int date = dateFromDays(day);
+            next = daysFromDate(date / 100 % 100 == 12 ? (date / 10000 + 1) * 10000 + 101 : date + 100);
+        }
+        r.month_of_day[day] = month;
+    }
+
+    FILE *fp = fopen(LEDGER_FILENAME, "rb");
+    if (fp != NULL) {
+        while (readLedgerBlock(fp, &block, 0)) {
+            aggregateLedgerBlock(&block, &r, indexes);
+        }
+        fclose(fp);
+    }
+    if (ledger_tail.rows > 0) {
+        aggregateLedgerBlock(&ledger_tail, &r, indexes);
+    }
+    if (r.rows == 0) {
+        printf("\nNo rentals have been recorded yet.\n");
+        goto done;
+    }
+
+    int period = r.last_day - r.first_day;
+    int64_t rented_days = 0;
+    for (int i = 0; i < car_count; i++) {
+        rented_days += r.cars[i].days;
+    }
+    printf("\n--- Rental Reports ---\n");
+    printf("Rentals: %ld, from %d to %d (%d day(s))\n", r.rows, dateFromDays(r.first_day), dateFromDays(r.last_day), period);
+    printf("Total revenue: $%.2f\n", r.total_cents / 100.0);
+    if (car_count > 0 && period > 0) {
+        printf("Fleet utilisation: %.1f%% of car-days rented\n", 100.0 * rented_days / ((double)car_count * period));
+    }
+    if (r.unknown_cars > 0) {
+        printf("(%ld rental(s) refer to cars no longer in the fleet)\n", r.unknown_cars);
+    }
+
+    printf("\n--- Revenue by Month ---\n");
+    printf("%-10s %-15s\n", "Month", "Revenue");
+    printf("--------------------------\n");
+    for (int m = 0; m < (int)(sizeof(r.month_revenue) / sizeof(r.month_revenue[0])); m++) {
+        if (r.month_revenue[m] != 0) {
+            printf("%04d-%02d    %-15.2f\n", LEDGER_FIRST_YEAR + m / 12, m % 12 + 1, r.month_revenue[m] / 100.0);
+        }
+    }
+    printf("--------------------------\n");
+
+    // Group the cars by model, then keep the models with the most revenue
+    int *order = malloc((car_count + 1) * sizeof(int));
+    if (order == NULL) {
+        printf("Error: Out of memory.\n");
+        goto done;
+    }
+    for (int i = 0; i < car_count; i++) {
+        order[i] = i;
+    }
+    qsort(order, car_count, sizeof(int), compareByModel);
+    int top[TOP_MODELS], top_count = 0;
+    int64_t top_revenue[TOP_MODELS];
+    for (int start = 0, end; start < car_count; start = end) {
+        int64_t revenue = 0;
+        for (end = start; end < car_count && strcmp(fleet[order[end]].model, fleet[order[start]].model) == 0; end++) {
+            revenue += r.cars[order[end]].revenue_cents;
+        }
+        int pos = top_count < TOP_MODELS ? top_count++ : TOP_MODELS;
+        while (pos > 0 && top_revenue[pos - 1] < revenue) {
+            if (pos < TOP_MODELS) {
+                top[pos] = top[pos - 1];
+                top_revenue[pos] = top_revenue[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < TOP_MODELS) {
+            top[pos] = start;
+            top_revenue[pos] = revenue;
+        }
+    }
+
+    printf("\n--- Top Models by Revenue ---\n");
+    printf("%-30s %-6s %-10s %-15s %-s\n", "Model", "Cars", "Rentals", "Revenue", "Utilisation");
+    printf("--------------------------------------------------------------------------\n");
+    for (int t = 0; t < top_count; t++) {
+        const char *model = fleet[order[top[t]]].model;
+        int cars = 0;
+        long rentals = 0;
+        int64_t days = 0;
+        for (int i = top[t]; i < car_count && strcmp(fleet[order[i]].model, model) == 0; i++) {
+            cars++;
+            rentals += r.cars[order[i]].rentals;
+            days += r.cars[order[i]].days;
+        }
+        printf("%-30s %-6d %-10ld %-15.2f %.1f%%\n", model, cars, rentals, top_revenue[t] / 100.0,
+               period > 0 ? 100.0 * days / ((double)cars * period) : 0.0);
+    }
+    printf("--------------------------------------------------------------------------\n");
+    free(order);
+
+done:
+    free(r.cars);
+    free(r.month_of_day);
+    free(indexes);
+    freeLedgerColumns(&block);
+}
+
+// --- Branches ---
+
+/**
+ * @brief Opens a new branch.
+ * @return The index of the branch, or -1 if the ID is taken or out of memory.
+ */
+int addBranch(struct FleetNetwork *net, int id, const char *name) {
+    if (findBranch(net, id) != -1) {
+        return -1;
+    }
+    if (net->branch_count == net->branch_capacity) {
+        int capacity = net->branch_capacity ? net->branch_capacity * 2 : 8;
+        struct Branch **grown = realloc(net->branches, capacity * sizeof(struct Branch *));
+        if (grown == NULL) {
+            return -1;
+        }
+        net->branches = grown;
+        net->branch_capacity = capacity;
+    }
+    struct Branch *b = calloc(1, sizeof(struct Branch));
+    if (b == NULL) {
+        return -1;
+    }
+    pthread_mutex_init(&b->lock, NULL);
+    b->id = id;
+    strncpy(b->name, name, BRANCH_NAME_LEN - 1);
+    b->available_head = -1;
+    net->branches[net->branch_count] = b;
+    return net->branch_count++;
+}
+
+/**
+ * @brief Finds a branch by its ID (there are few branches, so a scan is enough).
+ * @return Index of the branch, or -1 if not found.
+ */
+int findBranch(const struct FleetNetwork *net, int id) {
+    for (int i = 0; i < net->branch_count; i++) {
+        if (net->branches[i]->id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Asks for a branch ID.
+ * @return Index of the branch, or -1 (with a message) if there is none.
+ */
+int askBranch(const char *prompt) {
+    int id;
+    printf("%s: ", prompt);
+    scanf("%d", &id);
+    while (getchar() != '\n');
+    int branch = findBranch(&network, id);
+    if (branch == -1) {
+        printf("Error: Branch with ID %d not found.\n", id);
+    }
+    return branch;
+}
+
+/**
+ * @brief Grows the per-car arrays of a network to 'capacity' cars.
+ * @return 1 on success, 0 if out of memory.
+ */
+int growNetwork(struct FleetNetwork *net, int capacity) {
+    if (capacity <= net->car_capacity) {
+        return 1;
+    }
+    _Atomic int *where = realloc(net->car_branch, (size_t)capacity * sizeof(_Atomic int));
+    if (where == NULL) {
+        return 0;
+    }
+    net->car_branch = where;
+    int *prev = realloc(net->available_prev, (size_t)capacity * sizeof(int));
+    if (prev == NULL) {
+        return 0;
+    }
+    net->available_prev = prev;
+    int *next = realloc(net->available_next, (size_t)capacity * sizeof(int));
+    if (next == NULL) {
+        return 0;
+    }
+    net->available_next = next;
+    for (int i = net->car_capacity; i < capacity; i++) {
+        atomic_init(&net->car_branch[i], 0);
+    }
+    net->car_capacity = capacity;
+    return 1;
+}
+
+/**
+ * @brief Bases a newly added or loaded car at a branch. Not thread-safe;
+ * used while the fleet is being built.
+ */
+void placeCar(struct FleetNetwork *net, int index, int branch) {
+    atomic_store(&net->car_branch[index], branch);
+    net->branches[branch]->car_count++;
+    if (net->cars[index].is_available) {
+        markAvailable(net, index);
+    }
+}
+
+/**
+ * @brief Marks a car as available and links it at the head of its branch's
+ * list. The caller holds the branch lock.
+ */
+void markAvailable(struct FleetNetwork *net, int index) {
+    struct Branch *b = net->branches[atomic_load_explicit(&net->car_branch[index], memory_order_relaxed)];
+    net->cars[index].is_available = 1;
+    net->available_prev[index] = -1;
+    net->available_next[index] = b->available_head;
+    if (b->available_head != -1) {
+        net->available_prev[b->available_head] = index;
+    }
+    b->available_head = index;
+    b->available_count++;
+}
+
+/**
+ * @brief Marks an available car as rented and unlinks it from its branch's
+ * list. The caller holds the branch lock.
+ */
+void markRented(struct FleetNetwork *net, int index) {
+    struct Branch *b = net->branches[atomic_load_explicit(&net->car_branch[index], memory_order_relaxed)];
+    net->cars[index].is_available = 0;
+    int prev = net->available_prev[index], next = net->available_next[index];
+    if (prev != -1) {
+        net->available_next[prev] = next;
+    } else {
+        b->available_head = next;
+    }
+    if (next != -1) {
+        net->available_prev[next] = prev;
+    }
+    b->available_count--;
+}
+
+// Locks a branch, counting the times another thread already held it
+static void lockBranch(struct Branch *b) {
+    if (pthread_mutex_trylock(&b->lock) != 0) {
+        pthread_mutex_lock(&b->lock);
+        b->contended++;
+    }
+}
+
+/**
+ * @brief Rents out a car that is available at the given branch. Takes only
+ * that branch's lock.
+ * @return 1 on success, 0 if the car is not available there.
+ */
+int rentFromBranch(struct FleetNetwork *net, int branch, int index) {
+    struct Branch *b = net->branches[branch];
+    lockBranch(b);
+    int ok = atomic_load(&net->car_branch[index]) == branch && net->cars[index].is_available;
+    if (ok) {
+        markRented(net, index);
+    }
+    pthread_mutex_unlock(&b->lock);
+    return ok;
+}
+
+/**
+ * @brief Rents out the first available car of a branch.
+ * @return Index of the car, or -1 if the branch has none available.
+ */
+int rentAnyFromBranch(struct FleetNetwork *net, int branch) {
+    struct Branch *b = net->branches[branch];
+    lockBranch(b);
+    int index = b->available_head;
+    if (index != -1) {
+        markRented(net, index);
+    }
+    pthread_mutex_unlock(&b->lock);
+    return index;
+}
+
+/**
+ * @brief Returns a rented car to a branch, which may differ from the one it
+ * was picked up at. A one-way return holds both branch locks, always taken
+ * in index order so that two opposite moves cannot deadlock.
+ * @return 1 on success, 0 if the car is not out on rental.
+ */
+int returnToBranch(struct FleetNetwork *net, int index, int branch) {
+    for (;;) {
+        int from = atomic_load(&net->car_branch[index]);
+        struct Branch *first = net->branches[from < branch ? from : branch];
+        struct Branch *second = net->branches[from < branch ? branch : from];
+        lockBranch(first);
+        if (second != first) {
+            lockBranch(second);
+        }
+        // The car's location can only change under the lock of its branch
+        int moved = atomic_load(&net->car_branch[index]) != from;
+        int ok = !moved && !net->cars[index].is_available;
+        if (ok) {
+            net->branches[from]->car_count--;
+            net->branches[branch]->car_count++;
+            atomic_store(&net->car_branch[index], branch);
+            markAvailable(net, index);
+        }
+        if (second != first) {
+            pthread_mutex_unlock(&second->lock);
+        }
+        pthread_mutex_unlock(&first->lock);
+        if (!moved) {
+            return ok;
+        }
+    }
+}
+
+/**
+ * @brief Counts the available cars of all branches.
+ */
+int countAvailable(const struct FleetNetwork *net) {
+    int total = 0;
+    for (int i = 0; i < net->branch_count; i++) {
+        total += net->branches[i]->available_count;
+    }
+    return total;
+}
+
+static void freeNetwork(struct FleetNetwork *net) {
+    for (int i = 0; i < net->branch_count; i++) {
+        pthread_mutex_destroy(&net->branches[i]->lock);
+        free(net->branches[i]);
+    }
+    free(net->branches);
+    free(net->car_branch);
+    free(net->available_prev);
+    free(net->available_next);
+    memset(net, 0, sizeof(*net));
+}
+
+/**
+ * @brief Lists the branches with their cars, and opens new ones.
+ */
+void manageBranches() {
+    printf("\n--- Branches ---\n");
+    printf("%-10s %-30s %-10s %-s\n", "Branch ID", "Name", "Cars", "Available");
+    printf("------------------------------------------------------------\n");
+    for (int i = 0; i < network.branch_count; i++) {
+        struct Branch *b = network.branches[i];
+        printf("%-10d %-30s %-10d %-d\n", b->id, b->name, b->car_count, b->available_count);
+    }
+    printf("------------------------------------------------------------\n");
+
+    int choice;
+    printf("1. Open a New Branch\n");
+    printf("2. Back\n");
+    printf("Enter your choice: ");
+    scanf("%d", &choice);
+    while (getchar() != '\n');
+    if (choice != 1) {
+        return;
+    }
+
+    int id;
+    char name[BRANCH_NAME_LEN];
+    printf("Enter Branch ID: ");
+    scanf("%d", &id);
+    while (getchar() != '\n');
+    if (findBranch(&network, id) != -1) {
+        printf("Error: A branch with ID %d already exists.\n", id);
+        return;
+    }
+    printf("Enter Branch Name: ");
+    fgets(name, sizeof(name), stdin);
+    name[strcspn(name, "\n")] = 0;
+    if (addBranch(&network, id, name) == -1) {
+        printf("Error: Out of memory.\n");
+        return;
+    }
+    printf("Branch %d (%s) opened.\n", id, name);
+}
+
+/**
+ * @brief Reads branches.dat, opening a first branch if there is none.
+ */
+void loadBranches() {
+    FILE *fp = fopen(BRANCHES_FILENAME, "rb");
+    if (fp != NULL) {
+        struct BranchRecord record;
+        while (fread(&record, sizeof(record), 1, fp) == 1) {
+            record.name[BRANCH_NAME_LEN - 1] = 0;
+            addBranch(&network, record.id, record.name);
+        }
+        fclose(fp);
+    }
+    if (network.branch_count == 0 && addBranch(&network, DEFAULT_BRANCH_ID, "Main") == -1) {
+        printf("Error: Out of memory.\n");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Writes every branch to branches.dat.
+ */
+void saveBranches() {
+    FILE *fp = fopen(BRANCHES_FILENAME, "wb");
+    if (fp == NULL) {
+        printf("Error opening %s for writing.\n", BRANCHES_FILENAME);
+        return;
+    }
+    for (int i = 0; i < network.branch_count; i++) {
+        struct BranchRecord record = {network.branches[i]->id, {0}};
+        strcpy(record.name, network.branches[i]->name);
+        fwrite(&record, sizeof(record), 1, fp);
+    }
+    fclose(fp);
+}
+
+// --- Branch Concurrency Benchmark ---
+
+struct BranchBenchWorker {
+    struct FleetNetwork *net;
+    _Atomic int *start;
+    int home;            // Branch where this agent rents cars out
+    int staffed;         // Branches 0..staffed-1 have agents; one-way returns go there
+    int one_way_percent; // Share of returns that go to another branch
+    long ops;
+    uint64_t seed;
+    long rentals;
+    long one_way;
+    long away;           // Rentals made at another branch because home had no car
+    long empty;          // Attempts that found no car at either branch
+    long violations;
+};
+
+static uint64_t nextBenchRandom(struct BranchBenchWorker *w) {
+    w->seed ^= w->seed >> 12; // xorshift64*
+    w->seed ^= w->seed << 25;
+    w->seed ^= w->seed >> 27;
+    return (w->seed * 2685821657736338717ULL) >> 32;
+}
+
+// A random staffed branch other than the agent's home
+static int otherBranch(struct BranchBenchWorker *w, uint64_t r) {
+    return (w->home + 1 + (int)(r % (w->staffed - 1))) % w->staffed;
+}
+
+/**
+ * @brief One rental agent: rents the first available car of its branch and
+ * returns it, either to the same branch or to a random other one. One-way
+ * rentals drain some branches, so when its own branch is empty the agent
+ * rents at another branch instead, as staff moving cars back would.
+ */
+static void *branchBenchWorker(void *arg) {
+    struct BranchBenchWorker *w = arg;
+    struct FleetNetwork *net = w->net;
+    while (!atomic_load(w->start)); // Start all agents together
+
+    for (long i = 0; i < w->ops; i++) {
+        uint64_t r = nextBenchRandom(w);
+        int index = rentAnyFromBranch(net, w->home);
+        if (index == -1 && w->staffed > 1) {
+            index = rentAnyFromBranch(net, otherBranch(w, r >> 16));
+            w->away += index != -1;
+        }
+        if (index == -1) {
+            w->empty++;
+            continue;
+        }
+        w->rentals++;
+        int to = w->home;
+        if (w->staffed > 1 && (int)(r % 100) < w->one_way_percent) {
+            to = otherBranch(w, r >> 8);
+            w->one_way++;
+        }
+        if (!returnToBranch(net, index, to)) {
+            w->violations++; // The car was not out on rental
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Checks that every car is on exactly one available list (the one of
+ * its branch), and that the counters agree with the lists.
+ */
+static int networkConsistent(const struct FleetNetwork *net, int car_total) {
+    char *seen = calloc(car_total, 1);
+    if (seen == NULL) {
+        return 0;
+    }
+    int ok = 1, cars = 0, listed = 0;
+    for (int b = 0; b < net->branch_count; b++) {
+        int count = 0;
+        for (int i = net->branches[b]->available_head; i != -1 && ok; i = net->available_next[i]) {
+            ok = !seen[i] && atomic_load(&net->car_branch[i]) == b && net->cars[i].is_available;
+            seen[i] = 1;
+            count++;
+        }
+        ok = ok && count == net->branches[b]->available_count;
+        cars += net->branches[b]->car_count;
+        listed += count;
+    }
+    free(seen);
+    return ok && cars == car_total && listed == car_total;
+}
+
+/**
+ * @brief Runs one benchmark round on a scratch fleet spread over 'branches'
+ * branches, with the agents spread evenly over them.
+ * @return 1 if it ran, 0 if out of memory.
+ */
+static int runBranchRound(int branches, int cars_per_branch, int thread_count, long ops, int one_way_percent) {
+    int car_total = branches * cars_per_branch;
+    struct FleetNetwork net;
+    memset(&net, 0, sizeof(net));
+    net.cars = calloc(car_total, sizeof(struct Car));
+    struct BranchBenchWorker *workers = calloc(thread_count, sizeof(struct BranchBenchWorker));
+    pthread_t *threads = calloc(thread_count, sizeof(pthread_t));
+    int ok = net.cars != NULL && workers != NULL && threads != NULL && growNetwork(&net, car_total);
+    for (int b = 0; ok && b < branches; b++) {
+        ok = addBranch(&net, b + 1, "Bench") != -1;
+    }
+    if (!ok) {
+        printf("Error: Out of memory.\n");
+        free(net.cars);
+        free(workers);
+        free(threads);
+        freeNetwork(&net);
+        return 0;
+    }
+    for (int i = 0; i < car_total; i++) {
+        net.cars[i].id = i + 1;
+        net.cars[i].is_available = 1;
+        placeCar(&net, i, i % branches);
+    }
+
+    _Atomic int start = 0;
+    int started = 0;
+    for (; started < thread_count; started++) {
+        struct BranchBenchWorker *w = &workers[started];
+        w->net = &net;
+        w->start = &start;
+        w->home = started % branches;
+        w->staffed = thread_count < branches ? thread_count : branches;
+        w->one_way_percent = one_way_percent;
+        w->ops = ops;
+        w->seed = 0x9E3779B97F4A7C15ULL * (started + 1);
+        if (pthread_create(&threads[started], NULL, branchBenchWorker, w) != 0) {
+            printf("Warning: Only %d thread(s) could be started.\n", started);
+            break;
+        }
+    }
+
+    struct timespec t_start, t_end;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    atomic_store(&start, 1);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+    long rentals = 0, one_way = 0, away = 0, empty = 0, violations = 0, contended = 0;
+    for (int i = 0; i < started; i++) {
+        rentals += workers[i].rentals;
+        one_way += workers[i].one_way;
+        away += workers[i].away;
+        empty += workers[i].empty;
+        violations += workers[i].violations;
+    }
+    for (int b = 0; b < branches; b++) {
+        contended += net.branches[b]->contended;
+    }
+    long locks = 2 * rentals + one_way + away + empty; // One lock to rent, one or two to return
+    double seconds = (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+
+    char waits[32];
+    snprintf(waits, sizeof(waits), "%.2f%%", locks > 0 ? 100.0 * contended / locks : 0.0);
+    printf("%-10d %-10d %-12ld %-12ld %-12ld %-15.0f %-13s %-10ld %-s\n", branches, started, rentals, one_way, away,
+           seconds > 0 ? rentals / seconds : 0.0, waits, violations, networkConsistent(&net, car_total) ? "yes" : "NO");
+
+    free(net.cars);
+    free(workers);
+    free(threads);
+    freeNetwork(&net);
+    return 1;
+}
+
+/**
+ * @brief Runs N agents renting and returning cars, first with the fleet
+ * split over many branches and then with the same fleet in a single branch,
+ * and reports throughput and how often an agent had to wait for a lock.
+ * Uses a scratch fleet, so the real one is left untouched.
+ */
+void runBranchBenchmark() {
+    int branches, cars_per_branch, thread_count, one_way_percent;
+    long ops;
+    printf("Enter number of branches: ");
+    scanf("%d", &branches);
+    while (getchar() != '\n');
+    printf("Enter cars per branch: ");
+    scanf("%d", &cars_per_branch);
+    while (getchar() != '\n');
+    printf("Enter number of agent threads (1-%d): ", MAX_BENCH_THREADS);
+    scanf("%d", &thread_count);
+    while (getchar() != '\n');
+    printf("Enter rentals per thread: ");
+    scanf("%ld", &ops);
+    while (getchar() != '\n');
+    printf("Enter percentage of one-way rentals (0-100): ");
+    scanf("%d", &one_way_percent);
+    while (getchar() != '\n');
+
+    if (branches < 1 || cars_per_branch < 1 || branches > INT_MAX / cars_per_branch || thread_count < 1 ||
+        thread_count > MAX_BENCH_THREADS || ops <= 0 || one_way_percent < 0 || one_way_percent > 100) {
+        printf("Error: Invalid benchmark parameters.\n");
+        return;
+    }
+
+    printf("\n--- Branch Concurrency Benchmark Results ---\n");
+    printf("%-10s %-10s %-12s %-12s %-12s %-15s %-13s %-10s %-s\n", "Branches", "Threads", "Rentals", "One-way",
+           "Elsewhere", "Rentals/sec", "Lock waits", "Errors", "Consistent");
+    printf("----------------------------------------------------------------------------------------------------------------\n");
+    if (runBranchRound(branches, cars_per_branch, thread_count, ops, one_way_percent) && branches > 1) {
+        // The same fleet and traffic with one shared lock, for comparison
+        runBranchRound(1, branches * cars_per_branch, thread_count, ops, 0);
+    }
+    printf("----------------------------------------------------------------------------------------------------------------\n");
+}
+
+// --- Pricing Engine ---
+
+static int classByName(const char *name) {
+    for (int c = 0; c < VEHICLE_CLASSES; c++) {
+        const char *a = name, *b = class_names[c];
+        while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+            a++, b++;
+        }
+        if (*a == 0 && *b == 0) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+static int validMonthDay(int mmdd) {
+    return daysFromDate(2000 * 10000 + mmdd) != INT_MIN; // 2000 is a leap year, so 0229 is allowed
+}
+
+static int inSeason(const struct Season *season, int mmdd) {
+    if (season->from_mmdd <= season->to_mmdd) {
+        return mmdd >= season->from_mmdd && mmdd <= season->to_mmdd;
+    }
+    return mmdd >= season->from_mmdd || mmdd <= season->to_mmdd; // Over New Year
+}
+
+/**
+ * @brief The price multiplier of one day for one vehicle class: class x
+ * every season covering the day x the weekend factor on Saturdays and
+ * Sundays. This is the reference the compiled table is built from.
+ */
+double dayFactor(int vehicle_class, int day) {
+    int mmdd = dateFromDays(day) % 10000;
+    double factor = pricing.class_factor[vehicle_class];
+    for (int i = 0; i < pricing.season_count; i++) {
+        const struct Season *season = &pricing.seasons[i];
+        if ((season->vehicle_class == -1 || season->vehicle_class == vehicle_class) && inSeason(season, mmdd)) {
+            factor *= season->factor;
+        }
+    }
+    int weekday = (day % 7 + 11) % 7; // 0 = Sunday; day 0 (1970-01-01) was a Thursday
+    if (weekday == 0 || weekday == 6) {
+        factor *= pricing.weekend_factor;
+    }
+    return factor;
+}
+
+/**
+ * @brief Builds the prefix sums of dayFactor() for every class over a
+ * window of days around today.
+ */
+static void compilePrices() {
+    struct PriceTable *t = &price_table;
+    t->first_day = today() - PRICE_WINDOW_PAST_DAYS;
+    t->days = PRICE_WINDOW_PAST_DAYS + PRICE_WINDOW_FUTURE_DAYS;
+    for (int c = 0; c < VEHICLE_CLASSES; c++) {
+        free(t->prefix[c]);
+        t->prefix[c] = malloc((t->days + 1) * sizeof(double));
+        if (t->prefix[c] == NULL) {
+            t->days = 0; // rangeFactor() falls back to evaluating the rules day by day
+            return;
+        }
+        t->prefix[c][0] = 0;
+        for (int d = 0; d < t->days; d++) {
+            t->prefix[c][d + 1] = t->prefix[c][d] + dayFactor(c, t->first_day + d);
+        }
+    }
+}
+
+/**
+ * @brief Sum of the daily multipliers of a class over [start_day, end_day):
+ * two lookups inside the compiled window, a walk over the days outside it.
+ */
+double rangeFactor(int vehicle_class, int start_day, int end_day) {
+    const struct PriceTable *t = &price_table;
+    if (t->days > 0 && start_day >= t->first_day && end_day <= t->first_day + t->days) {
+        return t->prefix[vehicle_class][end_day - t->first_day] - t->prefix[vehicle_class][start_day - t->first_day];
+    }
+    double sum = 0;
+    for (int day = start_day; day < end_day; day++) {
+        sum += dayFactor(vehicle_class, day);
+    }
+    return sum;
+}
+
+/**
+ * @brief The multiplier of the longest duration tier a rental reaches.
+ */
+double durationFactor(int days) {
+    double factor = 1;
+    for (int i = 0; i < pricing.tier_count && pricing.tiers[i].min_days <= days; i++) {
+        factor = 1 - pricing.tiers[i].percent_off / 100;
+    }
+    return factor;
+}
+
+/**
+ * @brief Finds a discount code (any case).
+ * @return Index in pricing.discounts, or -1.
+ */
+int findDiscount(const char *code) {
+    for (int i = 0; i < pricing.discount_count; i++) {
+        const char *a = code, *b = pricing.discounts[i].code;
+        while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+            a++, b++;
+        }
+        if (*a == 0 && *b == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Quotes many cars for the same date range. Everything that depends
+ * only on the range is worked out once per class, so each car costs one
+ * multiplication.
+ * @param prices Receives the price of each car, rounded to cents.
+ */
+void quoteCars(const int *indexes, int count, int start_day, int end_day, double percent_off, double *prices) {
+    double per_class[VEHICLE_CLASSES];
+    double common = durationFactor(end_day - start_day) * (1 - percent_off / 100);
+    for (int c = 0; c < VEHICLE_CLASSES; c++) {
+        per_class[c] = rangeFactor(c, start_day, end_day) * common;
+    }
+    for (int i = 0; i < count; i++) {
+        const struct Car *car = &fleet[indexes[i]];
+        double price = car->rent_per_day * per_class[car->vehicle_class];
+        prices[i] = (int64_t)(price * 100 + 0.5) / 100.0;
+    }
+}
+
+/**
+ * @brief Reads pricing.txt (if present) and compiles it.
+ */
+void loadPricing() {
+    memset(&pricing, 0, sizeof(pricing));
+    for (int c = 0; c < VEHICLE_CLASSES; c++) {
+        pricing.class_factor[c] = 1;
+    }
+    pricing.weekend_factor = 1;
+
+    FILE *fp = fopen(PRICING_FILENAME, "r");
+    if (fp != NULL) {
+        char line[256];
+        int line_number = 0;
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            line_number++;
+            char *text = line + strspn(line, " \t");
+            if (*text == '#' || *text == '\n' || *text == 0) {
+                continue;
+            }
+            char word[DISCOUNT_CODE_LEN + 12];
+            double value;
+            int from, to, min_days, fields, c;
+            if (sscanf(text, "class %31s %lf", word, &value) == 2 && (c = classByName(word)) != -1 && value > 0) {
+                pricing.class_factor[c] = value;
+            } else if (sscanf(text, "weekend %lf", &value) == 1 && value > 0) {
+                pricing.weekend_factor = value;
+            } else if ((fields = sscanf(text, "season %d %d %lf %31s", &from, &to, &value, word)) >= 3 &&
+                       pricing.season_count < MAX_SEASONS && validMonthDay(from) && validMonthDay(to) && value > 0 &&
+                       (fields == 3 || classByName(word) != -1)) {
+                pricing.seasons[pricing.season_count++] =
+                    (struct Season){from, to, value, fields == 3 ? -1 : classByName(word)};
+            } else if (sscanf(text, "duration %d %lf", &min_days, &value) == 2 && min_days > 0 && value >= 0 &&
+                       value < 100 && pricing.tier_count < MAX_DURATION_TIERS) {
+                int pos = pricing.tier_count++;
+                while (pos > 0 && pricing.tiers[pos - 1].min_days > min_days) {
+                    pricing.tiers[pos] = pricing.tiers[pos - 1];
+                    pos--;
+                }
+                pricing.tiers[pos] = (struct DurationTier){min_days, value};
+            } else if (sscanf(text, "discount %19s %lf", word, &value) == 2 && value >= 0 && value < 100 &&
+                       pricing.discount_count < MAX_DISCOUNTS && findDiscount(word) == -1) {
+                struct Discount *d = &pricing.discounts[pricing.discount_count++];
+                strcpy(d->code, word);
+                d->percent_off = value;
+            } else {
+                printf("Warning: %s line %d is not a valid rule and was ignored.\n", PRICING_FILENAME, line_number);
+            }
+        }
+        fclose(fp);
+    }
+    compilePrices();
+}
+
+/**
+ * @brief Asks for an optional discount code.
+ * @return The percentage off (0 for none), or -1 for an unknown code.
+ */
+double askDiscount() {
+    char code[DISCOUNT_CODE_LEN + 2];
+    printf("Enter discount code (or leave blank for none): ");
+    fgets(code, sizeof(code), stdin);
+    if (strchr(code, '\n') == NULL) {
+        while (getchar() != '\n');
+    }
+    code[strcspn(code, "\n")] = 0;
+    if (code[0] == 0) {
+        return 0;
+    }
+    int d = findDiscount(code);
+    if (d == -1) {
+        printf("Error: Unknown discount code '%s'.\n", code);
+        return -1;
+    }
+    return pricing.discounts[d].percent_off;
+}
+
+/**
+ * @brief Shows the pricing rules in effect.
+ */
+void displayPricingRules() {
+    printf("\n--- Pricing Rules ---\n");
+    printf("Class multipliers:");
+    for (int c = 0; c < VEHICLE_CLASSES; c++) {
+        printf(" %s x%.2f", class_names[c], pricing.class_factor[c]);
+    }
+    printf("\nWeekend (Sat, Sun) multiplier: x%.2f\n", pricing.weekend_factor);
+    for (int i = 0; i < pricing.season_count; i++) {
+        const struct Season *s = &pricing.seasons[i];
+        printf("Season %02d-%02d to %02d-%02d: x%.2f for %s\n", s->from_mmdd / 100, s->from_mmdd % 100,
+               s->to_mmdd / 100, s->to_mmdd % 100, s->factor,
+               s->vehicle_class == -1 ? "all classes" : class_names[s->vehicle_class]);
+    }
+    for (int i = 0; i < pricing.tier_count; i++) {
+        printf("Rentals of %d+ days: %.1f%% off\n", pricing.tiers[i].min_days, pricing.tiers[i].percent_off);
+    }
+    for (int i = 0; i < pricing.discount_count; i++) {
+        printf("Discount code %s: %.1f%% off\n", pricing.discounts[i].code, pricing.discounts[i].percent_off);
+    }
+    if (pricing.season_count + pricing.tier_count + pricing.discount_count == 0) {
+        printf("(No seasons, duration tiers or discount codes; add them to %s.)\n", PRICING_FILENAME);
+    }
+    printf("---------------------\n");
+}
+
+// --- Model Search ---
+
+/**
+ * @brief Folds a model name for matching: lower case letters and digits,
+ * with every run of other characters turned into one space.
+ * @return Length of the folded text.
+ */
+static int foldModel(const char *text, char *folded, int size) {
+    int len = 0;
+    for (; *text && len < size - 1; text++) {
+        unsigned char c = (unsigned char)*text;
+        if (isalnum(c)) {
+            folded[len++] = (char)tolower(c);
+        } else if (len > 0 && folded[len - 1] != ' ') {
+            folded[len++] = ' ';
+        }
+    }
+    if (len > 0 && folded[len - 1] == ' ') {
+        len--;
+    }
+    folded[len] = 0;
+    return len;
+}
+
+static int gramSymbol(char c) {
+    return c == ' ' ? 0 : (c >= 'a' && c <= 'z') ? c - 'a' + 1 : c - '0' + 27;
+}
+
+static int compareInts(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief The distinct trigrams of a folded name, padded with a space at
+ * each end so that word starts and ends count too.
+ * @return The number of trigrams written to 'grams'.
+ */
+static int modelGrams(const char *folded, int len, int *grams) {
+    if (len == 0) {
+        return 0;
+    }
+    char padded[MAX_MODEL_GRAMS + 2];
+    padded[0] = ' ';
+    memcpy(padded + 1, folded, len);
+    padded[len + 1] = ' ';
+    int count = 0;
+    for (int i = 0; i < len; i++) {
+        grams[count++] = (gramSymbol(padded[i]) * GRAM_ALPHABET + gramSymbol(padded[i + 1])) * GRAM_ALPHABET +
+                         gramSymbol(padded[i + 2]);
+    }
+    qsort(grams, count, sizeof(int), compareInts);
+    int distinct = 0;
+    for (int i = 0; i < count; i++) {
+        if (distinct == 0 || grams[distinct - 1] != grams[i]) {
+            grams[distinct++] = grams[i];
+        }
+    }
+    return distinct;
+}
+
+static unsigned int hashText(const char *text) {
+    unsigned int h = 2166136261u; // FNV-1a
+    for (; *text; text++) {
+        h = (h ^ (unsigned char)*text) * 16777619u;
+    }
+    return h;
+}
+
+static int growInts(int **items, int *capacity, int needed) {
+    if (needed <= *capacity) {
+        return 1;
+    }
+    int grown_capacity = *capacity ? *capacity * 2 : 4;
+    int *grown = realloc(*items, grown_capacity * sizeof(int));
+    if (grown == NULL) {
+        return 0;
+    }
+    *items = grown;
+    *capacity = grown_capacity;
+    return 1;
+}
+
+/**
+ * @brief Finds the model entry of a folded name in the hash table.
+ * @return Slot of the entry, or of the empty slot where it belongs.
+ */
+static int findModelSlot(const char *folded) {
+    unsigned int mask = model_slot_capacity - 1;
+    unsigned int slot = hashText(folded) & mask;
+    while (model_slots[slot] != -1 && strcmp(models[model_slots[slot]].key, folded) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/**
+ * @brief Adds a car to the model search index, creating the model entry
+ * and its trigram postings the first time a model is seen.
+ * @return The model number, or -1 if out of memory.
+ */
+int indexModel(int index) {
+    char folded[100];
+    int len = foldModel(fleet[index].model, folded, sizeof(folded));
+    if (gram_postings == NULL) {
+        gram_postings = calloc(GRAM_SPACE, sizeof(struct GramPostings));
+        if (gram_postings == NULL) {
+            return -1;
+        }
+    }
+    if (2 * (model_count + 1) > model_slot_capacity) {
+        int capacity = model_slot_capacity ? model_slot_capacity * 2 : 64;
+        int *slots = malloc(capacity * sizeof(int));
+        if (slots == NULL) {
+            return -1;
+        }
+        free(model_slots);
+        model_slots = slots;
+        model_slot_capacity = capacity;
+        for (int i = 0; i < capacity; i++) {
+            model_slots[i] = -1;
+        }
+        for (int m = 0; m < model_count; m++) {
+            model_slots[findModelSlot(models[m].key)] = m;
+        }
+    }
+
+    int slot = findModelSlot(folded);
+    int m = model_slots[slot];
+    if (m == -1) {
+        if (model_count == model_capacity) {
+            int capacity = model_capacity ? model_capacity * 2 : 64;
+            struct ModelEntry *grown = realloc(models, capacity * sizeof(struct ModelEntry));
+            if (grown == NULL) {
+                return -1;
+            }
+            models = grown;
+            model_capacity = capacity;
+        }
+        int grams[MAX_MODEL_GRAMS];
+        int gram_count = modelGrams(folded, len, grams);
+        for (int g = 0; g < gram_count; g++) {
+            struct GramPostings *p = &gram_postings[grams[g]];
+            if (!growInts(&p->models, &p->capacity, p->count + 1)) {
+                // Take back the postings already added: the next new model
+                // gets this number and must not inherit them
+                while (g-- > 0) {
+                    gram_postings[grams[g]].count--;
+                }
+                return -1;
+            }
+            p->models[p->count++] = model_count;
+        }
+        m = model_count++;
+        struct ModelEntry *e = &models[m];
+        strcpy(e->name, fleet[index].model);
+        strcpy(e->key, folded);
+        e->gram_count = gram_count;
+        e->cars = NULL;
+        e->car_count = e->car_capacity = 0;
+        model_slots[slot] = m;
+    }
+    struct ModelEntry *e = &models[m];
+    if (!growInts(&e->cars, &e->car_capacity, e->car_count + 1)) {
+        return -1;
+    }
+    e->cars[e->car_count++] = index;
+    return m;
+}
+
+/**
+ * @brief Finds the models closest to a query. A model's score is the share
+ * of the query's trigrams it contains (so a typo costs only the few
+ * trigrams around it), with the overlap relative to both names (Jaccard)
+ * breaking ties in favour of names without extra words. Models sharing
+ * fewer than half of the query's trigrams are left out.
+ * @return The number of models written to 'results', best first.
+ */
+int searchModels(const char *query, int *results, double *scores, int max_results) {
+    static unsigned char *hits = NULL; // Per model: trigrams shared with the query
+    static int hits_capacity = 0;
+    static int *touched = NULL;
+    char folded[100];
+    int grams[MAX_MODEL_GRAMS];
+    int gram_count = modelGrams(folded, foldModel(query, folded, sizeof(folded)), grams);
+    if (gram_count == 0 || gram_postings == NULL) {
+        return 0;
+    }
+    if (hits_capacity < model_count) {
+        unsigned char *h = realloc(hits, model_capacity);
+        int *t = realloc(touched, model_capacity * sizeof(int));
+        if (h != NULL) {
+            hits = h;
+        }
+        if (t != NULL) {
+            touched = t;
+        }
+        if (h == NULL || t == NULL) {
+            return 0;
+        }
+        memset(hits + hits_capacity, 0, model_capacity - hits_capacity);
+        hits_capacity = model_capacity;
+    }
+
+    int touched_count = 0;
+    for (int g = 0; g < gram_count; g++) {
+        const struct GramPostings *p = &gram_postings[grams[g]];
+        for (int i = 0; i < p->count; i++) {
+            int m = p->models[i];
+            if (m < model_count && hits[m]++ == 0) {
+                touched[touched_count++] = m;
+            }
+        }
+    }
+
+    int found = 0;
+    int needed = (gram_count + 1) / 2;
+    for (int i = 0; i < touched_count; i++) {
+        int m = touched[i];
+        int shared = hits[m];
+        hits[m] = 0;
+        if (shared < needed) {
+            continue;
+        }
+        double containment = (double)shared / gram_count;
+        double jaccard = (double)shared / (gram_count + models[m].gram_count - shared);
+        double score = containment + jaccard / 1000; // Jaccard only decides between equal containments
+        int pos = found < max_results ? found++ : max_results;
+        while (pos > 0 && scores[pos - 1] < score) {
+            if (pos < max_results) {
+                results[pos] = results[pos - 1];
+                scores[pos] = scores[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < max_results) {
+            results[pos] = m;
+            scores[pos] = score;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Searches the fleet by model name and lists the closest models
+ * with their cars.
+ */
+void searchCarsByModel() {
+    char query[100];
+    printf("Enter model to search for: ");
+    fgets(query, sizeof(query), stdin);
+    if (strchr(query, '\n') == NULL) {
+        while (getchar() != '\n');
+    }
+    query[strcspn(query, "\n")] = 0;
+
+    int results[MODEL_RESULTS];
+    double scores[MODEL_RESULTS];
+    int found = searchModels(query, results, scores, MODEL_RESULTS);
+    if (found == 0) {
+        printf("No models match '%s'.\n", query);
+        return;
+    }
+    printf("\n--- Models Matching '%s' ---\n", query);
+    printf("%-30s %-8s %-8s %-10s %-s\n", "Model", "Match", "Cars", "Available", "Car IDs");
+    printf("--------------------------------------------------------------------------------\n");
+    for (int r = 0; r < found; r++) {
+        const struct ModelEntry *e = &models[results[r]];
+        int available = 0;
+        for (int i = 0; i < e->car_count; i++) {
+            available += fleet[e->cars[i]].is_available;
+        }
+        printf("%-30s %5.0f%%   %-8d %-10d", e->name, scores[r] > 1 ? 100.0 : 100 * scores[r], e->car_count, available);
+        for (int i = 0; i < e->car_count && i < 5; i++) {
+            printf(" %d", fleet[e->cars[i]].id);
+        }
+        printf(e->car_count > 5 ? " ...\n" : "\n");
+    }
+    printf("--------------------------------------------------------------------------------\n");
+}
+
+// --- Fleet Import/Export ---
+
+/**
+ * @brief Reads the next CSV record and splits it into fields in place.
+ * @return The number of fields (extra ones are counted but not stored), 0
+ * at the end of the file, or -1 if a record is longer than the buffer.
+ */
+static int readCsvRecord(struct CsvReader *r, char **fields, int max_fields) {
+    char *record, *stop;
+    while (1) {
+        record = r->buffer + r->start;
+        size_t length = r->end - r->start;
+        stop = memchr(record, '\n', length);
+        if (stop != NULL && memchr(record, '"', stop - record) != NULL) {
+            // Quoted fields may contain line breaks: find the end the slow way
+            int quoted = 0;
+            stop = NULL;
+            for (char *c = record; c < record + length; c++) {
+                if (*c == '"') {
+                    quoted = !quoted;
+                } else if (*c == '\n' && !quoted) {
+                    stop = c;
+                    break;
+                }
+            }
+        }
+        if (stop != NULL) {
+            r->start = stop + 1 - r->buffer;
+            break;
+        }
+        if (r->eof) {
+            if (length == 0) {
+                return 0;
+            }
+            stop = record + length; // Last record without a line break
+            r->start = r->end;
+            break;
+        }
+        if (r->start == 0 && r->end == CSV_BUFFER_SIZE) {
+            return -1;
+        }
+        memmove(r->buffer, record, length);
+        r->start = 0;
+        r->end = length;
+        size_t got = fread(r->buffer + r->end, 1, CSV_BUFFER_SIZE - r->end, r->fp);
+        r->end += got;
+        r->eof = got == 0;
+    }
+    if (stop > record && stop[-1] == '\r') {
+        stop--;
+    }
+
+    int count = 0;
+    char *c = record;
+    while (1) {
+        char *field = c, *out;
+        if (c < stop && *c == '"') {
+            out = field;
+            c++;
+            while (c < stop) {
+                if (*c != '"') {
+                    *out++ = *c++;
+                } else if (c + 1 < stop && c[1] == '"') {
+                    *out++ = '"';
+                    c += 2;
+                } else {
+                    c++;
+                    break;
+                }
+            }
+            while (c < stop && *c != ',') {
+                c++; // Text after the closing quote is ignored
+            }
+        } else {
+            while (c < stop && *c != ',') {
+                c++;
+            }
+            out = c;
+        }
+        int last = c >= stop;
+        *out = 0; // Overwrites the comma, the line break or the spare byte
+        if (count < max_fields) {
+            fields[count] = field;
+        }
+        count++;
+        if (last) {
+            return count;
+        }
+        c++;
+    }
+}
+
+// Parses a whole field as a decimal integer, allowing surrounding spaces
+static int parseCsvInt(const char *text, int *value) {
+    while (*text == ' ') {
+        text++;
+    }
+    int negative = *text == '-';
+    text += negative || *text == '+';
+    if (!isdigit((unsigned char)*text)) {
+        return 0;
+    }
+    long long v = 0;
+    while (isdigit((unsigned char)*text)) {
+        v = v * 10 + (*text++ - '0');
+        if (v > (long long)INT_MAX + 1) {
+            return 0;
+        }
+    }
+    while (*text == ' ') {
+        text++;
+    }
+    v = negative ? -v : v;
+    if (*text != 0 || v > INT_MAX) {
+        return 0;
+    }
+    *value = (int)v;
+    return 1;
+}
+
+static const char *trimCsvField(char *text) {
+    while (*text == ' ') {
+        text++;
+    }
+    size_t len = strlen(text);
+    while (len > 0 && text[len - 1] == ' ') {
+        text[--len] = 0;
+    }
+    return text;
+}
+
+/**
+ * @brief Checks one CSV record, except for a duplicate ID, and if it is
+ * valid fills in fleet[index].
+ * @return NULL on success, or the reason the record was rejected.
+ */
+static const char *stageCsvCar(char **fields, int count, int index) {
+    if (count < 5) {
+        return "expected id,model,rent_per_day,class,branch";
+    }
+    struct Car *car = &fleet[index];
+    if (!parseCsvInt(fields[0], &car->id)) {
+        return "invalid car ID";
+    }
+    const char *model = trimCsvField(fields[1]);
+    if (*model == 0 || strlen(model) >= sizeof(car->model)) {
+        return "model must be 1 to 99 characters";
+    }
+    if (strpbrk(model, "\t\r\n") != NULL) {
+        return "model contains a tab or line break";
+    }
+    char *end;
+    car->rent_per_day = strtod(fields[2], &end);
+    while (*end == ' ') {
+        end++;
+    }
+    if (end == fields[2] || *end != 0 || !(car->rent_per_day > 0 && car->rent_per_day < 1e9)) {
+        return "invalid rent per day";
+    }
+    const char *class_text = trimCsvField(fields[3]);
+    int vehicle_class;
+    if (parseCsvInt(class_text, &vehicle_class)) {
+        vehicle_class = vehicle_class >= 1 && vehicle_class <= VEHICLE_CLASSES ? vehicle_class - 1 : -1;
+    } else {
+        vehicle_class = classByName(class_text);
+    }
+    if (vehicle_class == -1) {
+        return "invalid vehicle class";
+    }
+    if (!parseCsvInt(fields[4], &car->branch_id) || findBranch(&network, car->branch_id) == -1) {
+        return "unknown branch";
+    }
+    strcpy(car->model, model);
+    car->vehicle_class = vehicle_class;
+    car->is_available = 1;
+    strcpy(car->customer_name, "N/A");
+    return NULL;
+}
+
+/**
+ * @brief Finishes a batch of CSV rows: looks up all of their IDs at once,
+ * stages the rows with new IDs right after the cars staged before them and
+ * indexes them, and reports the rejected rows in order.
+ */
+static void checkCsvBatch(struct CsvBatch *b, int *staged, int *rejected) {
+    int found[CSV_BATCH_ROWS];
+    findCarsById(b->ids, b->valid, found);
+    int base = car_count + *staged;
+    for (int i = 0, k = 0; i < b->count; i++) {
+        const char *error = b->errors[i];
+        if (error == NULL) {
+            int from = base + k, to = car_count + *staged;
+            // The lookup above missed IDs repeated within this batch
+            if (found[k] != -1 || findCarById(b->ids[k]) != -1) {
+                error = "duplicate car ID";
+            } else {
+                fleet[to] = fleet[from];
+                indexCar(to);
+                (*staged)++;
+            }
+            k++;
+        }
+        if (error != NULL && ++*rejected <= CSV_ERRORS_SHOWN) {
+            printf("Row %ld: %s.\n", b->rows[i], error);
+        }
+    }
+    b->count = b->valid = 0;
+}
+
+/**
+ * @brief Imports cars from a CSV file. Valid rows are staged after the
+ * fleet and only become part of it once the whole file has been read.
+ * @param all_or_nothing If set, one invalid row cancels the whole import;
+ * otherwise invalid rows are skipped.
+ * @return The number of cars added, or -1 if the import was canceled.
+ */
+int importFleetCsv(const char *filename, int all_or_nothing) {
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        printf("Error: Cannot open %s.\n", filename);
+        return -1;
+    }
+    struct CsvReader reader = {fp, malloc(CSV_BUFFER_SIZE + 1), 0, 0, 0};
+    if (reader.buffer == NULL) {
+        printf("Error: Out of memory.\n");
+        fclose(fp);
+        return -1;
+    }
+
+    // Size the fleet once, from the file size and the rows in the first
+    // buffer, instead of growing and rehashing it many times on the way
+    fseek(fp, 0, SEEK_END);
+    long file_size = ftell(fp);
+    rewind(fp);
+    reader.end = fread(reader.buffer, 1, CSV_BUFFER_SIZE, fp);
+    long rows = 0;
+    for (char *c = reader.buffer; (c = memchr(c, '\n', reader.buffer + reader.end - c)) != NULL; c++) {
+        rows++;
+    }
+    if (reader.end > 0 && file_size > 0) {
+        double estimate = (double)rows * file_size / reader.end * 1.1 + 1;
+        if (estimate < INT_MAX / 4 - car_count) {
+            reserveFleet(car_count + (int)estimate); // Only a hint: rows past it still grow the fleet
+        }
+    }
+
+    static struct CsvBatch batch;
+    char *fields[CSV_FIELDS];
+    int staged = 0, rejected = 0, out_of_memory = 0;
+    long row = 0;
+    int count, id;
+    while ((count = readCsvRecord(&reader, fields, CSV_FIELDS)) != 0) {
+        row++;
+        if (count == 1 && *trimCsvField(fields[0]) == 0) {
+            continue; // Blank line
+        }
+        if (row == 1 && count > 0 && !parseCsvInt(fields[0], &id)) {
+            continue; // Header
+        }
+        int index = car_count + staged + batch.valid;
+        if (index == fleet_capacity) {
+            int index_capacity = car_index_capacity;
+            if (!reserveFleet(fleet_capacity * 2)) {
+                out_of_memory = 1;
+                break;
+            }
+            if (car_index_capacity != index_capacity) {
+                for (int i = car_count; i < car_count + staged; i++) {
+                    indexCar(i); // The rebuilt index only holds committed cars
+                }
+            }
+        }
+        const char *error = count == -1 ? "too long; the rest of the file was not read"
+                                        : stageCsvCar(fields, count, index);
+        batch.rows[batch.count] = row;
+        batch.errors[batch.count++] = error;
+        if (error == NULL) {
+            batch.ids[batch.valid++] = fleet[index].id;
+        }
+        if (batch.count == CSV_BATCH_ROWS || count == -1) {
+            checkCsvBatch(&batch, &staged, &rejected);
+        }
+        if (count == -1) {
+            break;
+        }
+    }
+    checkCsvBatch(&batch, &staged, &rejected);
+    int read_error = ferror(fp);
+    free(reader.buffer);
+    fclose(fp);
+    if (rejected > CSV_ERRORS_SHOWN) {
+        printf("... and %d more invalid row(s).\n", rejected - CSV_ERRORS_SHOWN);
+    }
+
+    if (out_of_memory || read_error || (all_or_nothing && rejected > 0)) {
+        rebuildCarIndex(); // Forget the staged IDs
+        if (out_of_memory) {
+            printf("Error: Out of memory.\n");
+        } else if (read_error) {
+            printf("Error reading %s.\n", filename);
+        }
+        printf("Import canceled; no cars were added.\n");
+        return -1;
+    }
+    int missing_models = 0;
+    for (int i = car_count; i < car_count + staged; i++) {
+        missing_models += indexModel(i) == -1;
+        placeCar(&network, i, findBranch(&network, fleet[i].branch_id));
+    }
+    car_count += staged;
+    printf("Imported %d car(s)", staged);
+    printf(rejected > 0 ? "; %d invalid row(s) were skipped.\n" : ".\n", rejected);
+    if (missing_models > 0) {
+        printf("Warning: Out of memory; %d car(s) will not appear in model searches.\n", missing_models);
+    }
+    return staged;
+}
+
+// Output buffer of the exporter: text is formatted straight into it
+struct CsvWriter {
+    FILE *fp;
+    char *buffer;
+    size_t used;
+};
+
+static void flushCsv(struct CsvWriter *w) {
+    fwrite(w->buffer, 1, w->used, w->fp);
+    w->used = 0;
+}
+
+static void writeCsvText(struct CsvWriter *w, const char *text) {
+    int quote = text[strcspn(text, ",\"\r\n")] != 0 || text[0] == ' ';
+    char *out = w->buffer + w->used;
+    if (quote) {
+        *out++ = '"';
+    }
+    for (; *text; text++) {
+        if (*text == '"') {
+            *out++ = '"';
+        }
+        *out++ = *text;
+    }
+    if (quote) {
+        *out++ = '"';
+    }
+    w->used = out - w->buffer;
+}
+
+static void writeCsvInt(struct CsvWriter *w, long long value) {
+    char digits[24];
+    int n = 0;
+    unsigned long long v = value < 0 ? -(unsigned long long)value : (unsigned long long)value;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    if (value < 0) {
+        w->buffer[w->used++] = '-';
+    }
+    while (n > 0) {
+        w->buffer[w->used++] = digits[--n];
+    }
+}
+
+/**
+ * @brief Writes the whole fleet to a CSV file that importFleetCsv() can
+ * read back.
+ * @return The number of cars written, or -1 on error.
+ */
+int exportFleetCsv(const char *filename) {
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        printf("Error: Cannot open %s for writing.\n", filename);
+        return -1;
+    }
+    struct CsvWriter w = {fp, malloc(CSV_BUFFER_SIZE), 0};
+    if (w.buffer == NULL) {
+        printf("Error: Out of memory.\n");
+        fclose(fp);
+        return -1;
+    }
+    const char *header = "id,model,rent_per_day,class,branch,status,customer\n";
+    w.used = strlen(header);
+    memcpy(w.buffer, header, w.used);
+    for (int i = 0; i < car_count; i++) {
+        // A record is at most about 2 x (99 + 99) + 100 bytes after quoting
+        if (w.used > CSV_BUFFER_SIZE - 1024) {
+            flushCsv(&w);
+        }
+        const struct Car *car = &fleet[i];
+        writeCsvInt(&w, car->id);
+        w.buffer[w.used++] = ',';
+        writeCsvText(&w, car->model);
+        w.buffer[w.used++] = ',';
+        long long cents = (long long)(car->rent_per_day * 100 + 0.5);
+        writeCsvInt(&w, cents / 100);
+        w.buffer[w.used++] = '.';
+        w.buffer[w.used++] = (char)('0' + cents % 100 / 10);
+        w.buffer[w.used++] = (char)('0' + cents % 10);
+        w.buffer[w.used++] = ',';
+        writeCsvText(&w, class_names[car->vehicle_class]);
+        w.buffer[w.used++] = ',';
+        writeCsvInt(&w, network.branches[atomic_load(&network.car_branch[i])]->id);
+        w.buffer[w.used++] = ',';
+        writeCsvText(&w, car->is_available ? "available" : "rented");
+        w.buffer[w.used++] = ',';
+        writeCsvText(&w, car->is_available ? "" : car->customer_name);
+        w.buffer[w.used++] = '\n';
+    }
+    flushCsv(&w);
+    free(w.buffer);
+    int failed = ferror(fp);
+    if (fclose(fp) != 0 || failed) {
+        printf("Error writing %s.\n", filename);
+        return -1;
+    }
+    return car_count;
+}
+
+/**
+ * @brief Menu for bulk CSV import and export.
+ */
+void importExportFleet() {
+    int choice;
+    printf("\n--- Import/Export Fleet CSV ---\n");
+    printf("1. Import Cars (all or nothing)\n");
+    printf("2. Import Cars (skip invalid rows)\n");
+    printf("3. Export Fleet\n");
+    printf("4. Back\n");
+    printf("Enter your choice: ");
+    scanf("%d", &choice);
+    while (getchar() != '\n');
+    if (choice < 1 || choice > 3) {
+        return;
+    }
+
+    char filename[256];
+    printf("Enter CSV file name: ");
+    fgets(filename, sizeof(filename), stdin);
+    filename[strcspn(filename, "\n")] = 0;
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    int cars = choice == 3 ? exportFleetCsv(filename) : importFleetCsv(filename, choice == 1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (cars == -1) {
+        return;
+    }
+    if (choice == 3) {
+        printf("Exported %d car(s) to %s.\n", cars, filename);
+    }
+    printf("Took %.3f seconds.\n", (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9);
+}
+
+// --- Utilisation Forecast ---
+
+// Daily demand of one model over the analysed history
+struct ModelForecast {
+    int model;
+    double average;         // Mean cars out per day
+    int peak;
+    int p50, p90, p95, p99; // Cars out on the day at that percentile
+    double busiest_week;    // Highest 7-day moving average
+    double last_month;      // 28-day moving average at the end of the history
+    double next_month;      // Forecast mean cars out over the next 28 days
+};
+
+// Work shared by the forecast thread pool. The counters are one flat
+// array with 'days + 1' entries per model: first +1 on the day a rental
+// starts and -1 on the day it ends, then, after a running sum, the cars
+// out on each day.
+struct ForecastPool {
+    int32_t *counters;
+    int days;
+    struct ModelForecast *results;
+    _Atomic int next_model; // The work queue: models not yet taken
+    _Atomic int failed;
+};
+
+// Mean of counters [from, to) of one model
+static double meanOut(const int32_t *out, int from, int to) {
+    int64_t sum = 0;
+    for (int d = from; d < to; d++) {
+        sum += out[d];
+    }
+    return to > from ? (double)sum / (to - from) : 0;
+}
+
+/**
+ * @brief Turns one model's counters into cars out per day and computes its
+ * statistics. 'histogram' is the worker's scratch space for percentiles.
+ * @return 0 if out of memory.
+ */
+static int forecastModel(struct ForecastPool *pool, int m, int **histogram, int *histogram_size) {
+    int days = pool->days;
+    int32_t *out = pool->counters + (size_t)m * (days + 1);
+    struct ModelForecast *f = &pool->results[m];
+    int32_t running = 0, peak = 0;
+    int64_t total = 0;
+    for (int d = 0; d < days; d++) {
+        running += out[d];
+        out[d] = running;
+        total += running;
+        peak = running > peak ? running : peak;
+    }
+    f->model = m;
+    f->average = (double)total / days;
+    f->peak = peak;
+
+    // Percentiles by counting: cars out per day is a small number
+    if (peak + 1 > *histogram_size) {
+        int *grown = realloc(*histogram, (peak + 1) * sizeof(int));
+        if (grown == NULL) {
+            return 0;
+        }
+        *histogram = grown;
+        *histogram_size = peak + 1;
+    }
+    int *h = *histogram;
+    memset(h, 0, (peak + 1) * sizeof(int));
+    for (int d = 0; d < days; d++) {
+        h[out[d]]++;
+    }
+    const int percents[4] = {50, 90, 95, 99};
+    int *targets[4] = {&f->p50, &f->p90, &f->p95, &f->p99};
+    for (int p = 0, value = 0, seen = h[0]; p < 4; p++) {
+        long needed = ((long)days * percents[p] + 99) / 100;
+        while (seen < needed) {
+            seen += h[++value];
+        }
+        *targets[p] = value;
+    }
+
+    int64_t week = 0, busiest = 0;
+    for (int d = 0; d < days; d++) {
+        week += out[d] - (d >= 7 ? out[d - 7] : 0);
+        busiest = d >= 6 && week > busiest ? week : busiest;
+    }
+    f->busiest_week = days >= 7 ? busiest / 7.0 : f->average;
+    f->last_month = days >= FORECAST_HORIZON ? meanOut(out, days - FORECAST_HORIZON, days) : f->average;
+
+    // The same 28 days last year, scaled by how this year's last 28 days
+    // compare with last year's; without a year of history, the last 28 days
+    int year = 365;
+    f->next_month = f->last_month;
+    if (days >= year + FORECAST_HORIZON) {
+        double last_year_next = meanOut(out, days - year, days - year + FORECAST_HORIZON);
+        double last_year_last = meanOut(out, days - year - FORECAST_HORIZON, days - year);
+        double trend = last_year_last > 0 ? f->last_month / last_year_last : 1;
+        trend = trend < 0.5 ? 0.5 : trend > 2 ? 2 : trend;
+        f->next_month = last_year_next * trend;
+    }
+    return 1;
+}
+
+static void *forecastWorker(void *arg) {
+    struct ForecastPool *pool = arg;
+    int *histogram = NULL, histogram_size = 0;
+    int first;
+    while ((first = atomic_fetch_add(&pool->next_model, FORECAST_CHUNK)) < model_count) {
+        int last = first + FORECAST_CHUNK < model_count ? first + FORECAST_CHUNK : model_count;
+        for (int m = first; m < last; m++) {
+            if (!forecastModel(pool, m, &histogram, &histogram_size)) {
+                atomic_store(&pool->failed, 1);
+            }
+        }
+    }
+    free(histogram);
+    return NULL;
+}
+
+/**
+ * @brief Adds one ledger block to the counters: two updates per rental,
+ * clipped to the analysed days.
+ * @return The number of rentals that fall within them.
+ */
+static long countLedgerBlock(const struct LedgerColumns *c, struct ForecastPool *pool, int first_day,
+                             const int *car_model, int *indexes) {
+    findCarsById(c->car_id, c->rows, indexes);
+    long counted = 0;
+    for (uint32_t i = 0; i < c->rows; i++) {
+        int m = indexes[i] < 0 ? -1 : car_model[indexes[i]];
+        int start = c->start_day[i] - first_day, end = c->end_day[i] - first_day;
+        start = start < 0 ? 0 : start;
+        end = end > pool->days ? pool->days : end;
+        if (m >= 0 && start < end) {
+            int32_t *out = pool->counters + (size_t)m * (pool->days + 1);
+            out[start]++;
+            out[end]--;
+            counted++;
+        }
+    }
+    return counted;
+}
+
+static int compareByDemand(const void *a, const void *b) {
+    double x = ((const struct ModelForecast *)a)->average, y = ((const struct ModelForecast *)b)->average;
+    return (x < y) - (x > y);
+}
+
+/**
+ * @brief Reads the rental history into per-model daily counters, computes
+ * each model's demand on a thread pool and prints the busiest models with
+ * the number of cars that would have covered 95% of days.
+ */
+void displayUtilisationForecast() {
+    int days, thread_count;
+    printf("Enter days of history to analyse (e.g. 1826 for five years): ");
+    scanf("%d", &days);
+    while (getchar() != '\n');
+    printf("Enter number of worker threads (1-%d): ", MAX_FORECAST_THREADS);
+    scanf("%d", &thread_count);
+    while (getchar() != '\n');
+    if (days < 1 || days > (LEDGER_LAST_YEAR - LEDGER_FIRST_YEAR + 1) * 366 || thread_count < 1 ||
+        thread_count > MAX_FORECAST_THREADS) {
+        printf("Error: Invalid forecast parameters.\n");
+        return;
+    }
+    if (model_count == 0) {
+        printf("The fleet is empty.\n");
+        return;
+    }
+
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    int end_day = today(), first_day = end_day - days;
+    struct ForecastPool pool = {NULL, days, NULL, 0, 0};
+    pool.counters = calloc((size_t)model_count * (days + 1), sizeof(int32_t));
+    pool.results = malloc(model_count * sizeof(struct ModelForecast));
+    int *car_model = malloc((car_count + 1) * sizeof(int));
+    int *indexes = malloc(LEDGER_BLOCK_ROWS * sizeof(int));
+    struct LedgerColumns block = {0};
+    if (!pool.counters || !pool.results || !car_model || !indexes || !allocLedgerColumns(&block)) {
+        printf("Error: Out of memory; try fewer days.\n");
+        goto done;
+    }
+    for (int i = 0; i < car_count; i++) {
+        car_model[i] = -1;
+    }
+    for (int m = 0; m < model_count; m++) {
+        for (int i = 0; i < models[m].car_count; i++) {
+            car_model[models[m].cars[i]] = m;
+        }
+    }
+
+    long rentals = 0;
+    FILE *fp = fopen(LEDGER_FILENAME, "rb");
+    if (fp != NULL) {
+        while (readLedgerBlock(fp, &block, 0)) {
+            rentals += countLedgerBlock(&block, &pool, first_day, car_model, indexes);
+        }
+        fclose(fp);
+    }
+    if (ledger_tail.rows > 0) {
+        rentals += countLedgerBlock(&ledger_tail, &pool, first_day, car_model, indexes);
+    }
+    // Cars that are out now have been out every day since they were picked up
+    for (int i = 0; i < car_count; i++) {
+        if (fleet[i].is_available || active_rental[i] == -1) {
+            continue;
+        }
+        int start = reservations[active_rental[i]].start_day - first_day;
+        if (car_model[i] >= 0 && start < days) {
+            int32_t *out = pool.counters + (size_t)car_model[i] * (days + 1);
+            out[start < 0 ? 0 : start]++;
+            out[days]--;
+            rentals++;
+        }
+    }
+
+    pthread_t threads[MAX_FORECAST_THREADS];
+    int started = 0;
+    while (started < thread_count && pthread_create(&threads[started], NULL, forecastWorker, &pool) == 0) {
+        started++;
+    }
+    if (started == 0) {
+        forecastWorker(&pool);
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (atomic_load(&pool.failed)) {
+        printf("Error: Out of memory.\n");
+        goto done;
+    }
+
+    qsort(pool.results, model_count, sizeof(struct ModelForecast), compareByDemand);
+    printf("\n--- Utilisation Forecast: %d to %d (%d day(s)) ---\n", dateFromDays(first_day),
+           dateFromDays(end_day - 1), days);
+    printf("%ld rental(s) over %d model(s), analysed in %.3f seconds with %d thread(s).\n", rentals, model_count,
+           (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9, started ? started : 1);
+    printf("Cars out per day: average, percentiles, busiest 7 days, last and next %d days.\n\n", FORECAST_HORIZON);
+    printf("%-25s %-5s %-8s %-6s %-5s %-5s %-5s %-5s %-8s %-8s %-8s %-s\n", "Model", "Cars", "Average", "Use", "P50",
+           "P90", "P99", "Peak", "Week", "Last", "Next", "Needed");
+    printf("--------------------------------------------------------------------------------------------------------\n");
+    int total_cars = 0, total_needed = 0;
+    for (int r = 0; r < model_count; r++) {
+        const struct ModelForecast *f = &pool.results[r];
+        const struct ModelEntry *e = &models[f->model];
+        // Enough cars for 95% of past days and for the forecast average
+        int needed = f->p95 > (int)(f->next_month + 0.999) ? f->p95 : (int)(f->next_month + 0.999);
+        total_cars += e->car_count;
+        total_needed += needed;
+        if (r < FORECAST_ROWS) {
+            printf("%-25.25s %-5d %-8.2f %5.1f%% %-5d %-5d %-5d %-5d %-8.2f %-8.2f %-8.2f %d (%+d)\n", e->name,
+                   e->car_count, f->average, e->car_count ? 100 * f->average / e->car_count : 0.0, f->p50, f->p90,
+                   f->p99, f->peak, f->busiest_week, f->last_month, f->next_month, needed, needed - e->car_count);
+        }
+    }
+    if (model_count > FORECAST_ROWS) {
+        printf("... and %d more model(s)\n", model_count - FORECAST_ROWS);
+    }
+    printf("--------------------------------------------------------------------------------------------------------\n");
+    printf("Whole fleet: %d car(s), %d needed (%+d).\n", total_cars, total_needed, total_needed - total_cars);
+
+done:
+    free(pool.counters);
+    free(pool.results);
+    free(car_model);
+    free(indexes);
+    freeLedgerColumns(&block);
+}
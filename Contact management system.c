@@ -1,282 +1,1972 @@
-/*
- * -----------------------------------------------------------------------------
- *
- * Project: 8 - Contact Management System
- *
- * -----------------------------------------------------------------------------
- *
- * Question:
- * Write a C program to create a command-line contact management system.
- * The program should allow the user to store and manage their contacts.
- *
- * The system must support the following core operations:
- * 1.  Add a new contact, storing their name, phone number, and email address.
- * 2.  Display a list of all saved contacts.
- * 3.  Search for a contact by name and display their details.
- * 4.  Update the information (phone, email) of an existing contact.
- * 5.  Delete a contact from the system.
- * 6.  Ensure all contact data is saved to a file ("contacts.dat") upon exiting
- * and loaded from the file upon starting the program.
- *
- * Concepts Covered:
- * - Reinforcement of CRUD (Create, Read, Update, Delete) operations.
- * - String manipulation for searching and updating.
- * - Data persistence with file I/O.
- * - Structuring a complete, menu-driven application.
- *
- * -----------------------------------------------------------------------------
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <ctype.h>
-
-// --- Constants ---
-#define MAX_CONTACTS 100
-#define FILENAME "contacts.dat"
-
-// --- Data Structures ---
-struct Contact {
-    char name[100];
-    char phone[20];
-    char email[100];
-};
-
-// --- Global Data ---
-struct Contact contacts[MAX_CONTACTS];
-int contact_count = 0;
-
-// --- Function Prototypes ---
-void addContact();
-void displayAllContacts();
-void searchContact();
-void updateContact();
-void deleteContact();
-int findContactByName(const char* name);
-void saveData();
-void loadData();
-
-int main() {
-    loadData();
-    int choice;
-
-    while (1) {
-        printf("\n\n--- Contact Management System ---\n");
-        printf("1. Add New Contact\n");
-        printf("2. Display All Contacts\n");
-        printf("3. Search for a Contact\n");
-        printf("4. Update a Contact\n");
-        printf("5. Delete a Contact\n");
-        printf("6. Save and Exit\n");
-        printf("Enter your choice: ");
-        scanf("%d", &choice);
-        while (getchar() != '\n'); // Clear input buffer
-
-        switch (choice) {
-            case 1: addContact(); break;
-            case 2: displayAllContacts(); break;
-            case 3: searchContact(); break;
-            case 4: updateContact(); break;
-            case 5: deleteContact(); break;
-            case 6:
-                saveData();
-                printf("Contact data saved. Exiting...\n");
-                exit(0);
-            default:
-                printf("Invalid choice. Please try again.\n");
-        }
-    }
-
-    return 0;
-}
-
-/**
- * @brief Adds a new contact to the address book.
- */
-void addContact() {
-    if (contact_count >= MAX_CONTACTS) {
-        printf("Contact book is full.\n");
-        return;
-    }
-
-    struct Contact *c = &contacts[contact_count];
-    printf("\n--- Add New Contact ---\n");
-
-    printf("Enter Name: ");
-    fgets(c->name, sizeof(c->name), stdin);
-    c->name[strcspn(c->name, "\n")] = 0;
-
-    // Check for duplicate name
-    if (findContactByName(c->name) != -1) {
-        printf("Error: A contact with this name already exists.\n");
-        return;
-    }
-
-    printf("Enter Phone Number: ");
-    fgets(c->phone, sizeof(c->phone), stdin);
-    c->phone[strcspn(c->phone, "\n")] = 0;
-
-    printf("Enter Email Address: ");
-    fgets(c->email, sizeof(c->email), stdin);
-    c->email[strcspn(c->email, "\n")] = 0;
-
-    contact_count++;
-    printf("Contact added successfully!\n");
-}
-
-/**
- * @brief Displays all saved contacts.
- */
-void displayAllContacts() {
-    if (contact_count == 0) {
-        printf("\nYour contact book is empty.\n");
-        return;
-    }
-    printf("\n--- All Contacts ---\n");
-    printf("%-30s %-20s %-30s\n", "Name", "Phone Number", "Email Address");
-    printf("--------------------------------------------------------------------------\n");
-    for (int i = 0; i < contact_count; i++) {
-        printf("%-30s %-20s %-30s\n", contacts[i].name, contacts[i].phone, contacts[i].email);
-    }
-    printf("--------------------------------------------------------------------------\n");
-}
-
-/**
- * @brief Searches for a contact by name and displays their details.
- */
-void searchContact() {
-    if (contact_count == 0) {
-        printf("\nNo contacts to search.\n");
-        return;
-    }
-    char name_to_find[100];
-    printf("Enter the name to search for: ");
-    fgets(name_to_find, sizeof(name_to_find), stdin);
-    name_to_find[strcspn(name_to_find, "\n")] = 0;
-
-    int index = findContactByName(name_to_find);
-
-    if (index != -1) {
-        struct Contact c = contacts[index];
-        printf("\n--- Contact Found ---\n");
-        printf("Name:  %s\n", c.name);
-        printf("Phone: %s\n", c.phone);
-        printf("Email: %s\n", c.email);
-    } else {
-        printf("No contact found with the name '%s'.\n", name_to_find);
-    }
-}
-
-/**
- * @brief Updates an existing contact's information.
- */
-void updateContact() {
-    if (contact_count == 0) {
-        printf("\nNo contacts to update.\n");
-        return;
-    }
-    char name_to_update[100];
-    printf("Enter the name of the contact to update: ");
-    fgets(name_to_update, sizeof(name_to_update), stdin);
-    name_to_update[strcspn(name_to_update, "\n")] = 0;
-
-    int index = findContactByName(name_to_update);
-
-    if (index != -1) {
-        struct Contact *c = &contacts[index];
-        printf("--- Updating Contact: %s ---\n", c->name);
-
-        printf("Enter new Phone Number (or press Enter to keep '%s'): ", c->phone);
-        char newPhone[20];
-        fgets(newPhone, sizeof(newPhone), stdin);
-        if (strcmp(newPhone, "\n") != 0) {
-            newPhone[strcspn(newPhone, "\n")] = 0;
-            strcpy(c->phone, newPhone);
-        }
-
-        printf("Enter new Email Address (or press Enter to keep '%s'): ", c->email);
-        char newEmail[100];
-        fgets(newEmail, sizeof(newEmail), stdin);
-        if (strcmp(newEmail, "\n") != 0) {
-            newEmail[strcspn(newEmail, "\n")] = 0;
-            strcpy(c->email, newEmail);
-        }
-
-        printf("Contact updated successfully!\n");
-    } else {
-        printf("No contact found with the name '%s'.\n", name_to_update);
-    }
-}
-
-/**
- * @brief Deletes a contact from the system.
- */
-void deleteContact() {
-    if (contact_count == 0) {
-        printf("\nNo contacts to delete.\n");
-        return;
-    }
-    char name_to_delete[100];
-    printf("Enter the name of the contact to delete: ");
-    fgets(name_to_delete, sizeof(name_to_delete), stdin);
-    name_to_delete[strcspn(name_to_delete, "\n")] = 0;
-
-    int index = findContactByName(name_to_delete);
-
-    if (index != -1) {
-        // Shift all subsequent elements one position to the left
-        for (int i = index; i < contact_count - 1; i++) {
-            contacts[i] = contacts[i + 1];
-        }
-        contact_count--; // Decrement the total count
-        printf("Contact '%s' deleted successfully.\n", name_to_delete);
-    } else {
-        printf("No contact found with the name '%s'.\n", name_to_delete);
-    }
-}
-
-/**
- * @brief Finds a contact by name (case-insensitive).
- * @param name The name to search for.
- * @return The index of the contact in the array, or -1 if not found.
- */
-int findContactByName(const char* name) {
-    for (int i = 0; i < contact_count; i++) {
-        // strcasecmp is a non-standard, case-insensitive version of strcmp
-        // For portability, we can convert both strings to lower/upper case first
-        // But for simplicity here, we'll use a direct comparison.
-        if (strcasecmp(contacts[i].name, name) == 0) {
-            return i;
-        }
-    }
-    return -1; // Not found
-}
-
-/**
- * @brief Saves the current contact list to a binary file.
- */
-void saveData() {
-    FILE *fp = fopen(FILENAME, "wb");
-    if (fp == NULL) {
-        printf("Error: Could not open file for writing.\n");
-        return;
-    }
-    fwrite(contacts, sizeof(struct Contact), contact_count, fp);
-    fclose(fp);
-}
-
-/**
- * @brief Loads the contact list from a binary file.
- */
-void loadData() {
-    FILE *fp = fopen(FILENAME, "rb");
-    if (fp == NULL) {
-        return; // File doesn't exist on first run, which is normal.
-    }
-    contact_count = fread(contacts, sizeof(struct Contact), MAX_CONTACTS, fp);
-    fclose(fp);
-    if (contact_count > 0) {
-        printf("Loaded %d contact(s) from file.\n", contact_count);
-    }
-}
+/*
+ * -----------------------------------------------------------------------------
+ *
+ * Project: 8 - Contact Management System
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Question:
+ * Write a C program to create a command-line contact management system.
+ * The program should allow the user to store and manage their contacts.
+ *
+ * The system must support the following core operations:
+ * 1.  Add a new contact, storing their name, phone number, and email address.
+ * 2.  Display a list of all saved contacts.
+ * 3.  Search for a contact by name and display their details.
+ * 4.  Update the information (name, phone, email) of an existing contact.
+ * 5.  Delete a contact from the system.
+ * 6.  Autocomplete: list the first contacts, in alphabetical order, whose
+ * name starts with what the user has typed so far.
+ * 7.  Fuzzy search: list the contacts whose name is closest to a possibly
+ * misspelled one ("Jonh Smith"), by the number of letters to insert,
+ * delete or change to get from one to the other (the edit distance).
+ * 8.  Caller ID: find who is calling from a phone number, however it is
+ * written ("+1 (555) 010-4477", "1-555-010-4477"). A number with no
+ * contact of its own is matched to the longest switchboard number that
+ * starts it, stored as the company's shared leading digits
+ * ("+44 20 7946 0xxx").
+ * 9.  Import contacts in bulk from a CSV file or a vCard (.vcf, version 3.0
+ * or 4.0) file. A contact already in the book, by name, or else by phone
+ * number or e-mail address, is merged with the imported one rather than
+ * added twice, and fields that disagree are reported as conflicts.
+ * 10. Ensure all contact data is saved to a file ("contacts.dat") upon exiting
+ * and loaded from the file upon starting the program.
+ *
+ * The address book has no fixed size: it grows as contacts are added, and a
+ * hash index finds any contact by name, in any mix of upper and lower case,
+ * in constant time. Every contact keeps its slot in the array when others
+ * are deleted: a deleted one only leaves a mark (a tombstone) behind, and
+ * the marked slots are squeezed out in one pass once they make up a
+ * quarter of the array. That pass moves the live contacts down, so a slot
+ * number only holds until the next compaction; the indexes are renumbered
+ * with it, and nothing else keeps a slot number across a delete.
+ *
+ * Concepts Covered:
+ * - Reinforcement of CRUD (Create, Read, Update, Delete) operations.
+ * - String manipulation for searching and updating.
+ * - Data persistence with file I/O.
+ * - Structuring a complete, menu-driven application.
+ * - Growable arrays and an open-addressing hash index (linear probing, with
+ * backward-shift deletion) on case-folded names.
+ * - Keeping an array sorted on insert and delete, and binary search for the
+ * range of names sharing a prefix.
+ * - Bit-parallel edit distance (Myers' algorithm): one 64-bit word holds a
+ * whole column of the edit-distance table.
+ * - Cheap filters first: names of the wrong length, or sharing too few
+ * letter pairs (q-grams) with the query, are skipped without computing a
+ * distance.
+ * - Splitting a scan over several threads (POSIX threads).
+ * - Tombstone deletion with periodic compaction, so a delete costs O(1)
+ * on average instead of moving every later record.
+ * - Normalising free-text phone numbers to international digits, packed in
+ * one 64-bit key; longest-prefix matching by probing the hash index with
+ * ever shorter prefixes of the number.
+ * - Streaming a large file in blocks, cutting each block at record
+ * boundaries and parsing the pieces on several threads, then merging the
+ * results in file order through hash indexes.
+ *
+ * Note on Compilation:
+ * - Needs POSIX threads: gcc -std=c11 ... -pthread
+ * - Uses the GCC/Clang builtin __builtin_popcountll.
+ *
+ * -----------------------------------------------------------------------------
+ */
+
+#define _POSIX_C_SOURCE 200809L // For sysconf(), clock_gettime()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// --- Constants ---
+#define INITIAL_CAPACITY 64
+#define FILENAME "contacts.dat"
+#define SUGGESTIONS 10 // Names listed by autocomplete
+#define FUZZY_RESULTS 10
+#define FUZZY_MAX_QUERY 64 // Myers' algorithm here keeps a column in one 64-bit word
+#define MAX_FUZZY_THREADS 16
+#define FUZZY_NAMES_PER_THREAD 65536 // Smaller books are searched on one thread
+#define COMPACT_MIN_DELETED 1024 // Compact once this many slots are deleted...
+#define COMPACT_DELETED_PERCENT 25 // ... and they are at least this share of all slots
+// Dialling plan used to normalise phone numbers, here North America's
+// (the UK's would be "44", "0" and "00")
+#define COUNTRY_CODE "1" // Assumed for numbers written without one
+#define TRUNK_PREFIX "1" // Dialled before national numbers; dropped
+#define INTERNATIONAL_PREFIX "011" // Dialled before a country code, like '+'
+#define MAX_PHONE_DIGITS 15 // Longest international number (E.164)
+#define MIN_PREFIX_DIGITS 5 // Shortest switchboard prefix a number may match
+#define CALLER_MATCHES 10
+#define IMPORT_BLOCK_SIZE (16 << 20) // Bytes read, then parsed, at a time
+#define IMPORT_BYTES_PER_THREAD (1 << 20) // Smaller blocks are parsed on one thread
+#define MAX_IMPORT_THREADS 16
+#define IMPORT_MAX_COLUMNS 64 // CSV columns looked at
+#define IMPORT_CONFLICTS_SHOWN 10
+
+// --- Data Structures ---
+struct Contact {
+    char name[100];
+    char phone[20];
+    char email[100];
+};
+
+// One slot of the name index. The hash is kept so probes and rehashing
+// rarely have to touch the contacts themselves.
+struct ContactIndexSlot {
+    uint32_t hash;
+    int index; // -1 for an empty slot
+};
+
+// A contact's place in name order while sorting: the first 16 characters
+// of the name, lower case and big-endian, decide most comparisons on their
+// own, without reading the contact
+struct NameKey {
+    uint64_t key[2];
+    int index;
+};
+
+// What the fuzzy search filters need to know about a name without reading
+// it: its length and which letter pairs it contains, hashed into 64 bits
+struct NameSignature {
+    uint64_t pairs;
+    int length;
+};
+
+// One slot of the phone index: the normalised number packed as
+// digits * 16 + digit count, so "0044" and "44" stay apart
+struct PhoneIndexSlot {
+    uint64_t key;
+    int index; // -1 for an empty slot
+};
+
+// --- Global Data ---
+struct Contact *contacts = NULL;
+int contact_count = 0; // Slots in use, deleted ones included
+int contact_capacity = 0;
+unsigned char *deleted = NULL; // Parallel to contacts: 1 for a tombstone
+int deleted_count = 0;
+struct ContactIndexSlot *contact_index = NULL; // Never more than half full
+int contact_index_capacity = 0;
+int *name_order = NULL; // Contact indexes sorted by name, ignoring case; may include deleted ones
+struct NameSignature *signatures = NULL; // Parallel to contacts
+struct PhoneIndexSlot *phone_index = NULL; // Same size as contact_index; numbers may repeat
+int phone_index_capacity = 0;
+
+// --- Function Prototypes ---
+void addContact();
+void displayAllContacts();
+void searchContact();
+void updateContact();
+void deleteContact();
+void autocompleteContacts();
+void fuzzySearchContacts();
+void callerIdLookup();
+void importContactsFromFile();
+int findContactByName(const char* name);
+int reserveContacts(int capacity);
+void indexContact(int index);
+void unindexContact(int index);
+void insertNameOrder(int index);
+void removeNameOrder(int index);
+int findPrefixRange(const char *prefix, int *first, int *end, int limit);
+int sortNameOrder();
+void orderNewNames(int first);
+void signContact(int index);
+int normalizePhone(const char *text, char *digits);
+int resizePhoneIndex(int capacity);
+void indexPhone(int index);
+void unindexPhone(int index);
+int lookupCaller(const char *number, char *digits, int *results, int max, int *matched);
+int importContacts(const char *filename);
+void removeContact(int index);
+void compactContacts();
+void saveData();
+void loadData();
+
+int main() {
+    loadData();
+    int choice;
+
+    while (1) {
+        printf("\n\n--- Contact Management System ---\n");
+        printf("1. Add New Contact\n");
+        printf("2. Display All Contacts\n");
+        printf("3. Search for a Contact\n");
+        printf("4. Update a Contact\n");
+        printf("5. Delete a Contact\n");
+        printf("6. Autocomplete a Name\n");
+        printf("7. Fuzzy Search by Name\n");
+        printf("8. Caller ID Lookup\n");
+        printf("9. Import Contacts (CSV/vCard)\n");
+        printf("10. Save and Exit\n");
+        printf("Enter your choice: ");
+        scanf("%d", &choice);
+        while (getchar() != '\n'); // Clear input buffer
+
+        switch (choice) {
+            case 1: addContact(); break;
+            case 2: displayAllContacts(); break;
+            case 3: searchContact(); break;
+            case 4: updateContact(); break;
+            case 5: deleteContact(); break;
+            case 6: autocompleteContacts(); break;
+            case 7: fuzzySearchContacts(); break;
+            case 8: callerIdLookup(); break;
+            case 9: importContactsFromFile(); break;
+            case 10:
+                saveData();
+                printf("Contact data saved. Exiting...\n");
+                exit(0);
+            default:
+                printf("Invalid choice. Please try again.\n");
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Adds a new contact to the address book.
+ */
+void addContact() {
+    if (contact_count == contact_capacity && !reserveContacts(contact_capacity * 2)) {
+        printf("Error: Out of memory; the contact cannot be added.\n");
+        return;
+    }
+
+    struct Contact *c = &contacts[contact_count];
+    printf("\n--- Add New Contact ---\n");
+
+    printf("Enter Name: ");
+    fgets(c->name, sizeof(c->name), stdin);
+    c->name[strcspn(c->name, "\n")] = 0;
+
+    // Check for duplicate name
+    if (findContactByName(c->name) != -1) {
+        printf("Error: A contact with this name already exists.\n");
+        return;
+    }
+
+    printf("Enter Phone Number: ");
+    fgets(c->phone, sizeof(c->phone), stdin);
+    c->phone[strcspn(c->phone, "\n")] = 0;
+
+    printf("Enter Email Address: ");
+    fgets(c->email, sizeof(c->email), stdin);
+    c->email[strcspn(c->email, "\n")] = 0;
+
+    indexContact(contact_count);
+    insertNameOrder(contact_count);
+    signContact(contact_count);
+    indexPhone(contact_count);
+    contact_count++;
+    printf("Contact added successfully!\n");
+}
+
+/**
+ * @brief Displays all saved contacts.
+ */
+void displayAllContacts() {
+    if (contact_count == deleted_count) {
+        printf("\nYour contact book is empty.\n");
+        return;
+    }
+    printf("\n--- All Contacts ---\n");
+    printf("%-30s %-20s %-30s\n", "Name", "Phone Number", "Email Address");
+    printf("--------------------------------------------------------------------------\n");
+    for (int i = 0; i < contact_count; i++) {
+        if (!deleted[i]) {
+            printf("%-30s %-20s %-30s\n", contacts[i].name, contacts[i].phone, contacts[i].email);
+        }
+    }
+    printf("--------------------------------------------------------------------------\n");
+}
+
+/**
+ * @brief Searches for a contact by name and displays their details.
+ */
+void searchContact() {
+    if (contact_count == deleted_count) {
+        printf("\nNo contacts to search.\n");
+        return;
+    }
+    char name_to_find[100];
+    printf("Enter the name to search for: ");
+    fgets(name_to_find, sizeof(name_to_find), stdin);
+    name_to_find[strcspn(name_to_find, "\n")] = 0;
+
+    int index = findContactByName(name_to_find);
+
+    if (index != -1) {
+        struct Contact c = contacts[index];
+        printf("\n--- Contact Found ---\n");
+        printf("Name:  %s\n", c.name);
+        printf("Phone: %s\n", c.phone);
+        printf("Email: %s\n", c.email);
+    } else {
+        printf("No contact found with the name '%s'.\n", name_to_find);
+    }
+}
+
+/**
+ * @brief Updates an existing contact's information.
+ */
+void updateContact() {
+    if (contact_count == deleted_count) {
+        printf("\nNo contacts to update.\n");
+        return;
+    }
+    char name_to_update[100];
+    printf("Enter the name of the contact to update: ");
+    fgets(name_to_update, sizeof(name_to_update), stdin);
+    name_to_update[strcspn(name_to_update, "\n")] = 0;
+
+    int index = findContactByName(name_to_update);
+
+    if (index != -1) {
+        struct Contact *c = &contacts[index];
+        printf("--- Updating Contact: %s ---\n", c->name);
+
+        printf("Enter new Name (or press Enter to keep '%s'): ", c->name);
+        char newName[100];
+        fgets(newName, sizeof(newName), stdin);
+        if (strcmp(newName, "\n") != 0) {
+            newName[strcspn(newName, "\n")] = 0;
+            int other = findContactByName(newName);
+            if (other != -1 && other != index) {
+                printf("Error: A contact with this name already exists.\n");
+                return;
+            }
+            // The name is the key of both indexes: take the contact out, rename, put it back
+            unindexContact(index);
+            removeNameOrder(index);
+            strcpy(c->name, newName);
+            indexContact(index);
+            insertNameOrder(index);
+            signContact(index);
+        }
+
+        printf("Enter new Phone Number (or press Enter to keep '%s'): ", c->phone);
+        char newPhone[20];
+        fgets(newPhone, sizeof(newPhone), stdin);
+        if (strcmp(newPhone, "\n") != 0) {
+            newPhone[strcspn(newPhone, "\n")] = 0;
+            unindexPhone(index);
+            strcpy(c->phone, newPhone);
+            indexPhone(index);
+        }
+
+        printf("Enter new Email Address (or press Enter to keep '%s'): ", c->email);
+        char newEmail[100];
+        fgets(newEmail, sizeof(newEmail), stdin);
+        if (strcmp(newEmail, "\n") != 0) {
+            newEmail[strcspn(newEmail, "\n")] = 0;
+            strcpy(c->email, newEmail);
+        }
+
+        printf("Contact updated successfully!\n");
+    } else {
+        printf("No contact found with the name '%s'.\n", name_to_update);
+    }
+}
+
+/**
+ * @brief Deletes a contact from the system.
+ */
+void deleteContact() {
+    if (contact_count == deleted_count) {
+        printf("\nNo contacts to delete.\n");
+        return;
+    }
+    char name_to_delete[100];
+    printf("Enter the name of the contact to delete: ");
+    fgets(name_to_delete, sizeof(name_to_delete), stdin);
+    name_to_delete[strcspn(name_to_delete, "\n")] = 0;
+
+    int index = findContactByName(name_to_delete);
+
+    if (index != -1) {
+        removeContact(index);
+        printf("Contact '%s' deleted successfully.\n", name_to_delete);
+    } else {
+        printf("No contact found with the name '%s'.\n", name_to_delete);
+    }
+}
+
+// --- Contact Store ---
+
+// FNV-1a over the lower-case name, so names differing only in case collide
+static uint32_t hashName(const char *name) {
+    uint32_t h = 2166136261u;
+    for (; *name; name++) {
+        h = (h ^ (unsigned char)tolower((unsigned char)*name)) * 16777619u;
+    }
+    return h;
+}
+
+// Case-insensitive equality of two names
+static int sameName(const char *a, const char *b) {
+    while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        a++, b++;
+    }
+    return tolower((unsigned char)*a) == tolower((unsigned char)*b);
+}
+
+/**
+ * @brief Finds a contact by name (case-insensitive).
+ * @param name The name to search for.
+ * @return The index of the contact in the array, or -1 if not found.
+ */
+int findContactByName(const char* name) {
+    if (contact_index_capacity == 0) {
+        return -1;
+    }
+    uint32_t hash = hashName(name);
+    unsigned int mask = contact_index_capacity - 1;
+    for (unsigned int slot = hash & mask; contact_index[slot].index != -1; slot = (slot + 1) & mask) {
+        if (contact_index[slot].hash == hash && sameName(contacts[contact_index[slot].index].name, name)) {
+            return contact_index[slot].index;
+        }
+    }
+    return -1; // Not found
+}
+
+/**
+ * @brief Adds contacts[index] to the name index. The caller has checked
+ * that the name is new and that reserveContacts() made room for it.
+ */
+void indexContact(int index) {
+    uint32_t hash = hashName(contacts[index].name);
+    unsigned int mask = contact_index_capacity - 1;
+    unsigned int slot = hash & mask;
+    while (contact_index[slot].index != -1) {
+        slot = (slot + 1) & mask;
+    }
+    contact_index[slot] = (struct ContactIndexSlot){hash, index};
+}
+
+/**
+ * @brief Removes contacts[index] from the name index. Later entries of the
+ * same run of slots move back into the gap, so no lookup stops early at it.
+ */
+void unindexContact(int index) {
+    unsigned int mask = contact_index_capacity - 1;
+    unsigned int hole = hashName(contacts[index].name) & mask;
+    while (contact_index[hole].index != index) {
+        hole = (hole + 1) & mask;
+    }
+    for (unsigned int next = (hole + 1) & mask; contact_index[next].index != -1; next = (next + 1) & mask) {
+        // An entry may fill the hole only if the hole is between its home slot and where it is now
+        unsigned int home = contact_index[next].hash & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            contact_index[hole] = contact_index[next];
+            hole = next;
+        }
+    }
+    contact_index[hole].index = -1;
+}
+
+/**
+ * @brief Grows the contact array to hold 'capacity' contacts, and the name
+ * and phone indexes to at least twice that. Existing contacts keep their index.
+ * @return 1 on success, 0 if out of memory (nothing is lost).
+ */
+int reserveContacts(int capacity) {
+    if (capacity < INITIAL_CAPACITY) {
+        capacity = INITIAL_CAPACITY;
+    }
+    if (capacity <= contact_capacity) {
+        return 1;
+    }
+    if (capacity > INT_MAX / 4) {
+        return 0;
+    }
+    struct Contact *grown = realloc(contacts, (size_t)capacity * sizeof(struct Contact));
+    if (grown == NULL) {
+        return 0;
+    }
+    contacts = grown;
+    int *order = realloc(name_order, (size_t)capacity * sizeof(int));
+    if (order == NULL) {
+        return 0;
+    }
+    name_order = order;
+    struct NameSignature *signed_names = realloc(signatures, (size_t)capacity * sizeof(struct NameSignature));
+    if (signed_names == NULL) {
+        return 0;
+    }
+    signatures = signed_names;
+    unsigned char *marks = realloc(deleted, capacity);
+    if (marks == NULL) {
+        return 0;
+    }
+    deleted = marks;
+    memset(deleted + contact_capacity, 0, capacity - contact_capacity);
+
+    int index_capacity = contact_index_capacity ? contact_index_capacity : 16;
+    while (index_capacity < 2 * capacity) {
+        index_capacity *= 2;
+    }
+    if (index_capacity != contact_index_capacity) {
+        struct ContactIndexSlot *slots = malloc((size_t)index_capacity * sizeof(struct ContactIndexSlot));
+        if (slots == NULL) {
+            return 0;
+        }
+        // Move the entries by their stored hash; the names are not read again
+        for (int i = 0; i < index_capacity; i++) {
+            slots[i].index = -1;
+        }
+        unsigned int mask = index_capacity - 1;
+        for (int i = 0; i < contact_index_capacity; i++) {
+            if (contact_index[i].index != -1) {
+                unsigned int slot = contact_index[i].hash & mask;
+                while (slots[slot].index != -1) {
+                    slot = (slot + 1) & mask;
+                }
+                slots[slot] = contact_index[i];
+            }
+        }
+        free(contact_index);
+        contact_index = slots;
+        contact_index_capacity = index_capacity;
+    }
+    if (index_capacity != phone_index_capacity && !resizePhoneIndex(index_capacity)) {
+        return 0;
+    }
+    contact_capacity = capacity;
+    return 1;
+}
+
+/**
+ * @brief Deletes contacts[index]. Nothing moves: the slot is only marked
+ * deleted, and stays in name order until the next compaction.
+ */
+void removeContact(int index) {
+    unindexContact(index);
+    unindexPhone(index);
+    deleted[index] = 1;
+    deleted_count++;
+    if (deleted_count >= COMPACT_MIN_DELETED && deleted_count * 100L >= contact_count * (long)COMPACT_DELETED_PERCENT) {
+        compactContacts();
+    }
+}
+
+/**
+ * @brief Squeezes the deleted slots out of the array, keeping the others in
+ * order, and renumbers the indexes through an old-to-new slot table. Live
+ * contacts get new slot numbers here, so callers must not hold one across
+ * a delete. The O(n) cost is spread over the many deletes that made it
+ * necessary.
+ */
+void compactContacts() {
+    int *new_slot = malloc(((size_t)contact_count + 1) * sizeof(int));
+    if (new_slot == NULL) {
+        return; // Tombstones are harmless; try again after the next delete
+    }
+    int live = 0;
+    for (int i = 0; i < contact_count; i++) {
+        if (deleted[i]) {
+            new_slot[i] = -1;
+            continue;
+        }
+        new_slot[i] = live;
+        if (live != i) {
+            contacts[live] = contacts[i];
+            signatures[live] = signatures[i];
+        }
+        live++;
+    }
+    for (int slot = 0; slot < contact_index_capacity; slot++) {
+        if (contact_index[slot].index != -1) {
+            contact_index[slot].index = new_slot[contact_index[slot].index];
+        }
+    }
+    for (int slot = 0; slot < phone_index_capacity; slot++) {
+        if (phone_index[slot].index != -1) {
+            phone_index[slot].index = new_slot[phone_index[slot].index];
+        }
+    }
+    int kept = 0;
+    for (int i = 0; i < contact_count; i++) {
+        if (new_slot[name_order[i]] != -1) {
+            name_order[kept++] = new_slot[name_order[i]];
+        }
+    }
+    memset(deleted, 0, contact_count);
+    contact_count = live;
+    deleted_count = 0;
+    free(new_slot);
+}
+
+// --- Name Autocomplete ---
+
+// Compares two names like strcmp(), ignoring case
+static int compareNames(const char *a, const char *b) {
+    while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        a++, b++;
+    }
+    return tolower((unsigned char)*a) - tolower((unsigned char)*b);
+}
+
+static int compareNameKeys(const void *a, const void *b) {
+    const struct NameKey *x = a, *y = b;
+    for (int k = 0; k < 2; k++) {
+        if (x->key[k] != y->key[k]) {
+            return x->key[k] < y->key[k] ? -1 : 1;
+        }
+    }
+    return compareNames(contacts[x->index].name, contacts[y->index].name);
+}
+
+// Like compareNames(), but a name that starts with the prefix counts as equal
+static int comparePrefix(const char *name, const char *prefix) {
+    while (*prefix && tolower((unsigned char)*name) == tolower((unsigned char)*prefix)) {
+        name++, prefix++;
+    }
+    return *prefix == 0 ? 0 : tolower((unsigned char)*name) - tolower((unsigned char)*prefix);
+}
+
+/**
+ * @brief Binary search of the first 'count' entries of name_order for the
+ * first name not before 'name'. With 'prefix' set, names starting with
+ * 'name' count as equal to it, and with 'after' set too, the search skips
+ * past them.
+ */
+static int searchNameOrder(const char *name, int count, int prefix, int after) {
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        const char *other = contacts[name_order[mid]].name;
+        int cmp = prefix ? comparePrefix(other, name) : compareNames(other, name);
+        if (cmp < 0 || (after && cmp == 0)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Puts contacts[index] into name order. The caller has checked that
+ * the name is new and that reserveContacts() made room for it.
+ */
+void insertNameOrder(int index) {
+    int count = index < contact_count ? contact_count - 1 : contact_count; // Renames are already counted
+    int pos = searchNameOrder(contacts[index].name, count, 0, 0);
+    memmove(&name_order[pos + 1], &name_order[pos], (count - pos) * sizeof(int));
+    name_order[pos] = index;
+}
+
+/**
+ * @brief Takes contacts[index] out of name order.
+ */
+void removeNameOrder(int index) {
+    int pos = searchNameOrder(contacts[index].name, contact_count, 0, 0);
+    while (name_order[pos] != index) {
+        pos++; // Past deleted contacts of the same name
+    }
+    memmove(&name_order[pos], &name_order[pos + 1], (contact_count - pos - 1) * sizeof(int));
+}
+
+// Fills in the sort key of contacts[index] (see struct NameKey)
+static void fillNameKey(struct NameKey *key, int index) {
+    const char *name = contacts[index].name;
+    key->index = index;
+    for (int k = 0; k < 2; k++) {
+        uint64_t bytes = 0;
+        for (int c = 0; c < 8; c++) {
+            bytes = bytes << 8 | (unsigned char)tolower((unsigned char)*name);
+            name += *name != 0; // Shorter names are padded with zeros, so they sort first
+        }
+        key->key[k] = bytes;
+    }
+}
+
+/**
+ * @brief Rebuilds name_order from scratch by sorting every contact, which
+ * is much faster than inserting them one by one.
+ * @return 1 on success, 0 if out of memory (name_order is unchanged).
+ */
+int sortNameOrder() {
+    struct NameKey *keys = malloc(((size_t)contact_count + 1) * sizeof(struct NameKey));
+    if (keys == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < contact_count; i++) {
+        fillNameKey(&keys[i], i);
+    }
+    qsort(keys, contact_count, sizeof(struct NameKey), compareNameKeys);
+    for (int i = 0; i < contact_count; i++) {
+        name_order[i] = keys[i].index;
+    }
+    free(keys);
+    return 1;
+}
+
+/**
+ * @brief Puts contacts [first, contact_count), added in bulk, into name
+ * order. The new names are sorted on their own, then each finds its place
+ * among the old ones by binary search, and the old names after it move up
+ * in one block; when there are many, a full sort is cheaper. Short of
+ * memory for the sort keys, the names are inserted one at a time instead:
+ * slower, but the session and its imported contacts are kept.
+ */
+void orderNewNames(int first) {
+    int added = contact_count - first;
+    if ((long)added * 16 > first && sortNameOrder()) {
+        return;
+    }
+    struct NameKey *keys = malloc(((size_t)added + 1) * sizeof(struct NameKey));
+    if (keys == NULL) {
+        for (int i = first; i < contact_count; i++) {
+            int index = name_order[i];
+            int pos = searchNameOrder(contacts[index].name, i, 0, 0);
+            memmove(&name_order[pos + 1], &name_order[pos], (i - pos) * sizeof(int));
+            name_order[pos] = index;
+        }
+        return;
+    }
+    for (int i = 0; i < added; i++) {
+        fillNameKey(&keys[i], first + i);
+    }
+    qsort(keys, added, sizeof(struct NameKey), compareNameKeys);
+    int old = first, end = contact_count; // Old names [0, old) are still to place; [end, contact_count) is done
+    for (int i = added - 1; i >= 0; i--) {
+        int pos = searchNameOrder(contacts[keys[i].index].name, old, 0, 1);
+        memmove(&name_order[end - (old - pos)], &name_order[pos], (old - pos) * sizeof(int));
+        end -= old - pos;
+        old = pos;
+        name_order[--end] = keys[i].index;
+    }
+    free(keys);
+}
+
+/**
+ * @brief Finds the contacts whose name starts with a prefix (any case).
+ * They follow each other in name_order, mixed with any deleted ones.
+ * @param first Receives the position of the first one in name_order.
+ * @param end Receives the position just past the last one.
+ * @param limit Counting stops here, so deleted contacts waiting for
+ * compaction never turn a short prefix into a walk over the whole range.
+ * @return How many there are, not counting deleted ones, up to 'limit'.
+ */
+int findPrefixRange(const char *prefix, int *first, int *end, int limit) {
+    *first = searchNameOrder(prefix, contact_count, 1, 0);
+    *end = searchNameOrder(prefix, contact_count, 1, 1);
+    if (deleted_count == 0) {
+        return *end - *first < limit ? *end - *first : limit;
+    }
+    int count = 0;
+    for (int i = *first; i < *end && count < limit; i++) {
+        count += !deleted[name_order[i]];
+    }
+    return count;
+}
+
+/**
+ * @brief Lists the first contacts, alphabetically, whose name starts with
+ * the text entered.
+ */
+void autocompleteContacts() {
+    char prefix[100];
+    printf("Enter the start of a name: ");
+    fgets(prefix, sizeof(prefix), stdin);
+    prefix[strcspn(prefix, "\n")] = 0;
+
+    int first, end;
+    int count = findPrefixRange(prefix, &first, &end, SUGGESTIONS + 1);
+    if (count == 0) {
+        printf("No contact names start with '%s'.\n", prefix);
+        return;
+    }
+    if (count > SUGGESTIONS) {
+        printf("\n--- Names Starting with '%s' (more than %d) ---\n", prefix, SUGGESTIONS);
+    } else {
+        printf("\n--- Names Starting with '%s' (%d) ---\n", prefix, count);
+    }
+    printf("%-30s %-20s %-30s\n", "Name", "Phone Number", "Email Address");
+    printf("--------------------------------------------------------------------------\n");
+    for (int i = first, shown = 0; i < end && shown < SUGGESTIONS; i++) {
+        if (!deleted[name_order[i]]) {
+            const struct Contact *c = &contacts[name_order[i]];
+            printf("%-30s %-20s %-30s\n", c->name, c->phone, c->email);
+            shown++;
+        }
+    }
+    if (count > SUGGESTIONS) {
+        printf("... and more\n");
+    }
+    printf("--------------------------------------------------------------------------\n");
+}
+
+// --- Fuzzy Search ---
+
+// Bit of a (lower-case) letter pair in a name signature
+static uint64_t pairBit(unsigned char a, unsigned char b) {
+    return 1ULL << (((uint32_t)(a << 8 | b) * 0x9E3779B1u) >> 26);
+}
+
+static uint64_t namePairs(const char *name, int *length) {
+    uint64_t pairs = 0;
+    int len = 0;
+    for (; name[len]; len++) {
+        if (name[len + 1]) {
+            pairs |= pairBit(tolower((unsigned char)name[len]), tolower((unsigned char)name[len + 1]));
+        }
+    }
+    *length = len;
+    return pairs;
+}
+
+/**
+ * @brief Updates the signature of contacts[index] after its name changed.
+ */
+void signContact(int index) {
+    signatures[index].pairs = namePairs(contacts[index].name, &signatures[index].length);
+}
+
+// A query prepared once for every name it is compared with
+struct FuzzyQuery {
+    uint64_t match[256]; // Bit i set for the characters equal to query[i] (any case)
+    uint64_t pairs;
+    int pair_count; // Bits set in 'pairs'
+    int length;
+    int max_distance;
+};
+
+/**
+ * @brief Edit distance between the query and a name with Myers' bit-vector
+ * algorithm: one pass over the name, a few word operations per character.
+ * @return The distance, or a value above 'bound' once it cannot end up
+ * within it.
+ */
+static int editDistance(const struct FuzzyQuery *q, const char *name, int length, int bound) {
+    uint64_t pv = ~0ULL, mv = 0, last = 1ULL << (q->length - 1);
+    int score = q->length;
+    for (int j = 0; j < length; j++) {
+        uint64_t eq = q->match[(unsigned char)name[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        score += (ph & last) ? 1 : (mh & last) ? -1 : 0;
+        if (score - (length - j - 1) > bound) {
+            return bound + 1; // Each remaining character lowers it by one at most
+        }
+        ph = ph << 1 | 1; // The top row of the table counts up: 1, 2, 3, ...
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+// One thread's share of a fuzzy search and its best matches
+struct FuzzyWorker {
+    const struct FuzzyQuery *query;
+    int first, last; // Contacts [first, last)
+    int results[FUZZY_RESULTS];
+    int distances[FUZZY_RESULTS];
+    int found;
+    long compared; // Names that passed the filters
+};
+
+// Keeps a worker's matches sorted by distance, then name
+static void keepMatch(struct FuzzyWorker *w, int index, int distance) {
+    int pos = w->found < FUZZY_RESULTS ? w->found++ : FUZZY_RESULTS;
+    while (pos > 0 && (w->distances[pos - 1] > distance ||
+                       (w->distances[pos - 1] == distance &&
+                        compareNames(contacts[w->results[pos - 1]].name, contacts[index].name) > 0))) {
+        if (pos < FUZZY_RESULTS) {
+            w->results[pos] = w->results[pos - 1];
+            w->distances[pos] = w->distances[pos - 1];
+        }
+        pos--;
+    }
+    if (pos < FUZZY_RESULTS) {
+        w->results[pos] = index;
+        w->distances[pos] = distance;
+    }
+}
+
+static void *fuzzyWorker(void *arg) {
+    struct FuzzyWorker *w = arg;
+    const struct FuzzyQuery *q = w->query;
+    int bound = q->max_distance;
+    for (int i = w->first; i < w->last; i++) {
+        const struct NameSignature *sig = &signatures[i];
+        // Each edit changes the length by one at most and breaks at most two letter pairs
+        if (deleted[i] || sig->length < q->length - bound || sig->length > q->length + bound ||
+            __builtin_popcountll(sig->pairs & q->pairs) < q->pair_count - 2 * bound) {
+            continue;
+        }
+        w->compared++;
+        int distance = editDistance(q, contacts[i].name, sig->length, bound);
+        if (distance <= bound) {
+            keepMatch(w, i, distance);
+            if (w->found == FUZZY_RESULTS) {
+                bound = w->distances[FUZZY_RESULTS - 1]; // Only as close a match can still get in
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Finds the contacts whose name is closest to a query, searching
+ * slices of the address book on several threads when it is large.
+ * @return The number of matches written to 'results' and 'distances'.
+ */
+int fuzzyFindContacts(const char *text, int *results, int *distances, long *compared, int *threads_used) {
+    struct FuzzyQuery q;
+    memset(&q, 0, sizeof(q));
+    q.length = (int)strlen(text);
+    for (int i = 0; i < q.length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        q.match[tolower(c)] |= 1ULL << i;
+        q.match[toupper(c)] |= 1ULL << i;
+    }
+    q.pairs = namePairs(text, &q.length);
+    q.pair_count = __builtin_popcountll(q.pairs);
+    q.max_distance = q.length < 3 ? 0 : q.length <= 5 ? 1 : q.length / 3;
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int thread_count = contact_count / FUZZY_NAMES_PER_THREAD + 1;
+    thread_count = thread_count > cores ? (int)cores : thread_count;
+    thread_count = thread_count > MAX_FUZZY_THREADS ? MAX_FUZZY_THREADS : thread_count < 1 ? 1 : thread_count;
+
+    struct FuzzyWorker workers[MAX_FUZZY_THREADS];
+    pthread_t threads[MAX_FUZZY_THREADS];
+    int started[MAX_FUZZY_THREADS] = {0};
+    for (int t = 0; t < thread_count; t++) {
+        struct FuzzyWorker *w = &workers[t];
+        memset(w, 0, sizeof(*w));
+        w->query = &q;
+        w->first = (int)((long)contact_count * t / thread_count);
+        w->last = (int)((long)contact_count * (t + 1) / thread_count);
+        // The first slice runs on this thread, as does any slice whose thread could not start
+        started[t] = t > 0 && pthread_create(&threads[t], NULL, fuzzyWorker, w) == 0;
+    }
+    for (int t = 0; t < thread_count; t++) {
+        if (!started[t]) {
+            fuzzyWorker(&workers[t]);
+        }
+    }
+
+    // Merge the per-thread lists, which are each already in order
+    struct FuzzyWorker merged;
+    memset(&merged, 0, sizeof(merged));
+    for (int t = 0; t < thread_count; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        }
+        for (int i = 0; i < workers[t].found; i++) {
+            keepMatch(&merged, workers[t].results[i], workers[t].distances[i]);
+        }
+        merged.compared += workers[t].compared;
+    }
+    memcpy(results, merged.results, merged.found * sizeof(int));
+    memcpy(distances, merged.distances, merged.found * sizeof(int));
+    *compared = merged.compared;
+    *threads_used = thread_count;
+    return merged.found;
+}
+
+/**
+ * @brief Asks for a name, possibly misspelled, and lists the closest ones.
+ */
+void fuzzySearchContacts() {
+    char query[100];
+    printf("Enter the name to search for (typos allowed): ");
+    fgets(query, sizeof(query), stdin);
+    query[strcspn(query, "\n")] = 0;
+    if (query[0] == 0 || strlen(query) > FUZZY_MAX_QUERY) {
+        printf("Error: Enter 1 to %d characters.\n", FUZZY_MAX_QUERY);
+        return;
+    }
+
+    int results[FUZZY_RESULTS], distances[FUZZY_RESULTS], threads;
+    long compared;
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    int found = fuzzyFindContacts(query, results, distances, &compared, &threads);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (found == 0) {
+        printf("No contact names are close to '%s'.\n", query);
+    } else {
+        printf("\n--- Names Closest to '%s' ---\n", query);
+        printf("%-30s %-20s %-30s %-s\n", "Name", "Phone Number", "Email Address", "Edits");
+        printf("--------------------------------------------------------------------------------\n");
+        for (int i = 0; i < found; i++) {
+            const struct Contact *c = &contacts[results[i]];
+            printf("%-30s %-20s %-30s %d\n", c->name, c->phone, c->email, distances[i]);
+        }
+        printf("--------------------------------------------------------------------------------\n");
+    }
+    printf("Compared %ld of %d name(s) in %.3f ms on %d thread(s).\n", compared, contact_count - deleted_count,
+           ((end.tv_sec - begin.tv_sec) * 1e9 + (end.tv_nsec - begin.tv_nsec)) / 1e6, threads);
+}
+
+// --- Caller ID ---
+
+/**
+ * @brief Reduces a phone number as typed to its international digits
+ * (country code first, no '+'), e.g. "(555) 010-4477" -> "15550104477".
+ * Spaces and punctuation are skipped, and a letter or ',' ends the number,
+ * so an extension ("x12") or a wildcard ("0xxx") is left out.
+ * @return The number of digits written to 'digits', or 0 if there are none
+ * or more than MAX_PHONE_DIGITS.
+ */
+int normalizePhone(const char *text, char *digits) {
+    char raw[MAX_PHONE_DIGITS + 8];
+    int length = 0, international = 0;
+    while (isspace((unsigned char)*text)) {
+        text++;
+    }
+    if (*text == '+') {
+        international = 1;
+        text++;
+    }
+    for (; *text && !isalpha((unsigned char)*text) && *text != ',' && *text != ';'; text++) {
+        if (isdigit((unsigned char)*text)) {
+            if (length == (int)sizeof(raw) - 1) {
+                return 0;
+            }
+            raw[length++] = *text;
+        }
+    }
+    raw[length] = 0;
+
+    const char *start = raw;
+    int prefix = strlen(INTERNATIONAL_PREFIX), trunk = strlen(TRUNK_PREFIX);
+    if (!international && strncmp(raw, INTERNATIONAL_PREFIX, prefix) == 0) {
+        international = 1;
+        start += prefix;
+    }
+    int out = 0;
+    if (!international) {
+        if (strncmp(start, TRUNK_PREFIX, trunk) == 0) {
+            start += trunk;
+        }
+        if (*start == 0) {
+            return 0; // Just the trunk prefix
+        }
+        out = strlen(COUNTRY_CODE);
+        memcpy(digits, COUNTRY_CODE, out);
+    }
+    int rest = strlen(start);
+    if (rest == 0 || out + rest > MAX_PHONE_DIGITS) {
+        return 0;
+    }
+    memcpy(digits + out, start, rest + 1);
+    return out + rest;
+}
+
+// Packs the first 'length' digits into a phone index key
+static uint64_t phoneKey(const char *digits, int length) {
+    uint64_t value = 0;
+    for (int i = 0; i < length; i++) {
+        value = value * 10 + (digits[i] - '0');
+    }
+    return value << 4 | length;
+}
+
+// Spreads a key's bits over the index (the finaliser of MurmurHash3)
+static uint64_t hashPhoneKey(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    return key ^ (key >> 33);
+}
+
+// The key of contacts[index]'s phone number, or 0 if it has none
+static uint64_t contactPhoneKey(int index) {
+    char digits[MAX_PHONE_DIGITS + 1];
+    int length = normalizePhone(contacts[index].phone, digits);
+    return length ? phoneKey(digits, length) : 0;
+}
+
+/**
+ * @brief Moves the phone index into 'capacity' slots (a power of two),
+ * using the stored keys.
+ * @return 1 on success, 0 if out of memory (the old index is kept).
+ */
+int resizePhoneIndex(int capacity) {
+    struct PhoneIndexSlot *slots = malloc((size_t)capacity * sizeof(struct PhoneIndexSlot));
+    if (slots == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < capacity; i++) {
+        slots[i].index = -1;
+    }
+    unsigned int mask = capacity - 1;
+    for (int i = 0; i < phone_index_capacity; i++) {
+        if (phone_index[i].index != -1) {
+            unsigned int slot = hashPhoneKey(phone_index[i].key) & mask;
+            while (slots[slot].index != -1) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = phone_index[i];
+        }
+    }
+    free(phone_index);
+    phone_index = slots;
+    phone_index_capacity = capacity;
+    return 1;
+}
+
+/**
+ * @brief Adds contacts[index]'s phone number to the phone index, unless it
+ * is not a usable number. Other contacts may share the number.
+ */
+void indexPhone(int index) {
+    uint64_t key = contactPhoneKey(index);
+    if (key == 0) {
+        return;
+    }
+    unsigned int mask = phone_index_capacity - 1;
+    unsigned int slot = hashPhoneKey(key) & mask;
+    while (phone_index[slot].index != -1) {
+        slot = (slot + 1) & mask;
+    }
+    phone_index[slot] = (struct PhoneIndexSlot){key, index};
+}
+
+/**
+ * @brief Removes contacts[index]'s phone number from the phone index; call
+ * it before the number changes. Works like unindexContact().
+ */
+void unindexPhone(int index) {
+    uint64_t key = contactPhoneKey(index);
+    if (key == 0) {
+        return;
+    }
+    unsigned int mask = phone_index_capacity - 1;
+    unsigned int hole = hashPhoneKey(key) & mask;
+    while (phone_index[hole].index != index) {
+        hole = (hole + 1) & mask;
+    }
+    for (unsigned int next = (hole + 1) & mask; phone_index[next].index != -1; next = (next + 1) & mask) {
+        unsigned int home = hashPhoneKey(phone_index[next].key) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            phone_index[hole] = phone_index[next];
+            hole = next;
+        }
+    }
+    phone_index[hole].index = -1;
+}
+
+// Collects up to 'max' contacts whose number has this key; returns how many
+static int findPhone(uint64_t key, int *results, int max) {
+    int found = 0;
+    unsigned int mask = phone_index_capacity - 1;
+    for (unsigned int slot = hashPhoneKey(key) & mask; phone_index[slot].index != -1; slot = (slot + 1) & mask) {
+        if (phone_index[slot].key == key && found < max) {
+            results[found++] = phone_index[slot].index;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Finds the contacts with the incoming number, or failing that with
+ * the longest number (of at least MIN_PREFIX_DIGITS) that it starts with.
+ * Each try is one hash lookup, so this costs at most MAX_PHONE_DIGITS probes.
+ * @param digits Receives the normalised number.
+ * @param matched Receives how many leading digits matched: all of them for
+ * the contact's own number, fewer for a switchboard.
+ * @return The number of contacts written to 'results' (at most 'max'), or
+ * -1 if 'number' is not a phone number.
+ */
+int lookupCaller(const char *number, char *digits, int *results, int max, int *matched) {
+    int length = normalizePhone(number, digits);
+    if (length == 0) {
+        return -1;
+    }
+    uint64_t keys[MAX_PHONE_DIGITS + 1], value = 0;
+    for (int i = 1; i <= length; i++) {
+        value = value * 10 + (digits[i - 1] - '0');
+        keys[i] = value << 4 | i;
+    }
+    for (int i = length; i == length || i >= MIN_PREFIX_DIGITS; i--) {
+        int found = findPhone(keys[i], results, max);
+        if (found > 0) {
+            *matched = i;
+            return found;
+        }
+    }
+    *matched = 0;
+    return 0;
+}
+
+/**
+ * @brief Asks for an incoming phone number and shows who it belongs to.
+ */
+void callerIdLookup() {
+    char number[100];
+    printf("Enter the incoming phone number: ");
+    fgets(number, sizeof(number), stdin);
+    number[strcspn(number, "\n")] = 0;
+
+    char digits[MAX_PHONE_DIGITS + 1];
+    int results[CALLER_MATCHES], matched;
+    int found = lookupCaller(number, digits, results, CALLER_MATCHES, &matched);
+    if (found < 0) {
+        printf("Error: '%s' is not a phone number (1 to %d digits).\n", number, MAX_PHONE_DIGITS);
+        return;
+    }
+    if (found == 0) {
+        printf("No contact has the number +%s, or a switchboard number it starts with.\n", digits);
+        return;
+    }
+    if (matched == (int)strlen(digits)) {
+        printf("\n--- Caller +%s ---\n", digits);
+    } else {
+        printf("\n--- Caller +%s: Switchboard +%.*s ---\n", digits, matched, digits);
+    }
+    printf("%-30s %-20s %-30s\n", "Name", "Phone Number", "Email Address");
+    printf("--------------------------------------------------------------------------\n");
+    for (int i = 0; i < found; i++) {
+        const struct Contact *c = &contacts[results[i]];
+        printf("%-30s %-20s %-30s\n", c->name, c->phone, c->email);
+    }
+    printf("--------------------------------------------------------------------------\n");
+}
+
+// --- Bulk Import ---
+
+// Which CSV columns hold what; -1 for none
+struct CsvColumns {
+    int name, first, last, phone, email;
+};
+
+// A contact parsed by an import thread, with the keys its merge needs
+struct ImportRecord {
+    struct Contact c;
+    uint64_t phone_key; // 0 without a usable number
+    uint32_t email_hash;
+};
+
+// The records [text, end) of a block given to one parser thread
+struct ImportChunk {
+    char *text, *end;
+    int vcard;
+    const struct CsvColumns *columns;
+    struct ImportRecord *records; // In file order
+    int count, capacity;
+    long skipped; // Records without a name, or with a field too long
+    int out_of_memory;
+};
+
+// A temporary index of e-mail addresses, built for one import
+struct EmailIndex {
+    struct ContactIndexSlot *slots; // Hashed like names
+    int capacity, count;
+};
+
+struct ImportStats {
+    long added, merged, conflicts, skipped;
+};
+
+// Case-insensitive test that 'text' starts with 'word'
+static int startsWith(const char *text, const char *word) {
+    while (*word && tolower((unsigned char)*text) == tolower((unsigned char)*word)) {
+        text++, word++;
+    }
+    return *word == 0;
+}
+
+// Trims 'text' in place and turns each run of white space inside it into one space
+static void tidyField(char *text) {
+    char *out = text;
+    for (const char *c = text; *c; c++) {
+        if (!isspace((unsigned char)*c)) {
+            *out++ = *c;
+        } else if (out > text && out[-1] != ' ') {
+            *out++ = ' ';
+        }
+    }
+    if (out > text && out[-1] == ' ') {
+        out--;
+    }
+    *out = 0;
+}
+
+static int copyField(char *dest, size_t size, const char *text) {
+    size_t length = strlen(text);
+    if (length >= size) {
+        return 0;
+    }
+    memcpy(dest, text, length + 1);
+    return 1;
+}
+
+/**
+ * @brief Tidies the fields of one parsed contact and adds it to the chunk's
+ * records, with its phone key and e-mail hash worked out here, on the
+ * parser thread. A phone number too long as written (with an extension,
+ * say) is kept in its normalised form.
+ */
+static void keepRecord(struct ImportChunk *k, char *name, char *phone, char *email) {
+    tidyField(name);
+    tidyField(phone);
+    tidyField(email);
+    if (k->count == k->capacity) {
+        int capacity = k->capacity ? k->capacity * 2 : 1024;
+        struct ImportRecord *grown = realloc(k->records, (size_t)capacity * sizeof(struct ImportRecord));
+        if (grown == NULL) {
+            k->out_of_memory = 1;
+            return;
+        }
+        k->records = grown;
+        k->capacity = capacity;
+    }
+    struct ImportRecord *r = &k->records[k->count];
+    char digits[MAX_PHONE_DIGITS + 1], compact[MAX_PHONE_DIGITS + 2];
+    int length = normalizePhone(phone, digits);
+    if (length > 0 && strlen(phone) >= sizeof(r->c.phone)) {
+        compact[0] = '+';
+        strcpy(compact + 1, digits);
+        phone = compact;
+    }
+    if (name[0] == 0 || !copyField(r->c.name, sizeof(r->c.name), name) ||
+        !copyField(r->c.phone, sizeof(r->c.phone), phone) || !copyField(r->c.email, sizeof(r->c.email), email)) {
+        k->skipped++;
+        return;
+    }
+    r->phone_key = length ? phoneKey(digits, length) : 0;
+    r->email_hash = hashName(r->c.email);
+    k->count++;
+}
+
+// Finds the end of the CSV record at 'record': the first line break outside quotes, or 'end'
+static char *csvRecordEnd(char *record, char *end) {
+    char *stop = memchr(record, '\n', end - record);
+    if (stop != NULL && memchr(record, '"', stop - record) != NULL) {
+        int quoted = 0;
+        for (stop = record; stop < end && (*stop != '\n' || quoted); stop++) {
+            quoted ^= *stop == '"';
+        }
+    }
+    return stop != NULL ? stop : end;
+}
+
+/**
+ * @brief Splits the CSV record [record, stop) into fields in place, undoing
+ * quotes, and NUL-terminates each field (at *stop for the last one).
+ * @return The number of fields; only the first 'max_fields' are stored.
+ */
+static int splitCsvFields(char *record, char *stop, char **fields, int max_fields) {
+    int count = 0;
+    char *c = record;
+    while (1) {
+        char *field = c, *out;
+        if (c < stop && *c == '"') {
+            out = field;
+            c++;
+            while (c < stop) {
+                if (*c != '"') {
+                    *out++ = *c++;
+                } else if (c + 1 < stop && c[1] == '"') {
+                    *out++ = '"';
+                    c += 2;
+                } else {
+                    c++;
+                    break;
+                }
+            }
+            while (c < stop && *c != ',') {
+                c++; // Text after the closing quote is ignored
+            }
+        } else {
+            while (c < stop && *c != ',') {
+                c++;
+            }
+            out = c;
+        }
+        int last = c >= stop;
+        *out = 0;
+        if (count < max_fields) {
+            fields[count] = field;
+        }
+        count++;
+        if (last) {
+            return count;
+        }
+        c++;
+    }
+}
+
+/**
+ * @brief Reads a CSV header line, in place, into 'columns'. Names are
+ * matched loosely so exports from common address books work: "Name",
+ * "First Name"/"Last Name", and the first column mentioning a phone or an
+ * e-mail address (skipping "Type" and "Label" columns).
+ * @return 1 if the line has a name column, 0 if it is not a header.
+ */
+static int readCsvHeader(char *record, char *stop, struct CsvColumns *columns) {
+    char *fields[IMPORT_MAX_COLUMNS];
+    int count = splitCsvFields(record, stop, fields, IMPORT_MAX_COLUMNS);
+    struct CsvColumns found = {-1, -1, -1, -1, -1};
+    for (int i = 0; i < count && i < IMPORT_MAX_COLUMNS; i++) {
+        char *h = fields[i];
+        tidyField(h);
+        for (char *c = h; *c; c++) {
+            *c = tolower((unsigned char)*c);
+        }
+        if (strcmp(h, "name") == 0 || strcmp(h, "full name") == 0 || strcmp(h, "display name") == 0) {
+            found.name = found.name == -1 ? i : found.name;
+        } else if (strcmp(h, "first name") == 0 || strcmp(h, "given name") == 0) {
+            found.first = found.first == -1 ? i : found.first;
+        } else if (strcmp(h, "last name") == 0 || strcmp(h, "family name") == 0 || strcmp(h, "surname") == 0) {
+            found.last = found.last == -1 ? i : found.last;
+        } else if (strstr(h, "type") != NULL || strstr(h, "label") != NULL) {
+            continue;
+        } else if (strstr(h, "mail") != NULL) {
+            found.email = found.email == -1 ? i : found.email;
+        } else if (strstr(h, "phone") != NULL || strstr(h, "mobile") != NULL || strstr(h, "tel") != NULL) {
+            found.phone = found.phone == -1 ? i : found.phone;
+        }
+    }
+    if (found.name == -1 && found.first == -1 && found.last == -1) {
+        return 0;
+    }
+    *columns = found;
+    return 1;
+}
+
+static void parseCsvChunk(struct ImportChunk *k) {
+    char *fields[IMPORT_MAX_COLUMNS];
+    const struct CsvColumns *col = k->columns;
+    for (char *record = k->text; record < k->end && !k->out_of_memory;) {
+        char *stop = csvRecordEnd(record, k->end);
+        char *next = stop < k->end ? stop + 1 : stop;
+        if (stop > record && stop[-1] == '\r') {
+            stop--;
+        }
+        int count = splitCsvFields(record, stop, fields, IMPORT_MAX_COLUMNS);
+        record = next;
+        count = count < IMPORT_MAX_COLUMNS ? count : IMPORT_MAX_COLUMNS;
+        if (count == 1 && strspn(fields[0], " \t") == strlen(fields[0])) {
+            continue; // Blank line
+        }
+        char none[3][1] = {"", "", ""};
+        char *name = col->name != -1 && col->name < count ? fields[col->name] : none[0];
+        char *phone = col->phone != -1 && col->phone < count ? fields[col->phone] : none[1];
+        char *email = col->email != -1 && col->email < count ? fields[col->email] : none[2];
+        char full[2 * sizeof(((struct Contact *)0)->name)];
+        if (strspn(name, " \t") == strlen(name)) {
+            snprintf(full, sizeof(full), "%s %s", col->first != -1 && col->first < count ? fields[col->first] : "",
+                     col->last != -1 && col->last < count ? fields[col->last] : "");
+            name = full;
+        }
+        keepRecord(k, name, phone, email);
+    }
+}
+
+/**
+ * @brief Returns the vCard line at *pos, NUL-terminated in place, with any
+ * folded continuation lines (starting with a space or tab) joined to it,
+ * and moves *pos to the line after.
+ */
+static char *nextVcardLine(char **pos, char *end) {
+    char *line = *pos;
+    char *stop = memchr(line, '\n', end - line);
+    stop = stop != NULL ? stop : end;
+    char *out = stop > line && stop[-1] == '\r' ? stop - 1 : stop;
+    char *next = stop < end ? stop + 1 : end;
+    while (next < end && (*next == ' ' || *next == '\t')) {
+        char *more = next + 1;
+        stop = memchr(more, '\n', end - more);
+        stop = stop != NULL ? stop : end;
+        size_t length = (stop > more && stop[-1] == '\r' ? stop - 1 : stop) - more;
+        memmove(out, more, length);
+        out += length;
+        next = stop < end ? stop + 1 : end;
+    }
+    *out = 0;
+    *pos = next;
+    return line;
+}
+
+// Cuts the next ';'-separated component off a vCard value, undoing its
+// escapes ("\,", "\;", "\\", "\n") in place
+static char *nextComponent(char **value) {
+    char *start = *value, *out = start, *c = start;
+    for (; *c && *c != ';'; c++) {
+        if (*c == '\\' && c[1] != 0) {
+            c++;
+            *out++ = *c == 'n' || *c == 'N' ? ' ' : *c;
+        } else {
+            *out++ = *c;
+        }
+    }
+    *value = *c ? c + 1 : c;
+    *out = 0;
+    return start;
+}
+
+/**
+ * @brief Parses the vCards (versions 3.0 and 4.0) of a chunk. The name is
+ * FN, or built from N when there is no FN; of several TEL or EMAIL lines,
+ * the preferred one is kept, else the first.
+ */
+static void parseVcardChunk(struct ImportChunk *k) {
+    char none[3][1] = {"", "", ""};
+    char *fn = NULL, *n = NULL, *tel = NULL, *mail = NULL;
+    int inside = 0, tel_preferred = 0, mail_preferred = 0;
+    for (char *pos = k->text; pos < k->end && !k->out_of_memory;) {
+        char *line = nextVcardLine(&pos, k->end);
+        if (startsWith(line, "BEGIN:VCARD")) {
+            inside = 1;
+            fn = n = tel = mail = NULL;
+            tel_preferred = mail_preferred = 0;
+            continue;
+        }
+        if (!inside) {
+            continue;
+        }
+        if (startsWith(line, "END:VCARD")) {
+            inside = 0;
+            char full[2 * sizeof(((struct Contact *)0)->name)];
+            if ((fn == NULL || strspn(fn, " \t") == strlen(fn)) && n != NULL) {
+                char *family = nextComponent(&n), *given = nextComponent(&n), *middle = nextComponent(&n);
+                snprintf(full, sizeof(full), "%s %s %s", given, middle, family);
+                fn = full;
+            }
+            keepRecord(k, fn ? fn : none[0], tel ? tel : none[1], mail ? mail : none[2]);
+            continue;
+        }
+
+        // group.NAME;PARAM=...;PARAM=...:value
+        char *value = strchr(line, ':');
+        if (value == NULL) {
+            continue;
+        }
+        *value++ = 0;
+        char *params = strchr(line, ';');
+        if (params != NULL) {
+            *params++ = 0;
+            for (char *c = params; *c; c++) {
+                *c = tolower((unsigned char)*c);
+            }
+        }
+        char *dot = strrchr(line, '.');
+        char *property = dot != NULL ? dot + 1 : line;
+        int preferred = params != NULL && strstr(params, "pref") != NULL;
+        if (sameName(property, "FN")) {
+            fn = nextComponent(&value);
+        } else if (sameName(property, "N")) {
+            n = value; // Split when the card ends, if there is no FN
+        } else if (sameName(property, "TEL") && (tel == NULL || (preferred && !tel_preferred))) {
+            tel = nextComponent(&value);
+            tel += startsWith(tel, "tel:") ? 4 : 0; // vCard 4.0 may give a URI
+            tel_preferred = preferred;
+        } else if (sameName(property, "EMAIL") && (mail == NULL || (preferred && !mail_preferred))) {
+            mail = nextComponent(&value);
+            mail_preferred = preferred;
+        }
+    }
+    k->skipped += inside; // A card cut off by the end of the file
+}
+
+static void *importWorker(void *arg) {
+    struct ImportChunk *k = arg;
+    if (k->vcard) {
+        parseVcardChunk(k);
+    } else {
+        parseCsvChunk(k);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Cuts text[0, length) into at most 'pieces' runs of whole records
+ * of about the same size, one per parser thread. A CSV record ends at a
+ * line break outside quotes, a vCard after its END:VCARD line. Text after
+ * the last whole record is left for the next block, unless 'eof' is set.
+ * @return The number of runs; run i is [cuts[i], cuts[i + 1]).
+ */
+static int splitRecords(char *text, size_t length, int vcard, int eof, char **cuts, int pieces) {
+    char *end = text + length, *last = text, *c = text;
+    int quotes = !vcard && memchr(text, '"', length) != NULL;
+    int quoted = 0, count = 1;
+    size_t step = length / pieces + 1;
+    cuts[0] = text;
+    while (c < end) {
+        char *line = c;
+        char *stop = memchr(c, '\n', end - c);
+        if (stop == NULL) {
+            break;
+        }
+        if (quotes) {
+            for (; c < stop; c++) {
+                quoted ^= *c == '"';
+            }
+        }
+        c = stop + 1;
+        if (vcard ? startsWith(line, "END:VCARD") : !quoted) {
+            last = c;
+            if (count < pieces && (size_t)(last - text) >= step * count) {
+                cuts[count++] = last;
+            }
+        }
+    }
+    if (eof) {
+        last = end;
+    }
+    if (last == text) {
+        return 0;
+    }
+    if (cuts[count - 1] == last) {
+        count--;
+    }
+    cuts[count] = last;
+    return count;
+}
+
+static int findEmail(const struct EmailIndex *e, const char *email, uint32_t hash) {
+    if (e->capacity == 0) {
+        return -1;
+    }
+    unsigned int mask = e->capacity - 1;
+    for (unsigned int slot = hash & mask; e->slots[slot].index != -1; slot = (slot + 1) & mask) {
+        if (e->slots[slot].hash == hash && sameName(contacts[e->slots[slot].index].email, email)) {
+            return e->slots[slot].index;
+        }
+    }
+    return -1;
+}
+
+// Adds contacts[index]'s e-mail address, growing the index to stay at most half full
+static int addEmail(struct EmailIndex *e, int index, uint32_t hash) {
+    if (2 * (e->count + 1) > e->capacity) {
+        int capacity = e->capacity ? e->capacity * 2 : 1024;
+        struct ContactIndexSlot *slots = malloc((size_t)capacity * sizeof(struct ContactIndexSlot));
+        if (slots == NULL) {
+            return 0;
+        }
+        for (int i = 0; i < capacity; i++) {
+            slots[i].index = -1;
+        }
+        for (int i = 0; i < e->capacity; i++) {
+            if (e->slots[i].index != -1) {
+                unsigned int slot = e->slots[i].hash & (capacity - 1);
+                while (slots[slot].index != -1) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                slots[slot] = e->slots[i];
+            }
+        }
+        free(e->slots);
+        e->slots = slots;
+        e->capacity = capacity;
+    }
+    unsigned int mask = e->capacity - 1;
+    unsigned int slot = hash & mask;
+    while (e->slots[slot].index != -1) {
+        slot = (slot + 1) & mask;
+    }
+    e->slots[slot] = (struct ContactIndexSlot){hash, index};
+    e->count++;
+    return 1;
+}
+
+// Counts a merge conflict and shows the first few
+static void reportConflict(struct ImportStats *s, const char *name, const char *field, const char *kept, const char *other) {
+    if (++s->conflicts <= IMPORT_CONFLICTS_SHOWN) {
+        printf("Conflict: '%s' %s: kept '%s', the file has '%s'.\n", name, field, kept, other);
+    }
+}
+
+/**
+ * @brief Adds one imported contact, or merges it into the contact with the
+ * same name, or failing that the same phone number or e-mail address.
+ * Empty fields of that contact are filled in; a field both have, with
+ * different values, is a conflict and keeps the value already in the book.
+ * New contacts are left at the end of name_order, for orderNewNames().
+ * @return 1 on success, 0 if out of memory.
+ */
+static int mergeRecord(const struct ImportRecord *r, struct EmailIndex *emails, struct ImportStats *s) {
+    int target = findContactByName(r->c.name);
+    if (target == -1 && r->phone_key != 0) {
+        findPhone(r->phone_key, &target, 1);
+    }
+    if (target == -1 && r->c.email[0] != 0) {
+        target = findEmail(emails, r->c.email, r->email_hash);
+    }
+    if (target == -1) {
+        if (contact_count == contact_capacity && !reserveContacts(contact_capacity * 2)) {
+            return 0;
+        }
+        contacts[contact_count] = r->c;
+        if (r->c.email[0] != 0 && !addEmail(emails, contact_count, r->email_hash)) {
+            return 0;
+        }
+        indexContact(contact_count);
+        signContact(contact_count);
+        indexPhone(contact_count);
+        name_order[contact_count] = contact_count;
+        contact_count++;
+        s->added++;
+        return 1;
+    }
+
+    struct Contact *c = &contacts[target];
+    s->merged++;
+    if (!sameName(c->name, r->c.name)) {
+        reportConflict(s, c->name, "name", c->name, r->c.name);
+    }
+    if (r->c.phone[0] != 0) {
+        if (c->phone[0] == 0) {
+            strcpy(c->phone, r->c.phone);
+            indexPhone(target);
+        } else if (contactPhoneKey(target) != r->phone_key || (r->phone_key == 0 && strcmp(c->phone, r->c.phone) != 0)) {
+            reportConflict(s, c->name, "phone", c->phone, r->c.phone);
+        }
+    }
+    if (r->c.email[0] != 0) {
+        if (c->email[0] == 0) {
+            strcpy(c->email, r->c.email);
+            if (!addEmail(emails, target, r->email_hash)) {
+                return 0;
+            }
+        } else if (!sameName(c->email, r->c.email)) {
+            reportConflict(s, c->name, "email", c->email, r->c.email);
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Imports contacts from a CSV file or a vCard file, told apart by
+ * their first line. The file is read in large blocks; each block is cut at
+ * record boundaries into chunks parsed on several threads, and the parsed
+ * contacts are then merged in file order on this one.
+ * @return The number of contacts added, or -1 if the file cannot be read.
+ */
+int importContacts(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        printf("Error: Cannot open %s.\n", filename);
+        return -1;
+    }
+    size_t capacity = IMPORT_BLOCK_SIZE;
+    char *buffer = malloc(capacity + 1);
+    struct EmailIndex emails = {NULL, 0, 0};
+    int out_of_memory = buffer == NULL;
+    for (int i = 0; i < contact_count && !out_of_memory; i++) {
+        if (!deleted[i] && contacts[i].email[0] != 0) {
+            out_of_memory = !addEmail(&emails, i, hashName(contacts[i].email));
+        }
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    struct ImportStats stats = {0, 0, 0, 0};
+    struct CsvColumns columns = {0, -1, -1, 1, 2}; // Without a header: name,phone,email
+    int first_new = contact_count, vcard = 0, first_block = 1, eof = 0, most_threads = 1;
+    size_t used = 0;
+    while (!out_of_memory && (!eof || used > 0)) {
+        if (!eof) {
+            size_t wanted = capacity - used;
+            size_t got = fread(buffer + used, 1, wanted, fp);
+            used += got;
+            eof = got < wanted;
+        }
+        buffer[used] = 0;
+        char *text = buffer;
+        if (first_block) {
+            first_block = 0;
+            if (used >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0) {
+                text += 3; // UTF-8 byte order mark
+            }
+            text += strspn(text, " \t\r\n");
+            vcard = startsWith(text, "BEGIN:VCARD");
+            if (!vcard && text < buffer + used) {
+                char *stop = csvRecordEnd(text, buffer + used);
+                char *header = malloc(stop - text + 1);
+                if (header == NULL) {
+                    out_of_memory = 1;
+                    break;
+                }
+                memcpy(header, text, stop - text);
+                char *header_end = header + (stop - text);
+                if (header_end > header && header_end[-1] == '\r') {
+                    header_end--;
+                }
+                if (readCsvHeader(header, header_end, &columns)) {
+                    text = stop < buffer + used ? stop + 1 : stop;
+                }
+                free(header);
+            }
+        }
+
+        size_t length = buffer + used - text;
+        int pieces = (int)(length / IMPORT_BYTES_PER_THREAD) + 1;
+        pieces = pieces > cores ? (int)cores : pieces;
+        pieces = pieces > MAX_IMPORT_THREADS ? MAX_IMPORT_THREADS : pieces < 1 ? 1 : pieces;
+        char *cuts[MAX_IMPORT_THREADS + 1];
+        pieces = splitRecords(text, length, vcard, eof, cuts, pieces);
+        if (pieces == 0) {
+            if (eof) {
+                break;
+            }
+            // No whole record in the buffer: make room for a longer one
+            memmove(buffer, text, length);
+            used = length;
+            char *grown = capacity < (size_t)INT_MAX / 2 ? realloc(buffer, 2 * capacity + 1) : NULL;
+            if (grown == NULL) {
+                out_of_memory = 1;
+                break;
+            }
+            buffer = grown;
+            capacity *= 2;
+            continue;
+        }
+
+        struct ImportChunk chunks[MAX_IMPORT_THREADS];
+        pthread_t threads[MAX_IMPORT_THREADS];
+        int started[MAX_IMPORT_THREADS] = {0};
+        for (int t = 0; t < pieces; t++) {
+            chunks[t] = (struct ImportChunk){cuts[t], cuts[t + 1], vcard, &columns, NULL, 0, 0, 0, 0};
+            // The first chunk is parsed on this thread, as is any chunk whose thread could not start
+            started[t] = t > 0 && pthread_create(&threads[t], NULL, importWorker, &chunks[t]) == 0;
+        }
+        for (int t = 0; t < pieces; t++) {
+            if (!started[t]) {
+                importWorker(&chunks[t]);
+            }
+        }
+        most_threads = pieces > most_threads ? pieces : most_threads;
+        for (int t = 0; t < pieces; t++) {
+            if (started[t]) {
+                pthread_join(threads[t], NULL);
+            }
+            struct ImportChunk *k = &chunks[t];
+            out_of_memory |= k->out_of_memory;
+            stats.skipped += k->skipped;
+            for (int i = 0; i < k->count && !out_of_memory; i++) {
+                out_of_memory = !mergeRecord(&k->records[i], &emails, &stats);
+            }
+            free(k->records);
+        }
+
+        length = buffer + used - cuts[pieces];
+        memmove(buffer, cuts[pieces], length);
+        used = length;
+    }
+    int read_error = ferror(fp);
+    fclose(fp);
+    free(buffer);
+    free(emails.slots);
+
+    orderNewNames(first_new);
+    if (stats.conflicts > IMPORT_CONFLICTS_SHOWN) {
+        printf("... and %ld more conflict(s).\n", stats.conflicts - IMPORT_CONFLICTS_SHOWN);
+    }
+    if (out_of_memory) {
+        printf("Error: Out of memory; the import stopped early.\n");
+    } else if (read_error) {
+        printf("Error reading %s; the import stopped early.\n", filename);
+    }
+    printf("%s: %ld contact(s) added, %ld merged into existing ones (%ld conflict(s)), parsed on %d thread(s).\n",
+           vcard ? "vCard" : "CSV", stats.added, stats.merged, stats.conflicts, most_threads);
+    if (stats.skipped > 0) {
+        printf("Skipped %ld record(s) without a name or with a field too long.\n", stats.skipped);
+    }
+    return (int)stats.added;
+}
+
+/**
+ * @brief Asks for a CSV or vCard file and imports the contacts in it.
+ */
+void importContactsFromFile() {
+    char filename[256];
+    printf("Enter the CSV or vCard file name: ");
+    fgets(filename, sizeof(filename), stdin);
+    filename[strcspn(filename, "\n")] = 0;
+
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    int added = importContacts(filename);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (added != -1) {
+        printf("Took %.3f seconds.\n", (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9);
+    }
+}
+
+/**
+ * @brief Saves the current contact list to a binary file.
+ */
+void saveData() {
+    FILE *fp = fopen(FILENAME, "wb");
+    if (fp == NULL) {
+        printf("Error: Could not open file for writing.\n");
+        return;
+    }
+    // Deleted slots are left out: write each run of live contacts at once
+    for (int start = 0, end; start < contact_count; start = end + 1) {
+        for (end = start; end < contact_count && !deleted[end]; end++) {
+        }
+        fwrite(&contacts[start], sizeof(struct Contact), end - start, fp);
+    }
+    fclose(fp);
+}
+
+/**
+ * @brief Loads the contact list from a binary file.
+ */
+void loadData() {
+    if (!reserveContacts(INITIAL_CAPACITY)) {
+        printf("Error: Out of memory.\n");
+        exit(1);
+    }
+    FILE *fp = fopen(FILENAME, "rb");
+    if (fp == NULL) {
+        return; // File doesn't exist on first run, which is normal.
+    }
+    // Size the array and the index once from the file size
+    fseek(fp, 0, SEEK_END);
+    long records = ftell(fp) / (long)sizeof(struct Contact);
+    rewind(fp);
+    if (records > INT_MAX / 4 || !reserveContacts((int)records)) {
+        printf("Error: Not enough memory to load %ld contact(s).\n", records);
+        fclose(fp);
+        exit(1);
+    }
+    int read = fread(contacts, sizeof(struct Contact), records, fp);
+    fclose(fp);
+
+    int duplicates = 0;
+    for (int i = 0; i < read; i++) {
+        contacts[i].name[sizeof(contacts[i].name) - 1] = 0;
+        contacts[i].phone[sizeof(contacts[i].phone) - 1] = 0;
+        contacts[i].email[sizeof(contacts[i].email) - 1] = 0;
+        contacts[contact_count] = contacts[i];
+        if (findContactByName(contacts[contact_count].name) != -1) {
+            duplicates++;
+            continue;
+        }
+        indexContact(contact_count);
+        signContact(contact_count);
+        indexPhone(contact_count);
+        contact_count++;
+    }
+    if (!sortNameOrder()) {
+        printf("Error: Out of memory.\n");
+        exit(1);
+    }
+    if (contact_count > 0) {
+        printf("Loaded %d contact(s) from file.\n", contact_count);
+    }
+    if (duplicates > 0) {
+        printf("Warning: %d contact(s) with a repeated name were skipped.\n", duplicates);
+    }
+}